@@ -0,0 +1,172 @@
+// Microbenchmarks of the ackermann controller hot path.
+//
+// The update() benchmark runs the controller in process on the fake robot of the tests,
+// it needs the test model and configuration on the parameter server:
+//   roslaunch ackermann_controller ackermann_benchmark.launch
+// which also writes the results as JSON (google benchmark --benchmark_out option).
+
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <ros/ros.h>
+
+#include <ackermann_controller/ackermann_controller.h>
+#include <ackermann_controller/odometry.h>
+#include <controller_realtime_utils/shared_command_channel.h>
+#include <controller_realtime_utils/speed_limiter.h>
+#include <vehicle_kinematics/ackermann_kinematics.h>
+
+#include "../test/src/ackermann.h"
+
+namespace
+{
+  // Geometry of the test robot
+  const double TRACK = 1.1;
+  const double WHEEL_RADIUS = 0.28;
+  const double WHEEL_BASE = 1.9;
+  const double STEERING_LIMIT = 0.5;
+  const double PERIOD = 0.01;
+}
+
+static void BM_OdometryUpdate(benchmark::State& state)
+{
+  ackermann_controller::Odometry odometry;
+  odometry.setWheelParams(TRACK, WHEEL_RADIUS, WHEEL_RADIUS, WHEEL_BASE);
+  odometry.setHistorySize(1000);
+  ros::Time time(1.0);
+  odometry.init(time);
+
+  double rear_pos = 0.0;
+  const double rear_vel = 3.0;
+  for (auto _ : state)
+  {
+    time += ros::Duration(PERIOD);
+    rear_pos += rear_vel*PERIOD;
+    benchmark::DoNotOptimize(odometry.update(rear_pos, rear_vel, rear_pos, rear_vel, 0.2, time));
+  }
+  benchmark::DoNotOptimize(odometry.getX());
+}
+BENCHMARK(BM_OdometryUpdate);
+
+static void BM_OdometryUpdateOpenLoop(benchmark::State& state)
+{
+  ackermann_controller::Odometry odometry;
+  odometry.setWheelParams(TRACK, WHEEL_RADIUS, WHEEL_RADIUS, WHEEL_BASE);
+  odometry.setHistorySize(1000);
+  ros::Time time(1.0);
+  odometry.init(time);
+
+  for (auto _ : state)
+  {
+    time += ros::Duration(PERIOD);
+    odometry.updateOpenLoop(1.0, 0.2, time);
+  }
+  benchmark::DoNotOptimize(odometry.getX());
+}
+BENCHMARK(BM_OdometryUpdateOpenLoop);
+
+static void BM_SpeedLimiterLimit(benchmark::State& state)
+{
+  // Linear, angular and steering axes of the controllers, limited together
+  const std::size_t axes = 4;
+  controller_realtime_utils::SpeedLimiter<double, axes> limiter;
+  for (std::size_t i = 0; i < axes; ++i)
+  {
+    limiter.setVelocityLimits(i, true, -2.0, 2.0);
+    limiter.setAccelerationLimits(i, true, -1.0, 1.0);
+    limiter.setJerkLimits(i, true, -5.0, 5.0);
+  }
+
+  // A square wave command, every limit is hit
+  double v0[axes] = {0.0}, v1[axes] = {0.0};
+  unsigned long cycle = 0;
+  for (auto _ : state)
+  {
+    const double command = (++cycle/200) % 2 ? 3.0 : -3.0;
+    double v[axes] = {command, -command, command, -command};
+    limiter.limit(v, v0, v1, PERIOD);
+    benchmark::DoNotOptimize(v);
+    for (std::size_t i = 0; i < axes; ++i)
+    {
+      v1[i] = v0[i];
+      v0[i] = v[i];
+    }
+  }
+}
+BENCHMARK(BM_SpeedLimiterLimit);
+
+static void BM_HandleSteeringSaturation(benchmark::State& state)
+{
+  const vehicle_kinematics::AckermannKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_RADIUS,
+                                                                   WHEEL_BASE, STEERING_LIMIT);
+
+  // Steering sweep across the joint limits, both saturation branches are taken
+  unsigned long cycle = 0;
+  for (auto _ : state)
+  {
+    const double steering = 0.8*std::sin(0.01*(++cycle));
+    double front_left = steering, front_right = steering;
+    kinematics.handleSteeringSaturation(front_left, front_right);
+    benchmark::DoNotOptimize(front_left);
+    benchmark::DoNotOptimize(front_right);
+  }
+}
+BENCHMARK(BM_HandleSteeringSaturation);
+
+/// Whole update() on the fake robot, a shared memory command per cycle as from a local planner
+static void BM_ControllerUpdate(benchmark::State& state)
+{
+  std::ostringstream channel;
+  channel << "/ackermann_benchmark_cmd_" << getpid();
+
+  ros::NodeHandle root_nh;
+  ros::NodeHandle controller_nh("ackermann_controller");
+  controller_nh.setParam("shared_command_channel", channel.str());
+
+  Ackermann robot;
+  ackermann_controller::AckermannController controller;
+  std::set<std::string> claimed_resources;
+  if (!controller.initRequest(&robot, root_nh, controller_nh, claimed_resources))
+  {
+    state.SkipWithError("Could not initialize the controller, is the test configuration loaded?");
+    return;
+  }
+
+  controller_realtime_utils::SharedCommandWriter command_writer;
+  command_writer.attach(channel.str());
+  controller_realtime_utils::SharedCommand command;
+  command.speed = 1.0;
+  command.angular = 0.2;
+  command.front_steering = 0.2;
+
+  ros::Time time(1.0);
+  const ros::Duration period = robot.getPeriod();
+  controller.startRequest(time);
+  for (auto _ : state)
+  {
+    time += period;
+    command_writer.write(command);
+    controller.updateRequest(time, period);
+    robot.write();
+  }
+
+  controller.stopRequest(time);
+  shm_unlink(channel.str().c_str());
+}
+BENCHMARK(BM_ControllerUpdate);
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "ackermann_benchmark");
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  ros::shutdown();
+  return 0;
+}
@@ -1,17 +1,31 @@
 
+#include <atomic>
+
+#include <boost/thread/thread.hpp>
+
 #include <controller_interface/controller_base.h>
 #include <hardware_interface/joint_command_interface.h>
 #include <pluginlib/class_list_macros.h>
 
+#include <geometry_msgs/TwistStamped.h>
 #include <nav_msgs/Odometry.h>
-#include <ackermann_msgs/AckermannDrive.h>
-#include <tf/tfMessage.h>
-
-#include <realtime_tools/realtime_buffer.h>
-#include <realtime_tools/realtime_publisher.h>
+#include <std_msgs/Bool.h>
+#include <ackermann_msgs/AckermannDriveStamped.h>
+#include <four_wheel_steering_msgs/GetPoseAtTime.h>
 
 #include <ackermann_controller/odometry.h>
-#include <ackermann_controller/speed_limiter.h>
+
+#include <controller_realtime_utils/command_queue.h>
+#include <controller_realtime_utils/cycle_diagnostics.h>
+#include <controller_realtime_utils/jerk_limited_profile.h>
+#include <controller_realtime_utils/odometry_publisher.h>
+#include <controller_realtime_utils/persistent_state.h>
+#include <controller_realtime_utils/realtime_logger.h>
+#include <controller_realtime_utils/shared_command_channel.h>
+#include <controller_realtime_utils/shared_odometry.h>
+#include <controller_realtime_utils/speed_limiter.h>
+
+#include <vehicle_kinematics/ackermann_kinematics.h>
 
 namespace ackermann_controller{
 
@@ -31,6 +45,9 @@ namespace ackermann_controller{
   public:
     AckermannController();
 
+    /// Waits for a configuration still running in the background
+    ~AckermannController();
+
     /**
      * \brief Initialize controller
      * \param robot_hw          Velocity joint interface for the wheels
@@ -48,11 +65,29 @@ namespace ackermann_controller{
       return "";
     }
 
+    /**
+     * \brief Gets the joint handles, then configures the controller, in the background
+     *        if the async_init parameter is set: initRequest then returns without waiting
+     *        for the parameters, the URDF and the publishers, and the controller brakes
+     *        until it is ready
+     */
     bool init(hardware_interface::PositionJointInterface* hw_pos,
                                      hardware_interface::VelocityJointInterface* hw_vel,
                                      ros::NodeHandle& root_nh,
                                      ros::NodeHandle &controller_nh);
 
+    /// Whether the configuration is done, also published on the latched ready topic
+    bool isReady() const
+    {
+      return ready_.load(std::memory_order_acquire);
+    }
+
+    /// Whether the background configuration failed, the controller then brakes and is never ready
+    bool hasConfigurationFailed() const
+    {
+      return configuration_failed_.load(std::memory_order_acquire);
+    }
+
     /**
      * \brief Updates controller, i.e. computes the odometry and sets the new velocity commands
      * \param time   Current time
@@ -85,29 +120,51 @@ namespace ackermann_controller{
     std::vector<hardware_interface::JointHandle> rear_wheel_joints_;
     std::vector<hardware_interface::JointHandle> front_steering_joints_;
 
-    /// Velocity command related:
+    /// Velocity command related, the axes of the commands:
+    enum LimitedAxis { LINEAR, ANGULAR, STEERING, LIMITED_AXES };
     struct Commands
     {
       double lin;
       double ang;
       double steering;
       ros::Time stamp;
+      /// Transitions to the values of the command, planned on arrival:
+      controller_realtime_utils::JerkLimitedProfile profiles[LIMITED_AXES];
+      bool has_profiles;
 
-      Commands() : lin(0.0), ang(0.0), steering(0.0), stamp(0.0) {}
+      Commands() : lin(0.0), ang(0.0), steering(0.0), stamp(0.0), has_profiles(false) {}
     };
-    realtime_tools::RealtimeBuffer<Commands> command_;
-    Commands command_struct_;
+    /// Whether the commands are reached through jerk limited transitions, and the
+    /// last planned command (subscriber callback only):
+    bool smooth_commands_;
+    Commands planned_cmd_;
+    /// Stamp of the last queued command, the older ones are dropped (subscriber callback only):
+    ros::Time last_queued_stamp_;
+    /// Commands waiting for their time, whichever their message type:
+    controller_realtime_utils::CommandQueue<Commands> command_;
+    /// Last applied command (real-time thread only):
+    Commands current_cmd_;
     ros::Subscriber sub_command_;
 
+    /// Commands from a planner on the same machine, bypassing the ROS middleware, the command
+    /// queue and the smoothing (see SharedCommand):
+    controller_realtime_utils::SharedCommandReader shared_command_reader_;
+    uint64_t shared_commands_lost_;
+
     /// Ackermann command related:
-    realtime_tools::RealtimeBuffer<Commands> command_ackermann_;
-    Commands command_struct_ackermann_;
     ros::Subscriber sub_command_ackermann_;
 
     /// Odometry related:
-    boost::shared_ptr<realtime_tools::RealtimePublisher<nav_msgs::Odometry> > odom_pub_;
-    boost::shared_ptr<realtime_tools::RealtimePublisher<tf::tfMessage> > tf_odom_pub_;
+    controller_realtime_utils::OdometryPublisher odom_publisher_;
     Odometry odometry_;
+    ros::ServiceServer get_pose_at_time_service_;
+    /// Every odometry sample for the processes on the same machine, the inputs are
+    /// front wheel position and velocity, rear wheel position and velocity, virtual front steering:
+    controller_realtime_utils::SharedOdometryWriter shared_odometry_writer_;
+    /// Odometry state saved every update, restored when starting:
+    controller_realtime_utils::PersistentState<Odometry::State> odom_state_;
+    /// Largest wheel travel from the saved wheel positions still integrated when restoring [m]:
+    double odom_state_max_wheel_travel_;
 
 
     /// Wheel separation (or track), distance between left and right wheels (from the midpoint of the wheel width):
@@ -122,9 +179,15 @@ namespace ackermann_controller{
     /// Wheel base (distance between front and rear wheel):
     double wheel_base_;
 
+    /// Inverse kinematics used to compute the wheel commands:
+    vehicle_kinematics::AckermannKinematics<double> kinematics_;
+
     /// Timeout to consider cmd_vel commands old:
     double cmd_vel_timeout_;
 
+    /// Delay between a command stamp and its application, absorbs the network jitter:
+    ros::Duration cmd_delay_;
+
     /// Frame to use for the robot base:
     std::string base_frame_id_;
 
@@ -134,13 +197,51 @@ namespace ackermann_controller{
     /// Whether the control is make with ackermann msg or twist msg:
     bool enable_twist_cmd_;
 
-    /// Speed limiters:
+    /// Whether the commands are stamped by their sender or on arrival:
+    bool enable_stamped_cmd_;
+
+    /// Speed limiter, over the axes of the commands:
     Commands last1_cmd_;
     Commands last0_cmd_;
-    SpeedLimiter limiter_lin_;
-    SpeedLimiter limiter_ang_;
+    controller_realtime_utils::SpeedLimiter<double, LIMITED_AXES> limiter_;
+
+    /// Traces of the update loop, formatted outside of the real-time thread:
+    controller_realtime_utils::RealtimeLogger rt_logger_;
+    /// The per-cycle traces are pushed once per second:
+    controller_realtime_utils::LogThrottle trace_throttle_;
+
+    /// Execution time and period statistics of update():
+    controller_realtime_utils::CycleDiagnostics cycle_diagnostics_;
+
+    /// Set once configured, the other members are then left to the real-time thread:
+    std::atomic<bool> ready_;
+    /// Set if the background configuration failed:
+    std::atomic<bool> configuration_failed_;
+    ros::Publisher ready_pub_;
+    boost::thread configuration_thread_;
+    /// Whether the controller was started before being ready (real-time thread only):
+    bool start_pending_;
 
   private:
+    /**
+     * \brief Reads the parameters, derives the geometry from the URDF and sets up the
+     *        publishers and subscribers, then marks the controller ready (non real-time)
+     * \param root_nh       Node handle at root namespace
+     * \param controller_nh Node handle inside the controller namespace
+     * \return false if the configuration is invalid
+     */
+    bool configure(ros::NodeHandle root_nh, ros::NodeHandle controller_nh);
+
+    /// Runs configure() in the configuration thread
+    void configureInBackground(ros::NodeHandle root_nh, ros::NodeHandle controller_nh);
+
+    /**
+     * \brief Resets the commands and the odometry for a new run, from starting(),
+     *        or from the first update once ready if the controller was started before
+     * \param time Current time
+     */
+    void startRunning(const ros::Time& time);
+
     /**
      * \brief Brakes the wheels, i.e. sets the velocity to 0
      */
@@ -152,12 +253,37 @@ namespace ackermann_controller{
      */
     void cmdVelCallback(const geometry_msgs::Twist& command);
 
+    /**
+     * \brief Stamped velocity command callback
+     * \param command Velocity command message (twist), applied at its stamp
+     */
+    void cmdVelStampedCallback(const geometry_msgs::TwistStamped& command);
+
     /**
      * \brief Velocity command callback
-     * \param command Velocity command message (twist)
+     * \param command Velocity command message (ackermann)
      */
     void cmdAckermannCallback(const ackermann_msgs::AckermannDrive& command);
 
+    /**
+     * \brief Stamped velocity command callback
+     * \param command Velocity command message (ackermann), applied at its stamp
+     */
+    void cmdAckermannStampedCallback(const ackermann_msgs::AckermannDriveStamped& command);
+
+    /**
+     * \brief Queues a command for the real-time loop
+     * \param command Command, stamped on arrival if its stamp is zero or more than
+     *                cmd_vel_timeout ahead of the clock, dropped if older than the last one
+     */
+    void queueCommand(Commands command);
+
+    /**
+     * \brief Plans the transitions from the last planned command to a new one (non real-time)
+     * \param command Command, stamped
+     */
+    void planProfiles(Commands& command);
+
     /**
      * \brief Get the wheel names from a wheel param
      * \param [in]  controller_nh Controller node handler
@@ -170,6 +296,14 @@ namespace ackermann_controller{
                        const std::string& wheel_param,
                        std::vector<std::string>& wheel_names);
 
+    /**
+     * \brief Odometry pose at a past time service callback (non real-time)
+     * \param request  Time of the pose
+     * \param response Pose interpolated from the odometry history
+     */
+    bool getPoseAtTimeCallback(four_wheel_steering_msgs::GetPoseAtTime::Request& request,
+                               four_wheel_steering_msgs::GetPoseAtTime::Response& response);
+
     /**
      * \brief Sets the odometry publishing fields
      * \param root_nh Root node handle
@@ -177,20 +311,6 @@ namespace ackermann_controller{
      */
     void setOdomPubFields(ros::NodeHandle& root_nh, ros::NodeHandle& controller_nh);
 
-    /**
-     * \brief Update the steering command with steering joint limitation to handle saturation
-     * \f[ tan(\delta_{FR})=\frac{wheel_base}{\frac{wheel\_base}{tan(\delta_{FL})}+track)}
-     * \f]
-     * \f[ tan(\delta_{FL})=\frac{wheel_base}
-     *                           {\frac{wheel\_base}
-     *                                 {tan(\delta_{FR})}
-     *                           -track)}
-     * \f]
-     * \param front_left_steering \f$ \delta_{FL} \f$
-     * \param front_right_steering \f$ \delta_{FR}  \f$
-     */
-    void handleSteeringSaturation(double& front_left_steering, double& front_right_steering);
-
   };
 
   PLUGINLIB_EXPORT_CLASS(ackermann_controller::AckermannController, controller_interface::ControllerBase);
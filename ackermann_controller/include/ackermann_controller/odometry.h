@@ -3,15 +3,15 @@
 #define ODOMETRY_H_
 
 #include <ros/time.h>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
-#include <boost/accumulators/statistics/rolling_mean.hpp>
 #include <boost/function.hpp>
 
+#include <controller_realtime_utils/pose_history.h>
+#include <controller_realtime_utils/rolling_window.h>
+
+#include <vehicle_kinematics/pose_integration.h>
+
 namespace ackermann_controller
 {
-  namespace bacc = boost::accumulators;
-
   /**
    * \brief The Odometry class handles odometry readings
    * (2D pose and velocity with related timestamp)
@@ -23,6 +23,15 @@ namespace ackermann_controller
     /// Integration function, used to integrate the odometry:
     typedef boost::function<void(double, double)> IntegrationFunction;
 
+    /// State kept across restarts of the controller:
+    struct State
+    {
+      double x;          //   [m]
+      double y;          //   [m]
+      double heading;    // [rad]
+      double wheel_pos;  // rear wheel travelled distance [m]
+    };
+
     /**
      * \brief Constructor
      * Timestamp will get the current time value
@@ -88,7 +97,7 @@ namespace ackermann_controller
 
     /**
      * \brief linear velocity getter
-     * \return linear velocity [m/s]
+     * \return linear velocity [m/s], mean over the velocity rolling window in closed loop
      */
     double getLinear() const
     {
@@ -97,13 +106,31 @@ namespace ackermann_controller
 
     /**
      * \brief angular velocity getter
-     * \return angular velocity [rad/s]
+     * \return angular velocity [rad/s], mean over the velocity rolling window in closed loop
      */
     double getAngular() const
     {
       return angular_;
     }
 
+    /**
+     * \brief Unfiltered linear velocity getter, for the control law: the rolling mean would lag
+     * \return linear velocity of the last update [m/s]
+     */
+    double getRawLinear() const
+    {
+      return raw_linear_;
+    }
+
+    /**
+     * \brief Unfiltered angular velocity getter, for the control law: the rolling mean would lag
+     * \return angular velocity of the last update [rad/s]
+     */
+    double getRawAngular() const
+    {
+      return raw_angular_;
+    }
+
     /**
      * \brief Sets the wheel parameters: radius and separation
      * \param track Seperation between left and right wheels [m]
@@ -113,17 +140,51 @@ namespace ackermann_controller
      */
     void setWheelParams(double track, double front_wheel_radius, double rear_wheel_radius, double wheel_base);
 
+    /**
+     * \brief State getter, to be saved
+     * \return pose and last wheel position
+     */
+    State getState() const;
+
+    /**
+     * \brief Restores a saved state, after init()
+     * The next update() integrates the wheel displacement from the saved position, unless
+     * the wheel travelled further, as when the encoder was reset: it then only takes the
+     * new position as the baseline.
+     * \param state            Pose and last wheel position
+     * \param max_wheel_travel Largest travel of the wheel since the saved position [m]
+     */
+    void setState(const State& state, double max_wheel_travel);
+
+    /**
+     * \brief Pose at a past time, interpolated from the pose history (thread safe)
+     * \param [in]  time    Time of the pose
+     * \param [out] x       x position [m]
+     * \param [out] y       y position [m]
+     * \param [out] heading heading [rad]
+     * \return false if time is not covered by the history
+     */
+    bool getPoseAt(const ros::Time &time, double &x, double &y, double &heading) const;
+
+    /**
+     * \brief Pose history size setter, allocates the history (non real-time)
+     * \param history_size Number of poses kept, one per update
+     */
+    void setHistorySize(size_t history_size);
+
     /**
      * \brief Velocity rolling window size setter
      * \param velocity_rolling_window_size Velocity rolling window size
      */
     void setVelocityRollingWindowSize(size_t velocity_rolling_window_size);
 
-  private:
+    /**
+     * \brief Integration method setter, used by update() (exact by default)
+     * \param method Integration method
+     */
+    void setIntegrationMethod(vehicle_kinematics::IntegrationMethod method);
 
-    /// Rolling mean accumulator and window:
-    typedef bacc::accumulator_set<double, bacc::stats<bacc::tag::rolling_mean> > RollingMeanAcc;
-    typedef bacc::tag::rolling_window RollingWindow;
+  private:
 
     /**
      * \brief Integrates the velocities (linear and angular) using 2nd order Runge-Kutta
@@ -155,6 +216,9 @@ namespace ackermann_controller
     /// Current velocity:
     double linear_;  //   [m/s]
     double angular_; // [rad/s]
+    /// Velocity of the last update, before the rolling mean:
+    double raw_linear_;  //   [m/s]
+    double raw_angular_; // [rad/s]
 
     /// Wheel kinematic parameters [m]:
     double track_;
@@ -165,11 +229,22 @@ namespace ackermann_controller
     double left_wheel_old_pos_;
     double right_wheel_old_pos_;
     double wheel_old_pos_;
+    bool has_wheel_old_pos_;
+    /// Largest wheel travel [m] from the position restored by setState(), negative once checked:
+    double restored_wheel_travel_limit_;
+
+    /// Integration of the wheel displacement in update(), with the steering of the previous update:
+    vehicle_kinematics::IntegrationMethod integration_method_;
+    double front_steering_old_;
+    bool has_front_steering_old_;
 
     /// Rolling mean accumulators for the linar and angular velocities:
     size_t velocity_rolling_window_size_;
-    RollingMeanAcc linear_acc_;
-    RollingMeanAcc angular_acc_;
+    controller_realtime_utils::RollingWindow<double> linear_acc_;
+    controller_realtime_utils::RollingWindow<double> angular_acc_;
+
+    /// Poses of the last updates, for the lookups by time:
+    controller_realtime_utils::PoseHistory history_;
   };
 }
 
@@ -1,31 +1,51 @@
+#include <algorithm>
 #include <cmath>
 
-#include <tf/transform_datatypes.h>
+#include <boost/bind.hpp>
 
 #include <urdf_parser/urdf_parser.h>
 
-#include <boost/assign.hpp>
-
 #include <urdf_vehicle_kinematic/urdf_vehicle_kinematic.h>
 
 #include <ackermann_controller/ackermann_controller.h>
 
 namespace ackermann_controller{
 
+  /// Commands received in a burst are kept until their time comes, up to:
+  static const std::size_t COMMAND_QUEUE_SIZE = 64;
+
+  /// Odometry samples kept for the local consumers, a second at 1 kHz:
+  static const std::size_t SHARED_ODOMETRY_SIZE = 1024;
+  static const std::size_t ODOM_SAMPLES_QUEUE_SIZE = 1024;
+
   AckermannController::AckermannController()
     : open_loop_(false)
-    , command_struct_()
-    , command_struct_ackermann_()
+    , smooth_commands_(false)
+    , command_(COMMAND_QUEUE_SIZE)
+    , current_cmd_()
+    , shared_commands_lost_(0)
+    , odom_state_max_wheel_travel_(1.0)
     , track_(0.0)
     , front_wheel_radius_(0.0)
     , rear_wheel_radius_(0.0)
     , steering_limit_(0.0)
     , wheel_base_(0.0)
     , cmd_vel_timeout_(0.5)
+    , cmd_delay_(0.0)
     , base_frame_id_("base_link")
     , enable_odom_tf_(true)
     , enable_twist_cmd_(false)
+    , enable_stamped_cmd_(false)
+    , ready_(false)
+    , configuration_failed_(false)
+    , start_pending_(false)
+  {
+  }
+
+  AckermannController::~AckermannController()
   {
+    if (configuration_thread_.joinable())
+      configuration_thread_.join();
   }
 
   bool AckermannController::initRequest(hardware_interface::RobotHW *const robot_hw,
@@ -86,6 +106,7 @@ namespace ackermann_controller{
     const std::string complete_ns = controller_nh.getNamespace();
     std::size_t id = complete_ns.find_last_of("/");
     name_ = complete_ns.substr(id + 1);
+    rt_logger_.start(name_);
 
     // Get joint names from the parameter server
     std::vector<std::string> front_wheel_names, rear_wheel_names;
@@ -132,6 +153,61 @@ namespace ackermann_controller{
       front_steering_joints_.resize(front_steering_names.size());
     }
 
+    // Get the joint object to use in the realtime loop
+    for (int i = 0; i < front_wheel_joints_.size(); ++i)
+    {
+      ROS_INFO_STREAM_NAMED(name_,
+                            "Adding front wheel with joint name: " << front_wheel_names[i]
+                            << " and rear wheel with joint name: " << rear_wheel_names[i]);
+      front_wheel_joints_[i] = hw_vel->getHandle(front_wheel_names[i]);  // throws on failure
+      rear_wheel_joints_[i] = hw_vel->getHandle(rear_wheel_names[i]);  // throws on failure
+    }
+
+    // Get the steering joint object to use in the realtime loop
+    for (int i = 0; i < front_steering_joints_.size(); ++i)
+    {
+      ROS_INFO_STREAM_NAMED(name_,
+                            "Adding front steering with joint name: " << front_steering_names[i]);
+      front_steering_joints_[i] = hw_pos->getHandle(front_steering_names[i]);  // throws on failure
+    }
+
+    // Whoever waits for the controller is told when it is configured
+    ready_pub_ = controller_nh.advertise<std_msgs::Bool>("ready", 1, true);
+    std_msgs::Bool ready;
+    ready.data = false;
+    ready_pub_.publish(ready);
+
+    bool async_init = false;
+    controller_nh.param("async_init", async_init, async_init);
+    if (!async_init)
+      return configure(root_nh, controller_nh);
+
+    ROS_INFO_STREAM_NAMED(name_, "Configuring in the background, braking until ready.");
+    configuration_thread_ = boost::thread(&AckermannController::configureInBackground, this,
+                                          root_nh, controller_nh);
+    return true;
+  }
+
+  void AckermannController::configureInBackground(ros::NodeHandle root_nh, ros::NodeHandle controller_nh)
+  {
+    if (configure(root_nh, controller_nh))
+      return;
+    configuration_failed_.store(true, std::memory_order_release);
+    ROS_ERROR_STREAM_NAMED(name_, "Failed to configure the controller in the background, it only brakes "
+                          "and is never ready, fix the configuration and load it again.");
+  }
+
+  bool AckermannController::configure(ros::NodeHandle root_nh, ros::NodeHandle controller_nh)
+  {
+    std::vector<std::string> front_wheel_names, rear_wheel_names, front_steering_names;
+    for (size_t i = 0; i < front_wheel_joints_.size(); ++i)
+    {
+      front_wheel_names.push_back(front_wheel_joints_[i].getName());
+      rear_wheel_names.push_back(rear_wheel_joints_[i].getName());
+    }
+    for (size_t i = 0; i < front_steering_joints_.size(); ++i)
+      front_steering_names.push_back(front_steering_joints_[i].getName());
+
     // Odometry related:
     double publish_rate;
     controller_nh.param("publish_rate", publish_rate, 50.0);
@@ -139,15 +215,45 @@ namespace ackermann_controller{
                           << publish_rate << "Hz.");
     publish_period_ = ros::Duration(1.0 / publish_rate);
 
+    double diagnostics_period = 1.0;
+    controller_nh.param("diagnostics_period", diagnostics_period, diagnostics_period);
+    ROS_INFO_STREAM_NAMED(name_, "Cycle diagnostics will be published every "
+                          << diagnostics_period << "s.");
+    cycle_diagnostics_.addCounter("Odometry snapshots skipped",
+                                  boost::bind(&controller_realtime_utils::OdometryPublisher::skippedSnapshots,
+                                              &odom_publisher_));
+    cycle_diagnostics_.addCounter("Odometry samples dropped",
+                                  boost::bind(&controller_realtime_utils::OdometryPublisher::droppedSamples,
+                                              &odom_publisher_));
+    cycle_diagnostics_.init(root_nh, name_, diagnostics_period);
+
     controller_nh.param("open_loop", open_loop_, open_loop_);
 
     int velocity_rolling_window_size = 10;
     controller_nh.param("velocity_rolling_window_size", velocity_rolling_window_size, velocity_rolling_window_size);
     ROS_INFO_STREAM_NAMED(name_, "Velocity rolling window size of "
-                          << velocity_rolling_window_size << ".");
+                          << velocity_rolling_window_size << ", for the published velocity only.");
 
     odometry_.setVelocityRollingWindowSize(velocity_rolling_window_size);
 
+    std::string odom_integration = "exact";
+    controller_nh.param("odom_integration", odom_integration, odom_integration);
+    vehicle_kinematics::IntegrationMethod integration_method;
+    if (!vehicle_kinematics::integrationMethodFromString(odom_integration, integration_method))
+    {
+      ROS_ERROR_STREAM_NAMED(name_,
+          "Unknown odometry integration '" << odom_integration << "', "
+          "use euler, runge_kutta_2, exact or runge_kutta_4.");
+      return false;
+    }
+    ROS_INFO_STREAM_NAMED(name_, "Odometry integrated with the " << odom_integration << " method.");
+    odometry_.setIntegrationMethod(integration_method);
+
+    int odom_history_size = 1000;
+    controller_nh.param("odom_history_size", odom_history_size, odom_history_size);
+    ROS_INFO_STREAM_NAMED(name_, "Keeping the last " << odom_history_size << " odometry poses.");
+    odometry_.setHistorySize(std::max(odom_history_size, 0));
+
     // Twist command related:
     controller_nh.param("cmd_vel_timeout", cmd_vel_timeout_, cmd_vel_timeout_);
     ROS_INFO_STREAM_NAMED(name_, "Velocity commands will be considered old if they are older than "
@@ -162,20 +268,22 @@ namespace ackermann_controller{
     controller_nh.param("enable_twist_cmd", enable_twist_cmd_, enable_twist_cmd_);
     ROS_INFO_STREAM_NAMED(name_, "Twist cmd is " << (enable_twist_cmd_?"enabled":"disabled")<<" (default is ackermann)");
 
-    // Velocity and acceleration limits:
-    controller_nh.param("linear/x/has_velocity_limits"    , limiter_lin_.has_velocity_limits    , limiter_lin_.has_velocity_limits    );
-    controller_nh.param("linear/x/has_acceleration_limits", limiter_lin_.has_acceleration_limits, limiter_lin_.has_acceleration_limits);
-    controller_nh.param("linear/x/max_velocity"           , limiter_lin_.max_velocity           ,  limiter_lin_.max_velocity          );
-    controller_nh.param("linear/x/min_velocity"           , limiter_lin_.min_velocity           , -limiter_lin_.max_velocity          );
-    controller_nh.param("linear/x/max_acceleration"       , limiter_lin_.max_acceleration       ,  limiter_lin_.max_acceleration      );
-    controller_nh.param("linear/x/min_acceleration"       , limiter_lin_.min_acceleration       , -limiter_lin_.max_acceleration      );
-
-    controller_nh.param("angular/z/has_velocity_limits"    , limiter_ang_.has_velocity_limits    , limiter_ang_.has_velocity_limits    );
-    controller_nh.param("angular/z/has_acceleration_limits", limiter_ang_.has_acceleration_limits, limiter_ang_.has_acceleration_limits);
-    controller_nh.param("angular/z/max_velocity"           , limiter_ang_.max_velocity           ,  limiter_ang_.max_velocity          );
-    controller_nh.param("angular/z/min_velocity"           , limiter_ang_.min_velocity           , -limiter_ang_.max_velocity          );
-    controller_nh.param("angular/z/max_acceleration"       , limiter_ang_.max_acceleration       ,  limiter_ang_.max_acceleration      );
-    controller_nh.param("angular/z/min_acceleration"       , limiter_ang_.min_acceleration       , -limiter_ang_.max_acceleration      );
+    controller_nh.param("enable_stamped_cmd", enable_stamped_cmd_, enable_stamped_cmd_);
+    ROS_INFO_STREAM_NAMED(name_, "Stamped cmd is " << (enable_stamped_cmd_?"enabled":"disabled"));
+
+    double cmd_delay = cmd_delay_.toSec();
+    controller_nh.param("cmd_delay", cmd_delay, cmd_delay);
+    cmd_delay_ = ros::Duration(cmd_delay);
+    ROS_INFO_STREAM_NAMED(name_, "Commands will be applied " << cmd_delay << "s after their stamp.");
+
+    // Velocity, acceleration and jerk limits:
+    controller_realtime_utils::readSpeedLimits(controller_nh, "linear/x", LINEAR, limiter_);
+    controller_realtime_utils::readSpeedLimits(controller_nh, "angular/z", ANGULAR, limiter_);
+    controller_realtime_utils::readSpeedLimits(controller_nh, "steering", STEERING, limiter_);
+
+    controller_nh.param("smooth_commands", smooth_commands_, smooth_commands_);
+    if (smooth_commands_)
+      ROS_INFO_STREAM_NAMED(name_, "Commands will be reached through jerk limited transitions.");
 
     // If either parameter is not available, we need to look up the value in the URDF
     bool lookup_track = !controller_nh.getParam("track", track_);
@@ -183,7 +291,20 @@ namespace ackermann_controller{
     bool lookup_rear_wheel_radius = !controller_nh.getParam("rear_wheel_radius", rear_wheel_radius_);
     bool lookup_wheel_base = !controller_nh.getParam("wheel_base", wheel_base_);
 
-    urdf_vehicle_kinematic::UrdfVehicleKinematic uvk(root_nh, base_frame_id_);
+    // Geometry derived from the URDF, kept across runs when a cache file is given
+    std::string geometry_cache_file;
+    controller_nh.param("geometry_cache_file", geometry_cache_file, geometry_cache_file);
+    // Only the wheel and steering joints are extracted from the URDF when selective
+    bool selective_urdf_parsing = false;
+    controller_nh.param("selective_urdf_parsing", selective_urdf_parsing, selective_urdf_parsing);
+    std::vector<std::string> geometry_joints;
+    if (selective_urdf_parsing)
+    {
+      geometry_joints.insert(geometry_joints.end(), front_wheel_names.begin(), front_wheel_names.end());
+      geometry_joints.insert(geometry_joints.end(), rear_wheel_names.begin(), rear_wheel_names.end());
+      geometry_joints.insert(geometry_joints.end(), front_steering_names.begin(), front_steering_names.end());
+    }
+    urdf_vehicle_kinematic::UrdfVehicleKinematic uvk(root_nh, base_frame_id_, geometry_cache_file, geometry_joints);
     if(lookup_track)
     {
       if(!uvk.getDistanceBetweenJoints(front_steering_names[0], front_steering_names[1], track_))
@@ -225,6 +346,8 @@ namespace ackermann_controller{
     const double ws = track_;
     const double wb = wheel_base_;
     odometry_.setWheelParams(ws, front_wheel_radius_, rear_wheel_radius_, wb);
+    kinematics_.setWheelParams(ws, front_wheel_radius_, rear_wheel_radius_, wb);
+    kinematics_.setSteeringLimit(steering_limit_);
     ROS_INFO_STREAM_NAMED(name_,
                           "Odometry params : wheel separation " << ws
                           << ", front wheel radius " << front_wheel_radius_
@@ -232,36 +355,80 @@ namespace ackermann_controller{
                           << ", wheel base " << wb);
 
     setOdomPubFields(root_nh, controller_nh);
+    odom_publisher_.start();
 
-    // Get the joint object to use in the realtime loop
-    for (int i = 0; i < front_wheel_joints_.size(); ++i)
+    std::string shared_odometry_channel;
+    controller_nh.param("shared_odometry_channel", shared_odometry_channel, shared_odometry_channel);
+    if (!shared_odometry_channel.empty())
     {
-      ROS_INFO_STREAM_NAMED(name_,
-                            "Adding front wheel with joint name: " << front_wheel_names[i]
-                            << " and rear wheel with joint name: " << rear_wheel_names[i]);
-      front_wheel_joints_[i] = hw_vel->getHandle(front_wheel_names[i]);  // throws on failure
-      rear_wheel_joints_[i] = hw_vel->getHandle(rear_wheel_names[i]);  // throws on failure
+      if (!shared_odometry_writer_.open(shared_odometry_channel, SHARED_ODOMETRY_SIZE))
+        return false;
+      ROS_INFO_STREAM_NAMED(name_, "Writing every odometry sample to shared memory " << shared_odometry_channel);
     }
 
-    // Get the steering joint object to use in the realtime loop
-    for (int i = 0; i < front_steering_joints_.size(); ++i)
+    std::string odom_state_file;
+    controller_nh.param("odom_state_file", odom_state_file, odom_state_file);
+    if (!odom_state_file.empty())
     {
-      ROS_INFO_STREAM_NAMED(name_,
-                            "Adding front steering with joint name: " << front_steering_names[i]);
-      front_steering_joints_[i] = hw_pos->getHandle(front_steering_names[i]);  // throws on failure
+      if (!odom_state_.open(odom_state_file))
+        return false;
+      controller_nh.param("odom_state_max_wheel_travel", odom_state_max_wheel_travel_, odom_state_max_wheel_travel_);
+      ROS_INFO_STREAM_NAMED(name_, "Odometry state kept in " << odom_state_file
+                            << ", the wheel positions are restored up to " << odom_state_max_wheel_travel_ << "m away");
     }
 
-    if(enable_twist_cmd_ == true)
-      sub_command_ = controller_nh.subscribe("cmd_vel", 1, &AckermannController::cmdVelCallback, this);
+    std::string shared_command_channel;
+    controller_nh.param("shared_command_channel", shared_command_channel, shared_command_channel);
+    if (!shared_command_channel.empty())
+    {
+      if (!shared_command_reader_.open(shared_command_channel, COMMAND_QUEUE_SIZE))
+        return false;
+      ROS_INFO_STREAM_NAMED(name_, "Reading commands from shared memory " << shared_command_channel);
+      if (smooth_commands_ || cmd_delay_.toSec() != 0.0)
+        ROS_WARN_STREAM_NAMED(name_, "The shared memory commands are applied as they are read, "
+                              "cmd_delay and smooth_commands only apply to the commands of the topics.");
+    }
+
+    // The subscriber queues are as long as the command queue not to drop the bursts
+    const uint32_t queue_size = command_.capacity();
+    if(enable_twist_cmd_ == true && enable_stamped_cmd_ == true)
+      sub_command_ = controller_nh.subscribe("cmd_vel_stamped", queue_size, &AckermannController::cmdVelStampedCallback, this);
+    else if(enable_twist_cmd_ == true)
+      sub_command_ = controller_nh.subscribe("cmd_vel", queue_size, &AckermannController::cmdVelCallback, this);
+    else if(enable_stamped_cmd_ == true)
+      sub_command_ackermann_ = controller_nh.subscribe("cmd_ackermann_stamped", queue_size, &AckermannController::cmdAckermannStampedCallback, this);
     else
-      sub_command_ackermann_ = controller_nh.subscribe("cmd_ackermann", 1, &AckermannController::cmdAckermannCallback, this);
+      sub_command_ackermann_ = controller_nh.subscribe("cmd_ackermann", queue_size, &AckermannController::cmdAckermannCallback, this);
 
+    get_pose_at_time_service_ = controller_nh.advertiseService("get_pose_at_time", &AckermannController::getPoseAtTimeCallback, this);
+
+    ready_.store(true, std::memory_order_release);
+    std_msgs::Bool ready;
+    ready.data = true;
+    ready_pub_.publish(ready);
+    ROS_INFO_STREAM_NAMED(name_, "Configured, ready.");
     return true;
   }
 
   void AckermannController::update(const ros::Time& time, const ros::Duration& period)
   {
+    // Nothing but the joint handles can be used before the configuration is done, or if it failed
+    if (!ready_.load(std::memory_order_acquire))
+    {
+      brake();
+      return;
+    }
+    if (start_pending_)
+    {
+      start_pending_ = false;
+      startRunning(time);
+    }
+    const bool trace = trace_throttle_.ready(time);
+
+    controller_realtime_utils::ScopedCycleTimer cycle_timer(cycle_diagnostics_, period);
+
     // COMPUTE AND PUBLISH ODOMETRY
+    controller_realtime_utils::SharedOdometrySample odometry_sample;
     if (open_loop_)
     {
       odometry_.updateOpenLoop(last0_cmd_.lin, last0_cmd_.ang, time);
@@ -299,58 +466,86 @@ namespace ackermann_controller{
         front_left_steering_pos = front_steering_joints_[0].getPosition();
         front_right_steering_pos = front_steering_joints_[1].getPosition();
       }
-      double front_steering_pos = 0.0;
-      if(fabs(front_left_steering_pos) > 0.001 || fabs(front_right_steering_pos) > 0.001)
-      {
-        front_steering_pos = atan(2*tan(front_left_steering_pos)*tan(front_right_steering_pos)/
-                                        (tan(front_left_steering_pos) + tan(front_right_steering_pos)));
-      }
-      ROS_DEBUG_STREAM_THROTTLE(1, "front_left_steering_pos "<<front_left_steering_pos<<" front_right_steering_pos "<<front_right_steering_pos<<" front_steering_pos "<<front_steering_pos);
+      const double front_steering_pos = vehicle_kinematics::virtualSteeringAngle(front_left_steering_pos,
+                                                                                 front_right_steering_pos);
+      if (trace)
+        rt_logger_.debug("front_left_steering_pos %f front_right_steering_pos %f front_steering_pos %f",
+                         front_left_steering_pos, front_right_steering_pos, front_steering_pos);
       // Estimate linear and angular velocity using joint information
       odometry_.update(front_pos, front_vel, rear_pos, rear_vel, front_steering_pos, time);
+
+      odometry_sample.input_count = 5;
+      odometry_sample.inputs[0] = front_pos;
+      odometry_sample.inputs[1] = front_vel;
+      odometry_sample.inputs[2] = rear_pos;
+      odometry_sample.inputs[3] = rear_vel;
+      odometry_sample.inputs[4] = front_steering_pos;
     }
 
-    // Publish odometry message
+    // Every sample goes to the local consumers, odom and tf are decimated to publish_rate
+    if (shared_odometry_writer_.isOpen())
+    {
+      odometry_sample.stamp = time.toSec();
+      odometry_sample.x = odometry_.getX();
+      odometry_sample.y = odometry_.getY();
+      odometry_sample.heading = odometry_.getHeading();
+      odometry_sample.linear_x = odometry_.getLinear();
+      odometry_sample.angular = odometry_.getAngular();
+      shared_odometry_writer_.write(odometry_sample);
+    }
+
+    odom_state_.store(odometry_.getState());
+
+    odom_publisher_.addSample(time, odometry_.getX(), odometry_.getY(), odometry_.getHeading(),
+                              odometry_.getLinear(), 0.0, odometry_.getAngular());
+
+    // Publish odometry message, the message itself is built and sent by the publisher thread
     if (last_state_publish_time_ + publish_period_ < time)
     {
       last_state_publish_time_ += publish_period_;
-      // Compute and store orientation info
-      const geometry_msgs::Quaternion orientation(
-            tf::createQuaternionMsgFromYaw(odometry_.getHeading()));
+      odom_publisher_.update(time, odometry_.getX(), odometry_.getY(), odometry_.getHeading(),
+                             odometry_.getLinear(), 0.0, odometry_.getAngular());
+    }
 
-      // Populate odom message and publish
-      if (odom_pub_->trylock())
-      {
-        odom_pub_->msg_.header.stamp = time;
-        odom_pub_->msg_.pose.pose.position.x = odometry_.getX();
-        odom_pub_->msg_.pose.pose.position.y = odometry_.getY();
-        odom_pub_->msg_.pose.pose.orientation = orientation;
-        odom_pub_->msg_.twist.twist.linear.x  = odometry_.getLinear();
-        odom_pub_->msg_.twist.twist.angular.z = odometry_.getAngular();
-        odom_pub_->unlockAndPublish();
-      }
+    // MOVE ROBOT
+    // Apply in order the commands whose time has come:
+    Commands due_cmd;
+    while (command_.popDue(time, cmd_delay_, due_cmd))
+    {
+      current_cmd_ = due_cmd;
+      cycle_diagnostics_.addCommandLatency((time - due_cmd.stamp).toSec());
+    }
 
-      // Publish tf /odom frame
-      if (enable_odom_tf_ && tf_odom_pub_->trylock())
-      {
-        geometry_msgs::TransformStamped& odom_frame = tf_odom_pub_->msg_.transforms[0];
-        odom_frame.header.stamp = time;
-        odom_frame.transform.translation.x = odometry_.getX();
-        odom_frame.transform.translation.y = odometry_.getY();
-        odom_frame.transform.rotation = orientation;
-        tf_odom_pub_->unlockAndPublish();
-      }
+    // Commands written in shared memory are applied as soon as they are read, without cmd_delay
+    // nor smoothing: their stamp only serves the timeout and the latency
+    controller_realtime_utils::SharedCommand shared_cmd;
+    while (shared_command_reader_.read(shared_cmd))
+    {
+      current_cmd_.lin = shared_cmd.speed;
+      current_cmd_.ang = shared_cmd.angular;
+      current_cmd_.steering = shared_cmd.front_steering;
+      current_cmd_.stamp = shared_cmd.stamp > 0.0 ? ros::Time(shared_cmd.stamp) : time;
+      current_cmd_.has_profiles = false;
+      cycle_diagnostics_.addCommandLatency((time - current_cmd_.stamp).toSec());
+    }
+    if (shared_command_reader_.lost() != shared_commands_lost_)
+    {
+      shared_commands_lost_ = shared_command_reader_.lost();
+      rt_logger_.warn("%g shared memory commands overwritten before being read", shared_commands_lost_);
     }
 
-    // MOVE ROBOT
-    // Retreive current velocity command and time step:
-    Commands curr_cmd;
-    if(enable_twist_cmd_ == false)
-      curr_cmd = *(command_ackermann_.readFromRT());
-    else
-      curr_cmd = *(command_.readFromRT());
+    Commands curr_cmd = current_cmd_;
 
-    const double dt = (time - curr_cmd.stamp).toSec();
+    // Follow the transitions planned when the command arrived
+    if (curr_cmd.has_profiles)
+    {
+      double rate;
+      curr_cmd.profiles[LINEAR].sample(time.toSec(), curr_cmd.lin, rate);
+      curr_cmd.profiles[ANGULAR].sample(time.toSec(), curr_cmd.ang, rate);
+      curr_cmd.profiles[STEERING].sample(time.toSec(), curr_cmd.steering, rate);
+    }
+
+    const double dt = (time - curr_cmd.stamp - cmd_delay_).toSec();
 
     // Brake if cmd_vel has timeout:
     if (dt > cmd_vel_timeout_)
@@ -363,60 +558,49 @@ namespace ackermann_controller{
     // Limit velocities and accelerations:
     const double cmd_dt(period.toSec());
 
-    limiter_lin_.limit(curr_cmd.lin, last0_cmd_.lin, last1_cmd_.lin, cmd_dt);
-    limiter_ang_.limit(curr_cmd.ang, last0_cmd_.ang, last1_cmd_.ang, cmd_dt);
+    double limited_cmd[LIMITED_AXES] = {curr_cmd.lin, curr_cmd.ang, curr_cmd.steering};
+    const double last0_cmd[LIMITED_AXES] = {last0_cmd_.lin, last0_cmd_.ang, last0_cmd_.steering};
+    const double last1_cmd[LIMITED_AXES] = {last1_cmd_.lin, last1_cmd_.ang, last1_cmd_.steering};
+    limiter_.limit(limited_cmd, last0_cmd, last1_cmd, cmd_dt);
+    curr_cmd.lin = limited_cmd[LINEAR];
+    curr_cmd.ang = limited_cmd[ANGULAR];
+    curr_cmd.steering = limited_cmd[STEERING];
 
     last1_cmd_ = last0_cmd_;
     last0_cmd_ = curr_cmd;
 
 
-    const double angular_speed = odometry_.getAngular();
+    // The control law uses the velocity of the last update, the published one is filtered
+    const double angular_speed = odometry_.getRawAngular();
 
-    ROS_DEBUG_STREAM("angular_speed "<<angular_speed<<" curr_cmd.lin "<<curr_cmd.lin);
+    if (trace)
+      rt_logger_.debug("angular_speed %f curr_cmd.lin %f", angular_speed, curr_cmd.lin);
     // Compute wheels velocities:
     // TODO should use angular cmd instead of angular odom and differenciate twist and ackermann cmd
-    const double vel_left_front  = copysign(1.0, curr_cmd.lin) *
-                                   sqrt((pow((curr_cmd.lin - angular_speed*track_/2),2)
-                                         +pow(wheel_base_*angular_speed,2)))/front_wheel_radius_;
-    const double vel_right_front = copysign(1.0, curr_cmd.lin) *
-                                   sqrt((pow((curr_cmd.lin + angular_speed*track_/2),2)+
-                                         pow(wheel_base_*angular_speed,2)))/front_wheel_radius_;
-    const double vel_left_rear = (curr_cmd.lin - angular_speed*track_/2)/rear_wheel_radius_;
-    const double vel_right_rear = (curr_cmd.lin + angular_speed*track_/2)/rear_wheel_radius_;
+    double wheels_vel[4];
+    kinematics_.wheelVelocities(curr_cmd.lin, angular_speed, wheels_vel);
     // Set wheels velocities:
     if(front_wheel_joints_.size() == 2 && rear_wheel_joints_.size() == 2)
     {
-      front_wheel_joints_[0].setCommand(vel_left_front);
-      rear_wheel_joints_[0].setCommand(vel_left_rear);
-      front_wheel_joints_[1].setCommand(vel_right_front);
-      rear_wheel_joints_[1].setCommand(vel_right_rear);
+      front_wheel_joints_[0].setCommand(wheels_vel[vehicle_kinematics::FRONT_LEFT]);
+      rear_wheel_joints_[0].setCommand(wheels_vel[vehicle_kinematics::REAR_LEFT]);
+      front_wheel_joints_[1].setCommand(wheels_vel[vehicle_kinematics::FRONT_RIGHT]);
+      rear_wheel_joints_[1].setCommand(wheels_vel[vehicle_kinematics::REAR_RIGHT]);
     }
 
     double front_left_steering = 0, front_right_steering = 0;
     if(enable_twist_cmd_ == true)
-    {
-      if(fabs(odometry_.getLinear()) > fabs(curr_cmd.ang*track_/2.0))
-      {
-        front_left_steering = atan(curr_cmd.ang*wheel_base_ /
-                                    (odometry_.getLinear() - curr_cmd.ang*track_/2.0));
-        front_right_steering = atan(curr_cmd.ang*wheel_base_ /
-                                     (odometry_.getLinear() + curr_cmd.ang*track_/2.0));
-      }
-    }
+      kinematics_.twistToSteering(odometry_.getRawLinear(), curr_cmd.ang, front_left_steering, front_right_steering);
     else
-    {
-      front_left_steering = atan2(tan(curr_cmd.steering),
-                                  1 - tan(curr_cmd.steering)*track_/(2*wheel_base_));
-      front_right_steering = atan2(tan(curr_cmd.steering),
-                                   1 + tan(curr_cmd.steering)*track_/(2*wheel_base_));
-    }
+      kinematics_.ackermannToSteering(curr_cmd.steering, front_left_steering, front_right_steering);
 
     /// check limits to not apply the same steering on right and left when saturated !
-    handleSteeringSaturation(front_left_steering, front_right_steering);
+    kinematics_.handleSteeringSaturation(front_left_steering, front_right_steering);
 
     if(front_steering_joints_.size() == 2)
     {
-      ROS_DEBUG_STREAM("front_left_steering "<<front_left_steering<<"front_right_steering "<<front_right_steering);
+      if (trace)
+        rt_logger_.debug("front_left_steering %f front_right_steering %f", front_left_steering, front_right_steering);
       front_steering_joints_[0].setCommand(front_left_steering);
       front_steering_joints_[1].setCommand(front_right_steering);
     }
@@ -426,14 +610,42 @@ namespace ackermann_controller{
   {
     brake();
 
+    if (configuration_failed_.load(std::memory_order_acquire))
+    {
+      rt_logger_.error("Started with a failed configuration, braking.");
+      start_pending_ = false;
+      return;
+    }
+    start_pending_ = !ready_.load(std::memory_order_acquire);
+    if (!start_pending_)
+      startRunning(time);
+  }
+
+  void AckermannController::startRunning(const ros::Time& time)
+  {
+    // Forget the commands of a previous run
+    command_.clear();
+    current_cmd_ = Commands();
+    controller_realtime_utils::SharedCommand shared_cmd;
+    while (shared_command_reader_.read(shared_cmd)) {}
+
     // Register starting time used to keep fixed rate
     last_state_publish_time_ = time;
 
     odometry_.init(time);
+
+    // Warm restart, go on from the pose of the previous run
+    Odometry::State odom_state;
+    if (odom_state_.load(odom_state))
+    {
+      odometry_.setState(odom_state, odom_state_max_wheel_travel_);
+      rt_logger_.info("Odometry restored at x %f y %f heading %f", odom_state.x, odom_state.y, odom_state.heading);
+    }
   }
 
   void AckermannController::stopping(const ros::Time& /*time*/)
   {
+    start_pending_ = false;
     brake();
   }
 
@@ -455,42 +667,104 @@ namespace ackermann_controller{
 
   void AckermannController::cmdVelCallback(const geometry_msgs::Twist& command)
   {
-    if (isRunning())
-    {
-      command_struct_.ang   = command.angular.z;
-      command_struct_.lin   = command.linear.x;
-      command_struct_.stamp = ros::Time::now();
-      command_.writeFromNonRT (command_struct_);
-      ROS_DEBUG_STREAM_NAMED(name_,
-                             "Added values to command. "
-                             << "Ang: "   << command_struct_.ang << ", "
-                             << "Lin: "   << command_struct_.lin << ", "
-                             << "Stamp: " << command_struct_.stamp);
-    }
-    else
+    Commands command_struct;
+    command_struct.ang = command.angular.z;
+    command_struct.lin = command.linear.x;
+    queueCommand(command_struct);
+  }
+
+  void AckermannController::cmdVelStampedCallback(const geometry_msgs::TwistStamped& command)
+  {
+    Commands command_struct;
+    command_struct.ang   = command.twist.angular.z;
+    command_struct.lin   = command.twist.linear.x;
+    command_struct.stamp = command.header.stamp;
+    queueCommand(command_struct);
+  }
+
+  void AckermannController::cmdAckermannCallback(const ackermann_msgs::AckermannDrive& command)
+  {
+    Commands command_struct;
+    command_struct.steering = command.steering_angle;
+    command_struct.lin      = command.speed;
+    queueCommand(command_struct);
+  }
+
+  void AckermannController::cmdAckermannStampedCallback(const ackermann_msgs::AckermannDriveStamped& command)
+  {
+    Commands command_struct;
+    command_struct.steering = command.drive.steering_angle;
+    command_struct.lin      = command.drive.speed;
+    command_struct.stamp    = command.header.stamp;
+    queueCommand(command_struct);
+  }
+
+  void AckermannController::queueCommand(Commands command)
+  {
+    if (!isRunning())
     {
       ROS_ERROR_NAMED(name_, "Can't accept new commands. Controller is not running.");
+      return;
+    }
+
+    // The queue applies the commands in order, one waiting for its time blocks the ones after it:
+    // a stamp too far ahead of the clock is taken as now, an older stamp than the last one is dropped
+    const ros::Time now = ros::Time::now();
+    const ros::Duration timeout(cmd_vel_timeout_);
+    if (command.stamp.isZero())
+      command.stamp = now;
+    else if (command.stamp > now + timeout)
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(1.0, name_, "Command stamped " << command.stamp << " is more than "
+                                     << cmd_vel_timeout_ << "s ahead of the clock, applied now");
+      command.stamp = now;
+    }
+    // Unless the clock went back, e.g. a simulation was restarted
+    if (last_queued_stamp_ > now + timeout)
+      last_queued_stamp_ = ros::Time();
+    if (command.stamp < last_queued_stamp_)
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(1.0, name_, "Dropped command stamped " << command.stamp
+                                     << ", older than the last one " << last_queued_stamp_);
+      return;
     }
+    last_queued_stamp_ = command.stamp;
+
+    if (smooth_commands_)
+      planProfiles(command);
+
+    if (!command_.push(command))
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(1.0, name_, "Command queue is full, dropped command stamped " << command.stamp);
+      return;
+    }
+    ROS_DEBUG_STREAM_NAMED(name_,
+                           "Added values to command. "
+                           << "Ang: "   << command.ang << ", "
+                           << "Steering: " << command.steering << ", "
+                           << "Lin: "   << command.lin << ", "
+                           << "Stamp: " << command.stamp);
   }
 
-  void AckermannController::cmdAckermannCallback(const ackermann_msgs::AckermannDrive& command)
+  void AckermannController::planProfiles(Commands& command)
   {
-    if (isRunning())
-    {
-      command_struct_ackermann_.steering   = command.steering_angle;
-      command_struct_ackermann_.lin   = command.speed;
-      command_struct_ackermann_.stamp = ros::Time::now();
-      command_ackermann_.writeFromNonRT (command_struct_ackermann_);
-      ROS_DEBUG_STREAM_NAMED(name_,
-                             "Added values to command. "
-                             << "Steering: "   << command_struct_ackermann_.steering << ", "
-                             << "Lin: "   << command_struct_ackermann_.lin << ", "
-                             << "Stamp: " << command_struct_ackermann_.stamp);
-    }
-    else
+    const double start_time = (command.stamp + cmd_delay_).toSec();
+    const double targets[LIMITED_AXES] = {command.lin, command.ang, command.steering};
+
+    // Start from the planned state, unless the previous command timed out and the controller braked
+    const bool from_planned = planned_cmd_.has_profiles
+        && (command.stamp - planned_cmd_.stamp).toSec() <= cmd_vel_timeout_;
+
+    for (int i = 0; i < LIMITED_AXES; ++i)
     {
-      ROS_ERROR_NAMED(name_, "Can't accept new commands. Controller is not running.");
+      double value = 0.0, rate = 0.0;
+      if (from_planned)
+        planned_cmd_.profiles[i].sample(start_time, value, rate);
+      command.profiles[i].plan(start_time, value, rate, targets[i],
+                               limiter_.accelerationBound(i), limiter_.jerkBound(i));
     }
+    command.has_profiles = true;
+    planned_cmd_ = command;
   }
 
   bool AckermannController::getWheelNames(ros::NodeHandle& controller_nh,
@@ -546,6 +820,13 @@ namespace ackermann_controller{
       return true;
   }
 
+  bool AckermannController::getPoseAtTimeCallback(four_wheel_steering_msgs::GetPoseAtTime::Request& request,
+                                                  four_wheel_steering_msgs::GetPoseAtTime::Response& response)
+  {
+    response.success = odometry_.getPoseAt(request.stamp, response.x, response.y, response.heading);
+    return true;
+  }
+
   void AckermannController::setOdomPubFields(ros::NodeHandle& root_nh, ros::NodeHandle& controller_nh)
   {
     // Get and check params for covariances
@@ -563,47 +844,25 @@ namespace ackermann_controller{
     for (int i = 0; i < twist_cov_list.size(); ++i)
       ROS_ASSERT(twist_cov_list[i].getType() == XmlRpc::XmlRpcValue::TypeDouble);
 
-    // Setup odometry realtime publisher + odom message constant fields
-    odom_pub_.reset(new realtime_tools::RealtimePublisher<nav_msgs::Odometry>(controller_nh, "odom", 100));
-    odom_pub_->msg_.header.frame_id = "odom";
-    odom_pub_->msg_.child_frame_id = base_frame_id_;
-    odom_pub_->msg_.pose.pose.position.z = 0;
-    odom_pub_->msg_.pose.covariance = boost::assign::list_of
-        (static_cast<double>(pose_cov_list[0])) (0)  (0)  (0)  (0)  (0)
-        (0)  (static_cast<double>(pose_cov_list[1])) (0)  (0)  (0)  (0)
-        (0)  (0)  (static_cast<double>(pose_cov_list[2])) (0)  (0)  (0)
-        (0)  (0)  (0)  (static_cast<double>(pose_cov_list[3])) (0)  (0)
-        (0)  (0)  (0)  (0)  (static_cast<double>(pose_cov_list[4])) (0)
-        (0)  (0)  (0)  (0)  (0)  (static_cast<double>(pose_cov_list[5]));
-    odom_pub_->msg_.twist.twist.linear.y  = 0;
-    odom_pub_->msg_.twist.twist.linear.z  = 0;
-    odom_pub_->msg_.twist.twist.angular.x = 0;
-    odom_pub_->msg_.twist.twist.angular.y = 0;
-    odom_pub_->msg_.twist.covariance = boost::assign::list_of
-        (static_cast<double>(twist_cov_list[0])) (0)  (0)  (0)  (0)  (0)
-        (0)  (static_cast<double>(twist_cov_list[1])) (0)  (0)  (0)  (0)
-        (0)  (0)  (static_cast<double>(twist_cov_list[2])) (0)  (0)  (0)
-        (0)  (0)  (0)  (static_cast<double>(twist_cov_list[3])) (0)  (0)
-        (0)  (0)  (0)  (0)  (static_cast<double>(twist_cov_list[4])) (0)
-        (0)  (0)  (0)  (0)  (0)  (static_cast<double>(twist_cov_list[5]));
-    tf_odom_pub_.reset(new realtime_tools::RealtimePublisher<tf::tfMessage>(root_nh, "/tf", 100));
-    tf_odom_pub_->msg_.transforms.resize(1);
-    tf_odom_pub_->msg_.transforms[0].transform.translation.z = 0.0;
-    tf_odom_pub_->msg_.transforms[0].child_frame_id = base_frame_id_;
-    tf_odom_pub_->msg_.transforms[0].header.frame_id = "odom";
-  }
-
-  void AckermannController::handleSteeringSaturation(double &front_left_steering, double &front_right_steering)
-  {
-    if(front_left_steering > steering_limit_)
+    boost::array<double, 6> pose_covariance_diagonal;
+    boost::array<double, 6> twist_covariance_diagonal;
+    for (int i = 0; i < 6; ++i)
     {
-      front_left_steering = copysign(steering_limit_, front_left_steering);
-      front_right_steering = atan(wheel_base_/(wheel_base_/tan(front_left_steering) + track_));
+      pose_covariance_diagonal[i] = static_cast<double>(pose_cov_list[i]);
+      twist_covariance_diagonal[i] = static_cast<double>(twist_cov_list[i]);
     }
-    else if(front_right_steering < -steering_limit_)
+
+    // Setup odometry publisher + odom message constant fields
+    odom_publisher_.init(root_nh, controller_nh, base_frame_id_,
+                         pose_covariance_diagonal, twist_covariance_diagonal, enable_odom_tf_);
+
+    // Every sample of the control loop, batched with each odometry message
+    bool enable_odom_samples = false;
+    controller_nh.param("enable_odom_samples", enable_odom_samples, enable_odom_samples);
+    if (enable_odom_samples)
     {
-      front_right_steering = copysign(steering_limit_, front_right_steering);
-      front_left_steering = atan(wheel_base_/(wheel_base_/tan(front_right_steering) - track_));
+      odom_publisher_.initSamples(controller_nh, ODOM_SAMPLES_QUEUE_SIZE);
+      ROS_INFO_STREAM_NAMED(name_, "Publishing every odometry sample on odom_samples");
     }
   }
 
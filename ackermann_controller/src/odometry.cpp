@@ -4,8 +4,6 @@
 
 namespace ackermann_controller
 {
-  namespace bacc = boost::accumulators;
-
   Odometry::Odometry(size_t velocity_rolling_window_size)
   : timestamp_(0.0)
   , last_update_timestamp_(0.0)
@@ -14,6 +12,8 @@ namespace ackermann_controller
   , heading_(0.0)
   , linear_(0.0)
   , angular_(0.0)
+  , raw_linear_(0.0)
+  , raw_angular_(0.0)
   , track_(0.0)
   , front_wheel_radius_(0.0)
   , rear_wheel_radius_(0.0)
@@ -21,9 +21,14 @@ namespace ackermann_controller
   , left_wheel_old_pos_(0.0)
   , right_wheel_old_pos_(0.0)
   , wheel_old_pos_(0.0)
+  , has_wheel_old_pos_(false)
+  , restored_wheel_travel_limit_(-1.0)
+  , integration_method_(vehicle_kinematics::INTEGRATION_EXACT)
+  , front_steering_old_(0.0)
+  , has_front_steering_old_(false)
   , velocity_rolling_window_size_(velocity_rolling_window_size)
-  , linear_acc_(RollingWindow::window_size = velocity_rolling_window_size)
-  , angular_acc_(RollingWindow::window_size = velocity_rolling_window_size)
+  , linear_acc_(velocity_rolling_window_size)
+  , angular_acc_(velocity_rolling_window_size)
   {
   }
 
@@ -31,6 +36,10 @@ namespace ackermann_controller
   {
     // Reset accumulators and timestamp:
     resetAccumulators();
+    history_.clear();
+    has_front_steering_old_ = false;
+    has_wheel_old_pos_ = false;
+    restored_wheel_travel_limit_ = -1.0;
     timestamp_ = time;
     last_update_timestamp_ = time;
   }
@@ -41,17 +50,39 @@ namespace ackermann_controller
   {
     /// Get current wheel joint positions:
     const double wheel_cur_pos  = rear_wheel_angular_pos * rear_wheel_radius_;
-    /// Estimate pos evolution of wheels using old and current position:
-    const double wheel_est_diff_pos  = wheel_cur_pos  - wheel_old_pos_;
+    /// A position restored from a previous run is only a baseline for a plausible travel:
+    /// an encoder reset by a driver restart would move the pose by the whole distance travelled
+    if (has_wheel_old_pos_ && restored_wheel_travel_limit_ >= 0.0
+        && fabs(wheel_cur_pos - wheel_old_pos_) > restored_wheel_travel_limit_)
+      has_wheel_old_pos_ = false;
+    restored_wheel_travel_limit_ = -1.0;
+    /// Estimate pos evolution of wheels using old and current position, none on the first update:
+    const double wheel_est_diff_pos  = has_wheel_old_pos_ ? wheel_cur_pos  - wheel_old_pos_ : 0.0;
     /// Update old position with current:
     wheel_old_pos_ = wheel_cur_pos;
-
-    const double angular_diff = wheel_est_diff_pos * tan(front_steering) / wheel_base_;
-    /// Integrate odometry:
-    integrateExact(wheel_est_diff_pos, angular_diff);
-
-    linear_ = rear_wheel_angular_vel*rear_wheel_radius_;
-    angular_ = linear_ * tan(front_steering) / wheel_base_;
+    has_wheel_old_pos_ = true;
+
+    /// Integrate odometry, over the displacement rather than the time:
+    const double front_steering_old = has_front_steering_old_ ? front_steering_old_ : front_steering;
+    const vehicle_kinematics::BodyVelocity<double> previous =
+      {wheel_est_diff_pos, 0.0, wheel_est_diff_pos * tan(front_steering_old) / wheel_base_};
+    const vehicle_kinematics::BodyVelocity<double> current =
+      {wheel_est_diff_pos, 0.0, wheel_est_diff_pos * tan(front_steering) / wheel_base_};
+    vehicle_kinematics::Pose2D<double> pose = {x_, y_, heading_};
+    vehicle_kinematics::integratePose(integration_method_, previous, current, 1.0, pose);
+    x_ = pose.x;
+    y_ = pose.y;
+    heading_ = pose.heading;
+    front_steering_old_ = front_steering;
+    has_front_steering_old_ = true;
+
+    /// Filter the wheel velocities, the pose above is integrated from the positions:
+    raw_linear_ = rear_wheel_angular_vel*rear_wheel_radius_;
+    raw_angular_ = raw_linear_ * tan(front_steering) / wheel_base_;
+    linear_acc_.push(raw_linear_);
+    angular_acc_.push(raw_angular_);
+    linear_ = linear_acc_.mean();
+    angular_ = angular_acc_.mean();
 
     /// Compute x, y and heading using velocity
 //    const double dt = (time - last_update_timestamp_).toSec();
@@ -59,6 +90,7 @@ namespace ackermann_controller
 //    /// Integrate odometry:
 //    integrateExact(linear_*dt, angular_*dt);
 
+    history_.add(time.toSec(), x_, y_, heading_);
     return true;
   }
 
@@ -67,11 +99,51 @@ namespace ackermann_controller
     /// Save last linear and angular velocity:
     linear_ = linear;
     angular_ = angular;
+    raw_linear_ = linear;
+    raw_angular_ = angular;
 
     /// Integrate odometry:
     const double dt = (time - timestamp_).toSec();
     timestamp_ = time;
     integrateExact(linear * dt, angular * dt);
+    history_.add(time.toSec(), x_, y_, heading_);
+  }
+
+  Odometry::State Odometry::getState() const
+  {
+    State state;
+    state.x = x_;
+    state.y = y_;
+    state.heading = heading_;
+    state.wheel_pos = wheel_old_pos_;
+    return state;
+  }
+
+  void Odometry::setState(const State& state, double max_wheel_travel)
+  {
+    x_ = state.x;
+    y_ = state.y;
+    heading_ = state.heading;
+    wheel_old_pos_ = state.wheel_pos;
+    has_wheel_old_pos_ = true;
+    restored_wheel_travel_limit_ = max_wheel_travel;
+  }
+
+  bool Odometry::getPoseAt(const ros::Time &time, double &x, double &y, double &heading) const
+  {
+    controller_realtime_utils::StampedPose pose;
+    if (!history_.lookup(time.toSec(), pose))
+      return false;
+
+    x = pose.x;
+    y = pose.y;
+    heading = pose.heading;
+    return true;
+  }
+
+  void Odometry::setHistorySize(size_t history_size)
+  {
+    history_.setCapacity(history_size);
   }
 
   void Odometry::setWheelParams(double track, double front_wheel_radius, double rear_wheel_radius, double wheel_base)
@@ -86,7 +158,13 @@ namespace ackermann_controller
   {
     velocity_rolling_window_size_ = velocity_rolling_window_size;
 
-    resetAccumulators();
+    linear_acc_.resize(velocity_rolling_window_size_);
+    angular_acc_.resize(velocity_rolling_window_size_);
+  }
+
+  void Odometry::setIntegrationMethod(vehicle_kinematics::IntegrationMethod method)
+  {
+    integration_method_ = method;
   }
 
   void Odometry::integrateRungeKutta2(double linear, double angular)
@@ -123,8 +201,8 @@ namespace ackermann_controller
 
   void Odometry::resetAccumulators()
   {
-    linear_acc_ = RollingMeanAcc(RollingWindow::window_size = velocity_rolling_window_size_);
-    angular_acc_ = RollingMeanAcc(RollingWindow::window_size = velocity_rolling_window_size_);
+    linear_acc_.clear();
+    angular_acc_.clear();
   }
 
 } // namespace ackermann_controller
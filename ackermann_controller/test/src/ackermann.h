@@ -108,6 +108,9 @@ public:
     }
   }
 
+  /// Last wheel velocity command of the controller, indexed as the joint names
+  double wheelVelocityCommand(unsigned int i) const { return joints_[i].velocity_command; }
+
   bool start_callback(std_srvs::Empty::Request& /*req*/, std_srvs::Empty::Response& /*res*/)
   {
     running_ = true;
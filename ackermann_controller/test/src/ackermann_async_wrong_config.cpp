@@ -0,0 +1,87 @@
+// Runs the controller in process on the fake hardware, with a configuration
+// that only fails once initRequest has returned.
+
+#include <gtest/gtest.h>
+
+#include <std_msgs/Bool.h>
+
+#include <ackermann_controller/ackermann_controller.h>
+
+#include "ackermann.h"
+
+// Latched ready message
+class ReadyListener
+{
+public:
+  ReadyListener()
+  : received(false)
+  , ready(false)
+  {
+  }
+
+  void callback(const std_msgs::Bool& msg)
+  {
+    received = true;
+    ready = msg.data;
+  }
+
+  bool received;
+  bool ready;
+};
+
+TEST(AckermannAsyncWrongConfigTest, testFailedBackgroundConfiguration)
+{
+  Ackermann robot;
+  ros::NodeHandle root_nh;
+  ros::NodeHandle controller_nh("ackermann_controller");
+  ackermann_controller::AckermannController controller;
+  std::set<std::string> claimed_resources;
+  ASSERT_TRUE(controller.initRequest(&robot, root_nh, controller_nh, claimed_resources));
+  controller.startRequest(ros::Time::now());
+
+  // The controller brakes while the configuration runs, and after it failed
+  ros::Time time = ros::Time::now();
+  const ros::Duration period = robot.getPeriod();
+  for (int i = 0; i < 100 && !controller.hasConfigurationFailed(); ++i)
+  {
+    time += period;
+    controller.updateRequest(time, period);
+    ros::Duration(0.05).sleep();
+  }
+  ASSERT_TRUE(controller.hasConfigurationFailed());
+  EXPECT_FALSE(controller.isReady());
+
+  // Started again, the controller keeps braking instead of waiting to be ready
+  controller.stopRequest(time);
+  controller.startRequest(time);
+  for (int i = 0; i < 100; ++i)
+  {
+    time += period;
+    controller.updateRequest(time, period);
+    robot.write();
+  }
+  EXPECT_FALSE(controller.isReady());
+  for (unsigned int i = 0; i < 4; ++i)
+    EXPECT_EQ(robot.wheelVelocityCommand(i), 0.0) << "wheel " << i;
+
+  // Whoever waits for the controller is never told it is ready
+  ReadyListener listener;
+  ros::Subscriber ready_sub = controller_nh.subscribe("ready", 1, &ReadyListener::callback, &listener);
+  for (int i = 0; i < 50 && !listener.received; ++i)
+    ros::Duration(0.1).sleep();
+  ASSERT_TRUE(listener.received);
+  EXPECT_FALSE(listener.ready);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "ackermann_async_wrong_config_test");
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+  int ret = RUN_ALL_TESTS();
+  spinner.stop();
+  ros::shutdown();
+  return ret;
+}
@@ -8,11 +8,12 @@ TEST_F(AckermannControllerTest, testWrongConfig)
   int secs = 0;
   while(!isControllerAlive() && secs < 5)
   {
-    ros::Duration(1.0).sleep();
+    run(1.0);
     secs++;
   }
   // Give up and assume controller load failure after 5 seconds
   EXPECT_GE(secs,5);
+  EXPECT_FALSE(isControllerLoaded());
 }
 
 
@@ -21,10 +22,8 @@ int main(int argc, char** argv)
   testing::InitGoogleTest(&argc, argv);
   ros::init(argc, argv, "ackermann_wrong_config_test");
 
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+  // No spinner, the simulated clock delivers the messages between two updates
   int ret = RUN_ALL_TESTS();
-  spinner.stop();
   ros::shutdown();
   return ret;
 }
@@ -39,6 +39,10 @@
 
 #include <std_srvs/Empty.h>
 
+#include <controller_realtime_utils/testing/simulated_clock.h>
+
+#include "ackermann.h"
+
 // Floating-point value comparison threshold
 const double EPS = 0.01;
 const double POSITION_TOLERANCE = 0.01; // 1 cm-s precision
@@ -47,6 +51,10 @@ const double JERK_LINEAR_VELOCITY_TOLERANCE = 0.10; // 10 cm-s-1 precision
 const double JERK_ANGULAR_VELOCITY_TOLERANCE = 0.05; // 3 deg-s-1 precision
 const double ORIENTATION_TOLERANCE = 0.03; // 0.57 degree precision
 
+/**
+ * Runs the controller in process, on the fake robot and in simulated time.
+ * The controller publishes the odometry of every update on the odom topic.
+ */
 class AckermannControllerTest : public ::testing::Test
 {
 public:
@@ -54,9 +62,9 @@ public:
   AckermannControllerTest()
   : cmd_twist_pub(nh.advertise<geometry_msgs::Twist>("cmd_vel", 100))
   , odom_sub(nh.subscribe("odom", 100, &AckermannControllerTest::odomCallback, this))
-  , start_srv(nh.serviceClient<std_srvs::Empty>("start"))
-  , stop_srv(nh.serviceClient<std_srvs::Empty>("stop"))
   {
+    nh.setParam("ackermann_controller/publish_rate", 1.0/clock.robot().getPeriod().toSec());
+    clock.startController("ackermann_controller");
   }
 
   ~AckermannControllerTest()
@@ -64,25 +72,42 @@ public:
     odom_sub.shutdown();
   }
 
-  nav_msgs::Odometry getLastOdom(){ return last_odom; }
+  /// Odometry published for the last update, waits for the publisher thread of the controller
+  nav_msgs::Odometry getLastOdom()
+  {
+    const ros::Time last_update = now() - period();
+    EXPECT_TRUE(clock.waitForMessages([this, last_update]() { return last_odom.header.stamp >= last_update; }))
+      << "No odometry published for the update at " << last_update;
+    return last_odom;
+  }
+  /// Handled by the next update, at now()
   void publish(geometry_msgs::Twist cmd_vel){ cmd_twist_pub.publish(cmd_vel); }
   bool isControllerAlive(){ return (odom_sub.getNumPublishers() > 0) && (cmd_twist_pub.getNumSubscribers() > 0); }
+  bool isControllerLoaded(){ return clock.controllerManager().getControllerByName("ackermann_controller") != NULL; }
 
-  void start(){ std_srvs::Empty srv; start_srv.call(srv); }
-  void stop(){ std_srvs::Empty srv; stop_srv.call(srv); }
+  /// Runs the control loop for a simulated duration
+  void run(double seconds){ clock.run(ros::Duration(seconds)); }
+  /// Runs the control loop until the condition holds, for at most a simulated duration
+  bool runUntil(const boost::function<bool()>& condition, double seconds)
+  {
+    return clock.runUntil(condition, ros::Duration(seconds));
+  }
+  ros::Time now() const { return clock.now(); }
+  ros::Duration period() const { return clock.robot().getPeriod(); }
+
+  void start(){ std_srvs::Empty srv; clock.robot().start_callback(srv.request, srv.response); }
+  void stop(){ std_srvs::Empty srv; clock.robot().stop_callback(srv.request, srv.response); }
 
 private:
   ros::NodeHandle nh;
   ros::Publisher cmd_twist_pub;
   ros::Subscriber odom_sub;
   nav_msgs::Odometry last_odom;
-
-  ros::ServiceClient start_srv;
-  ros::ServiceClient stop_srv;
+  SimulatedClock<Ackermann> clock;
 
   void odomCallback(const nav_msgs::Odometry& odom)
   {
-    ROS_INFO_STREAM("Callback reveived: pos.x: " << odom.pose.pose.position.x
+    ROS_DEBUG_STREAM("Callback reveived: pos.x: " << odom.pose.pose.position.x
                      << ", orient.z: " << odom.pose.pose.orientation.z
                      << ", lin_est: " << odom.twist.twist.linear.x
                      << ", ang_est: " << odom.twist.twist.angular.z);
@@ -94,4 +119,3 @@ inline tf::Quaternion tfQuatFromGeomQuat(const geometry_msgs::Quaternion& quat)
 {
   return tf::Quaternion(quat.x, quat.y, quat.z, quat.w);
 }
-
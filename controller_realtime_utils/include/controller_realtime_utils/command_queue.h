@@ -0,0 +1,74 @@
+#ifndef CONTROLLER_REALTIME_UTILS_COMMAND_QUEUE_H
+#define CONTROLLER_REALTIME_UTILS_COMMAND_QUEUE_H
+
+#include <cstddef>
+
+#include <ros/time.h>
+
+#include <controller_realtime_utils/spsc_ring.h>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Time stamped commands going from a subscriber callback to the real-time thread
+   * Unlike a latest-wins buffer, every command is kept until its time comes, so a burst
+   * of commands delayed by the network is still applied in order and at the pace
+   * it was sent. T must have a ros::Time stamp member, the time the command is meant
+   * to be applied at. The commands are popped in the order they were pushed, and the
+   * oldest one blocks the others until it is due: the producer has to push increasing
+   * stamps, not too far ahead of the clock.
+   */
+  template<typename T>
+  class CommandQueue
+  {
+  public:
+    /**
+     * \brief Constructor
+     * \param capacity Minimum number of commands waiting to be applied
+     */
+    explicit CommandQueue(std::size_t capacity)
+    : ring_(capacity)
+    {
+    }
+
+    /**
+     * \brief Queues a command (non real-time, single producer)
+     * \return false if the queue is full, the command is then discarded
+     */
+    bool push(const T& command)
+    {
+      return ring_.push(command);
+    }
+
+    /**
+     * \brief Pops the oldest command if it is due (real-time safe, single consumer)
+     * \param time    Current time
+     * \param delay   Commands are applied this long after their stamp
+     * \param command Popped command
+     * \return false if the queue is empty or the oldest command is not due yet
+     */
+    bool popDue(const ros::Time& time, const ros::Duration& delay, T& command)
+    {
+      T oldest;
+      if (!ring_.peek(oldest) || time < oldest.stamp + delay)
+        return false;
+      return ring_.pop(command);
+    }
+
+    /// Drops all the queued commands (consumer side)
+    void clear()
+    {
+      T command;
+      while (ring_.pop(command)) {}
+    }
+
+    std::size_t capacity() const { return ring_.capacity(); }
+
+  private:
+    SpscRing<T> ring_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_COMMAND_QUEUE_H
@@ -0,0 +1,120 @@
+#ifndef CONTROLLER_REALTIME_UTILS_CYCLE_DIAGNOSTICS_H
+#define CONTROLLER_REALTIME_UTILS_CYCLE_DIAGNOSTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <ros/ros.h>
+
+#include <controller_realtime_utils/cycle_histogram.h>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Execution time and period statistics of a control loop
+   * The real-time thread records each cycle, a ros::Timer publishes the statistics
+   * of the last window on /diagnostics: p50/p99/max of the compute time and of the
+   * period, the period jitter (p99 - p50) and the number of overruns, i.e. cycles
+   * whose compute time exceeded their period. When the controller reports them, the
+   * latencies of the applied commands and the counters of lost work are published as well.
+   */
+  class CycleDiagnostics
+  {
+  public:
+    CycleDiagnostics();
+
+    /**
+     * \brief Starts publishing (non real-time)
+     * \param nh             Node handle used to advertise /diagnostics and create the timer
+     * \param name           Name of the diagnostic status, usually the controller name
+     * \param publish_period Period of the diagnostics publication [s]
+     */
+    void init(ros::NodeHandle& nh, const std::string& name, double publish_period);
+
+    /**
+     * \brief Publishes a counter of lost work, e.g. dropped messages (non real-time)
+     * Its increase during the window and its total are published, the status is a
+     * warning when it increased.
+     * \param name  Name of the counter
+     * \param total Returns the total count, called by the publication timer
+     */
+    void addCounter(const std::string& name, const boost::function<unsigned long()>& total);
+
+    /**
+     * \brief Records a cycle (real-time safe)
+     * \param period       Period given to the update [s]
+     * \param compute_time Time spent in the update [s]
+     */
+    void add(double period, double compute_time)
+    {
+      period_.add(period);
+      compute_time_.add(compute_time);
+      if (compute_time > period)
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Records the latency of an applied command (real-time safe)
+     * \param latency Time between the command stamp and its application [s]
+     */
+    void addCommandLatency(double latency)
+    {
+      command_latency_.add(latency);
+    }
+
+  private:
+    struct Counter
+    {
+      std::string name;
+      boost::function<unsigned long()> total;
+      unsigned long last_total;
+    };
+
+    void publish(const ros::TimerEvent& event);
+
+    std::string name_;
+    CycleHistogram compute_time_;
+    CycleHistogram period_;
+    CycleHistogram command_latency_;
+    std::atomic<unsigned long> overruns_;
+    unsigned long last_overruns_;
+    std::vector<Counter> counters_;
+
+    ros::Publisher diagnostics_pub_;
+    ros::Timer timer_;
+  };
+
+  /**
+   * \brief Measures the time spent in the enclosing scope and records it
+   *        in a CycleDiagnostics when leaving, whatever the exit path
+   */
+  class ScopedCycleTimer
+  {
+  public:
+    ScopedCycleTimer(CycleDiagnostics& diagnostics, const ros::Duration& period)
+    : diagnostics_(diagnostics)
+    , period_(period.toSec())
+    , start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedCycleTimer()
+    {
+      const std::chrono::duration<double> compute_time = std::chrono::steady_clock::now() - start_;
+      diagnostics_.add(period_, compute_time.count());
+    }
+
+  private:
+    CycleDiagnostics& diagnostics_;
+    const double period_;
+    const std::chrono::steady_clock::time_point start_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_CYCLE_DIAGNOSTICS_H
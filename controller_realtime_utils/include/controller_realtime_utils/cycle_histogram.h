@@ -0,0 +1,74 @@
+#ifndef CONTROLLER_REALTIME_UTILS_CYCLE_HISTOGRAM_H
+#define CONTROLLER_REALTIME_UTILS_CYCLE_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include <boost/scoped_array.hpp>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Fixed-bucket histogram filled by a real-time thread and read by another thread
+   * add() is wait-free and does not allocate. summarize() gives the statistics of the
+   * values added since its previous call, values beyond the last bucket are counted
+   * in an overflow bucket.
+   */
+  class CycleHistogram
+  {
+  public:
+    /// Statistics of a window of values:
+    struct Summary
+    {
+      unsigned long count;
+      double p50;  // upper edge of the bucket holding the median
+      double p99;  // upper edge of the bucket holding the 99th percentile
+      double max;  // exact maximum
+    };
+
+    /**
+     * \brief Constructor
+     * \param bucket_width Width of one bucket, in the unit of the values
+     * \param bucket_count Number of buckets, the histogram covers [0, bucket_width*bucket_count)
+     */
+    CycleHistogram(double bucket_width, std::size_t bucket_count);
+
+    /**
+     * \brief Records a value (real-time safe, single producer)
+     * \param value Value, negative values go to the first bucket
+     */
+    void add(double value)
+    {
+      std::size_t bucket = bucket_count_;
+      if (value < bucket_width_*bucket_count_)
+        bucket = value > 0.0 ? static_cast<std::size_t>(value/bucket_width_) : 0;
+      counts_[bucket].store(counts_[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+      double max = max_.load(std::memory_order_relaxed);
+      while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    /**
+     * \brief Statistics of the values added since the previous call (non real-time, single consumer)
+     * Percentiles of an empty window are 0.
+     */
+    Summary summarize();
+
+  private:
+    const double bucket_width_;
+    const std::size_t bucket_count_;
+
+    /// Counters written by the real-time thread, the last one is the overflow bucket:
+    boost::scoped_array<std::atomic<uint32_t> > counts_;
+    std::atomic<double> max_;
+
+    /// Counters at the previous summary:
+    std::vector<uint32_t> previous_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_CYCLE_HISTOGRAM_H
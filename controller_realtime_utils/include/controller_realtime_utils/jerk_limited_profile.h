@@ -0,0 +1,143 @@
+#ifndef CONTROLLER_REALTIME_UTILS_JERK_LIMITED_PROFILE_H
+#define CONTROLLER_REALTIME_UTILS_JERK_LIMITED_PROFILE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Time-optimal transition of a command to a target, with bounded rate and jerk (S-curve)
+   * plan() is meant for the subscriber callbacks, sample() for the real-time loop: the profile
+   * is at most three constant jerk segments whose starting state is precomputed, sampling it
+   * is a closed form evaluation. It is trivially copyable, so it can travel with a command.
+   * For a velocity command, the rate is the acceleration [m/s^2] and the jerk [m/s^3].
+   */
+  class JerkLimitedProfile
+  {
+  public:
+    static const std::size_t MAX_SEGMENTS = 3;
+
+    /// Constructor, holds 0
+    JerkLimitedProfile()
+    {
+      hold(0.0);
+    }
+
+    /// Holds a value, without transition
+    void hold(double value)
+    {
+      size_ = 0;
+      end_time_ = -std::numeric_limits<double>::infinity();
+      target_ = value;
+    }
+
+    /**
+     * \brief Plans the fastest transition to the target that respects the limits
+     * The rate is brought to 0 when the target is reached. Without jerk limit the rate is a
+     * step (trapezoidal profile), without rate limit either the value itself is a step.
+     * \param start_time Time the transition starts at [s]
+     * \param value      Value at start_time
+     * \param rate       Rate of the value at start_time [1/s]
+     * \param target     Value to reach
+     * \param max_rate   Absolute rate limit [1/s], infinite if none
+     * \param max_jerk   Absolute jerk limit [1/s^3], infinite if none
+     */
+    void plan(double start_time, double value, double rate, double target, double max_rate, double max_jerk)
+    {
+      hold(target);
+      end_time_ = start_time;
+
+      if (!(max_jerk < std::numeric_limits<double>::infinity()))
+      {
+        if (max_rate < std::numeric_limits<double>::infinity() && max_rate > 0.0)
+          addSegment(value, std::copysign(max_rate, target - value), 0.0, std::fabs(target - value)/max_rate);
+        return;
+      }
+      if (!(max_jerk > 0.0) || !(max_rate > 0.0))
+        return;
+
+      // Direction of the transition, from the value reached by bringing the rate to 0 right now
+      const double stop_value = value + rate*std::fabs(rate)/(2.0*max_jerk);
+      const double direction = target >= stop_value ? 1.0 : -1.0;
+
+      // In the direction frame, the rate goes to peak_rate, stays there, and back to 0
+      const double rate0 = direction*rate;
+      const double delta = direction*(target - value);
+      double peak_rate = std::sqrt(std::max(0.0, max_jerk*delta + rate0*rate0/2.0));
+      double plateau = 0.0;
+      if (peak_rate > max_rate)
+      {
+        peak_rate = max_rate;
+        const double ramp_up = std::fabs(peak_rate*peak_rate - rate0*rate0)/(2.0*max_jerk);
+        const double ramp_down = peak_rate*peak_rate/(2.0*max_jerk);
+        plateau = std::max(0.0, (delta - ramp_up - ramp_down)/peak_rate);
+      }
+
+      const double jerk_up = peak_rate >= rate0 ? max_jerk : -max_jerk;
+      value = addSegment(value, rate, direction*jerk_up, std::fabs(peak_rate - rate0)/max_jerk);
+      value = addSegment(value, direction*peak_rate, 0.0, plateau);
+      addSegment(value, direction*peak_rate, -direction*max_jerk, peak_rate/max_jerk);
+    }
+
+    /**
+     * \brief Value and rate at a time (real-time safe)
+     * Before the start of the transition, its starting state is returned, after its end the target.
+     * \param [in]  time  Time [s]
+     * \param [out] value Value
+     * \param [out] rate  Rate [1/s]
+     */
+    void sample(double time, double& value, double& rate) const
+    {
+      if (size_ == 0 || time >= end_time_)
+      {
+        value = target_;
+        rate = 0.0;
+        return;
+      }
+
+      std::size_t i = 0;
+      while (i + 1 < size_ && time >= start_time_[i+1])
+        ++i;
+
+      const double dt = std::max(0.0, time - start_time_[i]);
+      value = start_value_[i] + dt*(start_rate_[i] + dt*jerk_[i]/2.0);
+      rate = start_rate_[i] + dt*jerk_[i];
+    }
+
+    /// Time the target is reached at [s]
+    double endTime() const { return end_time_; }
+
+    double target() const { return target_; }
+
+  private:
+    /// Appends a segment starting at end_time_, returns the value at its end
+    double addSegment(double value, double rate, double jerk, double duration)
+    {
+      if (duration > 0.0 && size_ < MAX_SEGMENTS)
+      {
+        start_time_[size_] = end_time_;
+        start_value_[size_] = value;
+        start_rate_[size_] = rate;
+        jerk_[size_] = jerk;
+        ++size_;
+        end_time_ += duration;
+      }
+      return value + duration*(rate + duration*jerk/2.0);
+    }
+
+    std::size_t size_;
+    double start_time_[MAX_SEGMENTS];
+    double start_value_[MAX_SEGMENTS];
+    double start_rate_[MAX_SEGMENTS];
+    double jerk_[MAX_SEGMENTS];
+    double end_time_;
+    double target_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_JERK_LIMITED_PROFILE_H
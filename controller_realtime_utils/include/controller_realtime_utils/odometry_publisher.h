@@ -0,0 +1,163 @@
+#ifndef CONTROLLER_REALTIME_UTILS_ODOMETRY_PUBLISHER_H
+#define CONTROLLER_REALTIME_UTILS_ODOMETRY_PUBLISHER_H
+
+#include <atomic>
+#include <string>
+
+#include <boost/array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <ros/ros.h>
+#include <nav_msgs/Odometry.h>
+#include <tf/tfMessage.h>
+#include <four_wheel_steering_msgs/OdometrySampleArray.h>
+
+#include <controller_realtime_utils/seqlock.h>
+#include <controller_realtime_utils/spsc_ring.h>
+#include <controller_realtime_utils/wakeup.h>
+
+namespace controller_realtime_utils
+{
+
+  /// Compact odometry state written by the real-time thread:
+  struct OdometrySnapshot
+  {
+    ros::Time stamp;
+    uint64_t index;   // number of snapshots written so far
+    double x;         // [m]
+    double y;         // [m]
+    double heading;   // [rad]
+    double linear_x;  // [m/s]
+    double linear_y;  // [m/s]
+    double angular;   // [rad/s]
+  };
+
+  /**
+   * \brief Publishes odometry and the odom -> base frame transform from a background thread
+   * The real-time thread only copies a snapshot into a seqlock and wakes the publisher
+   * thread, which builds the nav_msgs/Odometry and tf messages and publishes the
+   * snapshot right away, whatever the clock. Snapshots overwritten before being
+   * published are counted, see skippedSnapshots(), instead of silently skipped.
+   * Optionally, every sample of the control loop is also queued and published in
+   * batches, one four_wheel_steering_msgs/OdometrySampleArray with each odometry.
+   */
+  class OdometryPublisher
+  {
+  public:
+    OdometryPublisher();
+
+    ~OdometryPublisher();
+
+    /**
+     * \brief Advertises the topics and sets the constant fields of the messages (non real-time)
+     * \param root_nh                   Node handle at root namespace, for /tf
+     * \param controller_nh             Node handle inside the controller namespace, for odom
+     * \param base_frame_id             Child frame of the odometry
+     * \param pose_covariance_diagonal  Diagonal of the pose covariance
+     * \param twist_covariance_diagonal Diagonal of the twist covariance
+     * \param enable_odom_tf            Whether to publish the transform on /tf
+     */
+    void init(ros::NodeHandle& root_nh, ros::NodeHandle& controller_nh,
+              const std::string& base_frame_id,
+              const boost::array<double, 6>& pose_covariance_diagonal,
+              const boost::array<double, 6>& twist_covariance_diagonal,
+              bool enable_odom_tf);
+
+    /**
+     * \brief Enables the odom_samples topic, call after init() (non real-time)
+     * \param controller_nh Node handle inside the controller namespace
+     * \param capacity      Maximum number of samples between two publications
+     */
+    void initSamples(ros::NodeHandle& controller_nh, std::size_t capacity);
+
+    /// Starts the publisher thread (non real-time)
+    void start();
+
+    /// Stops the publisher thread (non real-time)
+    void stop();
+
+    /**
+     * \brief Writes a new snapshot to publish (real-time safe)
+     */
+    void update(const ros::Time& stamp, double x, double y, double heading,
+                double linear_x, double linear_y, double angular)
+    {
+      OdometrySnapshot snapshot;
+      snapshot.stamp = stamp;
+      snapshot.index = ++written_;
+      snapshot.x = x;
+      snapshot.y = y;
+      snapshot.heading = heading;
+      snapshot.linear_x = linear_x;
+      snapshot.linear_y = linear_y;
+      snapshot.angular = angular;
+      snapshot_.write(snapshot);
+      wakeup_.notify();
+    }
+
+    /**
+     * \brief Queues the sample of the current cycle for odom_samples (real-time safe)
+     * Does nothing unless initSamples() was called.
+     */
+    void addSample(const ros::Time& stamp, double x, double y, double heading,
+                   double linear_x, double linear_y, double angular)
+    {
+      if (!samples_)
+        return;
+
+      OdometrySnapshot sample;
+      sample.stamp = stamp;
+      sample.index = 0;
+      sample.x = x;
+      sample.y = y;
+      sample.heading = heading;
+      sample.linear_x = linear_x;
+      sample.linear_y = linear_y;
+      sample.angular = angular;
+      if (!samples_->push(sample))
+        dropped_samples_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Total number of snapshots overwritten before being published (thread safe)
+    unsigned long skippedSnapshots() const
+    {
+      return skipped_snapshots_.load(std::memory_order_relaxed);
+    }
+
+    /// Total number of samples dropped because their queue was full (thread safe)
+    unsigned long droppedSamples() const
+    {
+      return dropped_samples_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    void run();
+    void publish(const OdometrySnapshot& snapshot);
+    void publishSamples();
+
+    /// Real-time side:
+    SeqLock<OdometrySnapshot> snapshot_;
+    uint64_t written_;
+    boost::scoped_ptr<SpscRing<OdometrySnapshot> > samples_;
+    std::atomic<unsigned long> dropped_samples_;
+    Wakeup wakeup_;
+
+    /// Publisher thread side:
+    ros::Publisher odom_pub_;
+    ros::Publisher tf_odom_pub_;
+    nav_msgs::Odometry odom_;
+    tf::tfMessage tf_odom_;
+    bool enable_odom_tf_;
+    ros::Publisher samples_pub_;
+    four_wheel_steering_msgs::OdometrySampleArray samples_msg_;
+    uint64_t published_index_;
+    std::atomic<unsigned long> skipped_snapshots_;
+
+    std::atomic<bool> running_;
+    boost::thread thread_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_ODOMETRY_PUBLISHER_H
@@ -0,0 +1,93 @@
+#ifndef CONTROLLER_REALTIME_UTILS_PERSISTENT_STATE_H
+#define CONTROLLER_REALTIME_UTILS_PERSISTENT_STATE_H
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+namespace controller_realtime_utils
+{
+
+  /// Header of the state file, private to the implementation:
+  struct StateFileHeader;
+
+  /**
+   * \brief Fixed size record kept in a memory-mapped file, to survive a restart of the controller
+   * The file is mapped once, storing the record is a copy into the mapping guarded by a
+   * sequence counter: no system call. A record left half written (odd counter), e.g. by
+   * a crash, is not loaded.
+   * The file has to be on a tmpfs (e.g. /dev/shm), it then survives the restarts of the
+   * process but not of the machine. On a disk, the kernel write-protects the page after
+   * each writeback, and the next store() takes a page fault that can block in the filesystem.
+   */
+  class StateFile
+  {
+  public:
+    StateFile();
+
+    ~StateFile();
+
+    /**
+     * \brief Maps the file, created if needed (non real-time)
+     * A file holding a record of another size is reset. A warning is logged if it is not on a tmpfs.
+     * \param path        Path of the file
+     * \param record_size Size of the record [bytes]
+     * \return false if the file could not be created or mapped
+     */
+    bool open(const std::string& path, std::size_t record_size);
+
+    /// Unmaps the file (non real-time)
+    void close();
+
+    bool isOpen() const { return header_ != NULL; }
+
+    /**
+     * \brief Copies the stored record (real-time safe)
+     * \return false if no complete record was stored
+     */
+    bool load(void* record) const;
+
+    /// Stores a record (real-time safe, single writer)
+    void store(const void* record);
+
+  private:
+    StateFileHeader* header_;
+    char* record_;
+    std::size_t size_;
+    std::size_t record_size_;
+  };
+
+  /**
+   * \brief Typed StateFile
+   * T must be trivially copyable, it is copied byte per byte to and from the file.
+   */
+  template<typename T>
+  class PersistentState
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Persistent states are copied with memcpy");
+
+  public:
+    /// Maps the file, created if needed (non real-time)
+    bool open(const std::string& path) { return file_.open(path, sizeof(T)); }
+
+    void close() { file_.close(); }
+
+    bool isOpen() const { return file_.isOpen(); }
+
+    /// Copies the stored state (real-time safe), false if there is none
+    bool load(T& state) const { return file_.isOpen() && file_.load(&state); }
+
+    /// Stores a state (real-time safe, no system call), does nothing if the file is not open
+    void store(const T& state)
+    {
+      if (file_.isOpen())
+        file_.store(&state);
+    }
+
+  private:
+    StateFile file_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_PERSISTENT_STATE_H
@@ -0,0 +1,81 @@
+#ifndef CONTROLLER_REALTIME_UTILS_POSE_HISTORY_H
+#define CONTROLLER_REALTIME_UTILS_POSE_HISTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+#include <boost/scoped_array.hpp>
+
+namespace controller_realtime_utils
+{
+
+  /// 2D pose at a time:
+  struct StampedPose
+  {
+    double stamp;    // [s]
+    double x;        // [m]
+    double y;        // [m]
+    double heading;  // [rad]
+  };
+
+  /**
+   * \brief Fixed capacity history of odometry poses, filled by the real-time thread
+   * and queried by time from any other thread
+   * The slots are allocated once by setCapacity(), add() overwrites the oldest pose
+   * without waiting for the readers. Each slot is guarded by a sequence counter, like
+   * in SharedMemoryRing, so a lookup never returns a pose being overwritten.
+   */
+  class PoseHistory
+  {
+  public:
+    explicit PoseHistory(std::size_t capacity = 0);
+
+    /**
+     * \brief Allocates the slots and clears the history (non real-time)
+     * Must not run concurrently with any other call.
+     */
+    void setCapacity(std::size_t capacity);
+
+    std::size_t capacity() const { return capacity_; }
+
+    /// Forgets every pose, e.g. when the odometry is reset (real-time safe, writer thread)
+    void clear();
+
+    /**
+     * \brief Records a pose (real-time safe, wait-free, single writer)
+     * \return false if the stamp is not after the previous one, the pose is then ignored
+     */
+    bool add(double stamp, double x, double y, double heading);
+
+    /**
+     * \brief Pose at a time, interpolated linearly between the two surrounding poses (thread safe)
+     * The heading is interpolated as is, it is expected to be continuous (not wrapped).
+     * The search is a binary search, O(log capacity).
+     * \param [in]  stamp Time of the pose [s]
+     * \param [out] pose  Pose at stamp
+     * \return false if stamp is before the oldest or after the newest pose of the history
+     */
+    bool lookup(double stamp, StampedPose& pose) const;
+
+  private:
+    struct Slot
+    {
+      std::atomic<uint64_t> sequence;
+      StampedPose pose;
+    };
+
+    bool read(uint64_t index, StampedPose& pose) const;
+
+    boost::scoped_array<Slot> slots_;
+    std::size_t capacity_;
+    /// Number of poses added so far and index of the oldest pose since the last clear():
+    std::atomic<uint64_t> head_;
+    std::atomic<uint64_t> first_;
+    /// Writer side only:
+    double last_stamp_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_POSE_HISTORY_H
@@ -0,0 +1,140 @@
+#ifndef CONTROLLER_REALTIME_UTILS_REALTIME_LOGGER_H
+#define CONTROLLER_REALTIME_UTILS_REALTIME_LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include <boost/thread/thread.hpp>
+
+#include <ros/console.h>
+#include <ros/time.h>
+
+#include <controller_realtime_utils/spsc_ring.h>
+
+namespace controller_realtime_utils
+{
+
+  /// Maximum number of values carried by one log record:
+  static const unsigned int REALTIME_LOG_MAX_VALUES = 8;
+
+  /// Fixed-size binary log record, formatted later by the logger thread:
+  struct RealtimeLogRecord
+  {
+    ros::console::levels::Level level;
+    const char* format;
+    unsigned int value_count;
+    double values[REALTIME_LOG_MAX_VALUES];
+  };
+
+  /**
+   * \brief Logging from a real-time thread
+   * The real-time thread only copies a format pointer and a few doubles into a
+   * lock-free ring. A background thread forwards them to rosconsole under the logger
+   * name, and only formats the records of the levels the logger is enabled for.
+   * The records still cost a push each, throttle the per-cycle traces (see LogThrottle).
+   *
+   * The format must be a string literal (only its address is stored) and must only
+   * use floating point conversions (%f, %g, %e), as every value is stored as a double.
+   * Records pushed while the ring is full are dropped and reported as a warning.
+   */
+  class RealtimeLogger
+  {
+  public:
+
+    /**
+     * \brief Constructor, the logger thread is only started by start()
+     * \param capacity Number of records the ring can hold
+     */
+    explicit RealtimeLogger(std::size_t capacity = 1024);
+
+    ~RealtimeLogger();
+
+    /**
+     * \brief Starts the logger thread (non real-time)
+     * \param name Name of the rosconsole logger, usually the controller name
+     */
+    void start(const std::string& name);
+
+    /// Stops the logger thread after it has flushed the remaining records (non real-time)
+    void stop();
+
+    /**
+     * \brief Queues a record (real-time safe)
+     * \param level  Rosconsole level
+     * \param format String literal printf format
+     * \param values Up to REALTIME_LOG_MAX_VALUES values, converted to double
+     * \return false if the record was dropped
+     */
+    template<typename... Values>
+    bool log(ros::console::levels::Level level, const char* format, Values... values)
+    {
+      static_assert(sizeof...(Values) <= REALTIME_LOG_MAX_VALUES, "Too many values in a realtime log record");
+      const double array[] = {static_cast<double>(values)..., 0.0};
+
+      RealtimeLogRecord record;
+      record.level = level;
+      record.format = format;
+      record.value_count = sizeof...(Values);
+      std::copy(array, array + sizeof...(Values), record.values);
+      if (!ring_.push(record))
+      {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      return true;
+    }
+
+    template<typename... Values>
+    bool debug(const char* format, Values... values) { return log(ros::console::levels::Debug, format, values...); }
+
+    template<typename... Values>
+    bool info(const char* format, Values... values) { return log(ros::console::levels::Info, format, values...); }
+
+    template<typename... Values>
+    bool warn(const char* format, Values... values) { return log(ros::console::levels::Warn, format, values...); }
+
+    template<typename... Values>
+    bool error(const char* format, Values... values) { return log(ros::console::levels::Error, format, values...); }
+
+    /// Formats a record, exposed for testing
+    static std::string format(const RealtimeLogRecord& record);
+
+  private:
+    void run();
+    void flush();
+
+    std::string name_;
+    SpscRing<RealtimeLogRecord> ring_;
+    std::atomic<unsigned long> dropped_;
+    std::atomic<bool> running_;
+    boost::thread thread_;
+  };
+
+  /// Lets a trace of the real-time thread through at most once per period, as the ROS_*_THROTTLE macros
+  class LogThrottle
+  {
+  public:
+    /// \param period Minimum time between two traces [s]
+    explicit LogThrottle(double period = 1.0)
+    : period_(period)
+    {
+    }
+
+    /// Whether to trace at this time (real-time safe)
+    bool ready(const ros::Time& time)
+    {
+      if (!last_.isZero() && time >= last_ && (time - last_).toSec() < period_)
+        return false;
+      last_ = time;
+      return true;
+    }
+
+  private:
+    double period_;
+    ros::Time last_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_REALTIME_LOGGER_H
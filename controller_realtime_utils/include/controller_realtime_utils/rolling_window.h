@@ -0,0 +1,110 @@
+#ifndef CONTROLLER_REALTIME_UTILS_ROLLING_WINDOW_H
+#define CONTROLLER_REALTIME_UTILS_ROLLING_WINDOW_H
+
+#include <cstddef>
+#include <vector>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Rolling mean and variance of the last values, over a preallocated window
+   * push() is O(1), also in the worst case: the running sums are updated with the new
+   * value and the one it replaces. Sums of the values pushed since the window last
+   * wrapped around are kept too: when it wraps they hold exactly the window, and
+   * replace the running sums, so the rounding errors do not build up past one pass.
+   * Only resize() allocates, push() and clear() are real-time safe.
+   */
+  template<typename T>
+  class RollingWindow
+  {
+  public:
+    /**
+     * \brief Constructor
+     * \param capacity Number of values the statistics are computed on, at least 1
+     */
+    explicit RollingWindow(std::size_t capacity = 1)
+    {
+      resize(capacity);
+    }
+
+    /// Changes the window size and clears it (non real-time)
+    void resize(std::size_t capacity)
+    {
+      values_.assign(capacity > 0 ? capacity : 1, T(0));
+      clear();
+    }
+
+    /// Forgets every value (real-time safe)
+    void clear()
+    {
+      next_ = 0;
+      size_ = 0;
+      sum_ = T(0);
+      sum_squares_ = T(0);
+      pass_sum_ = T(0);
+      pass_sum_squares_ = T(0);
+    }
+
+    /// Adds a value, replacing the oldest one once the window is full (real-time safe)
+    void push(T value)
+    {
+      if (size_ == values_.size())
+      {
+        const T oldest = values_[next_];
+        sum_ -= oldest;
+        sum_squares_ -= oldest*oldest;
+      }
+      else
+        ++size_;
+
+      values_[next_] = value;
+      sum_ += value;
+      sum_squares_ += value*value;
+      pass_sum_ += value;
+      pass_sum_squares_ += value*value;
+
+      if (++next_ == values_.size())
+      {
+        // Every value of the window was pushed during this pass
+        next_ = 0;
+        sum_ = pass_sum_;
+        sum_squares_ = pass_sum_squares_;
+        pass_sum_ = T(0);
+        pass_sum_squares_ = T(0);
+      }
+    }
+
+    std::size_t size() const { return size_; }
+
+    std::size_t capacity() const { return values_.size(); }
+
+    /// Mean of the values in the window, 0 if it is empty
+    T mean() const
+    {
+      return size_ > 0 ? sum_/static_cast<T>(size_) : T(0);
+    }
+
+    /// Population variance of the values in the window, 0 if it is empty
+    T variance() const
+    {
+      if (size_ == 0)
+        return T(0);
+      const T mean = sum_/static_cast<T>(size_);
+      const T variance = sum_squares_/static_cast<T>(size_) - mean*mean;
+      return variance > T(0) ? variance : T(0);
+    }
+
+  private:
+    std::vector<T> values_;
+    std::size_t next_;
+    std::size_t size_;
+    T sum_;
+    T sum_squares_;
+    T pass_sum_;
+    T pass_sum_squares_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_ROLLING_WINDOW_H
@@ -0,0 +1,73 @@
+#ifndef CONTROLLER_REALTIME_UTILS_SEQLOCK_H
+#define CONTROLLER_REALTIME_UTILS_SEQLOCK_H
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+#include <type_traits>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Single writer, multiple readers latest-value cell
+   * The writer never blocks nor waits for the readers, which is what the real-time
+   * thread needs. A reader copies the value and retries if a write happened meanwhile.
+   * T must be trivially copyable, it is copied with memcpy.
+   */
+  template<typename T>
+  class SeqLock
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied with memcpy");
+
+  public:
+    SeqLock()
+    : sequence_(0)
+    , value_()
+    {
+    }
+
+    /// Publishes a new value (wait-free, single writer)
+    void write(const T& value)
+    {
+      const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+      sequence_.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      std::memcpy(&value_, &value, sizeof(T));
+      sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * \brief Copies the latest value
+     * \return false if a write was in progress, the copy is then invalid
+     */
+    bool tryRead(T& value) const
+    {
+      const uint32_t sequence = sequence_.load(std::memory_order_acquire);
+      if (sequence & 1)
+        return false;
+      std::memcpy(&value, &value_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return sequence_.load(std::memory_order_relaxed) == sequence;
+    }
+
+    /// Copies the latest value, retrying until no write overlapped the copy
+    void read(T& value) const
+    {
+      while (!tryRead(value)) {}
+    }
+
+    /// Number of writes so far (times 2), lets readers detect new values cheaply
+    uint32_t sequence() const
+    {
+      return sequence_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::atomic<uint32_t> sequence_;
+    T value_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_SEQLOCK_H
@@ -0,0 +1,39 @@
+#ifndef CONTROLLER_REALTIME_UTILS_SHARED_COMMAND_CHANNEL_H
+#define CONTROLLER_REALTIME_UTILS_SHARED_COMMAND_CHANNEL_H
+
+#include <controller_realtime_utils/shared_memory_ring.h>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Drive command exchanged through shared memory
+   * Each controller only uses the fields matching its command mode:
+   * speed and angular for twist commands, speed and steering angles otherwise.
+   * The controllers apply a command as soon as they read it: unlike the commands of the
+   * topics, it is neither delayed by cmd_delay nor smoothed by smooth_commands, the
+   * planner writing it is expected to do both. Its stamp only serves the command timeout
+   * and the latency diagnostics.
+   */
+  struct SharedCommand
+  {
+    double stamp;           // time the command was sent, ROS time [s], 0 for when it is read
+    double speed;           // [m/s]
+    double angular;         // [rad/s]
+    double front_steering;  // front virtual steering angle [rad], steering for ackermann
+    double rear_steering;   // rear virtual steering angle [rad]
+
+    SharedCommand() : stamp(0.0), speed(0.0), angular(0.0), front_steering(0.0), rear_steering(0.0) {}
+  };
+
+  /**
+   * Commands go from a planner on the same machine to a controller through a SharedMemoryRing.
+   * The controller owns the channel, it opens it with SharedCommandReader::open() so a restarted
+   * controller keeps its writer, the planner attaches with SharedCommandWriter::attach().
+   */
+  typedef SharedRingReader<SharedCommand> SharedCommandReader;
+  typedef SharedRingWriter<SharedCommand> SharedCommandWriter;
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_SHARED_COMMAND_CHANNEL_H
@@ -0,0 +1,180 @@
+#ifndef CONTROLLER_REALTIME_UTILS_SHARED_MEMORY_RING_H
+#define CONTROLLER_REALTIME_UTILS_SHARED_MEMORY_RING_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+namespace controller_realtime_utils
+{
+
+  /// Header of the shared memory segment, private to the implementation:
+  struct SharedMemoryRingHeader;
+
+  /**
+   * \brief Ring of fixed size records in POSIX shared memory, one writer and any number of readers
+   * Each slot is guarded by its own sequence counter: the writer of the record number n
+   * sets it to 2n+1 while writing and to 2n+2 once done. The writer never waits and
+   * overwrites the oldest records, a reader checks the counter around its copy to know
+   * whether the record is consistent and still the one it expects.
+   * Nothing goes through the ROS middleware and nothing is serialized.
+   */
+  class SharedMemoryRing
+  {
+  public:
+    SharedMemoryRing();
+
+    ~SharedMemoryRing();
+
+    /**
+     * \brief Attaches to the ring, or creates it if it does not exist or is not valid (non real-time)
+     * An existing valid ring is kept as is, so the other end stays attached.
+     * \param name        Name of the shared memory object, e.g. "/four_wheel_steering_cmd"
+     * \param record_size Size of a record [bytes]
+     * \param capacity    Minimum number of records, rounded up to a power of two,
+     *                    only used when the ring is created
+     * \return false if the shared memory could not be created or mapped
+     */
+    bool open(const std::string& name, std::size_t record_size, std::size_t capacity);
+
+    /**
+     * \brief Attaches to an existing ring (non real-time)
+     * \return false if the ring does not exist or does not hold records of this size
+     */
+    bool attach(const std::string& name, std::size_t record_size);
+
+    /// Detaches from the ring, the shared memory object is kept for the other end (non real-time)
+    void close();
+
+    bool isOpen() const { return header_ != NULL; }
+
+    /// Number of records written so far
+    uint64_t head() const;
+
+    /// Writes a record (wait-free, single writer)
+    void write(const void* record);
+
+    /**
+     * \brief Reads the record number next (wait-free)
+     * \param [in,out] next   Number of the record to read, moved past the records read or lost
+     * \param [out]    record Copy of the record
+     * \param [in,out] lost   Incremented by the number of records overwritten before being read
+     * \return false if there is no new record
+     */
+    bool read(uint64_t& next, void* record, uint64_t& lost) const;
+
+  private:
+    bool attachExisting(const std::string& name, std::size_t record_size, bool report_errors);
+    bool map(int fd, std::size_t size);
+
+    SharedMemoryRingHeader* header_;
+    char* slots_;
+    std::size_t size_;
+    std::size_t record_size_;
+    std::size_t slot_size_;
+    uint64_t mask_;
+  };
+
+  /**
+   * \brief Typed reading end of a SharedMemoryRing, with its own read position
+   * T must be trivially copyable, records are copied byte per byte between processes.
+   */
+  template<typename T>
+  class SharedRingReader
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Shared memory records are copied with memcpy");
+
+  public:
+    SharedRingReader()
+    : next_(0)
+    , lost_(0)
+    {
+    }
+
+    /// Attaches to the ring or creates it, the records already written are skipped (non real-time)
+    bool open(const std::string& name, std::size_t capacity)
+    {
+      return ring_.open(name, sizeof(T), capacity) && rewind();
+    }
+
+    /// Attaches to an existing ring, the records already written are skipped (non real-time)
+    bool attach(const std::string& name)
+    {
+      return ring_.attach(name, sizeof(T)) && rewind();
+    }
+
+    void close() { ring_.close(); }
+
+    bool isOpen() const { return ring_.isOpen(); }
+
+    /**
+     * \brief Reads the next record in writing order (real-time safe, wait-free)
+     * \return false if there is no new record
+     */
+    bool read(T& record)
+    {
+      return ring_.isOpen() && ring_.read(next_, &record, lost_);
+    }
+
+    /// Number of records overwritten before being read
+    uint64_t lost() const { return lost_; }
+
+  private:
+    bool rewind()
+    {
+      next_ = ring_.head();
+      lost_ = 0;
+      return true;
+    }
+
+    SharedMemoryRing ring_;
+    uint64_t next_;
+    uint64_t lost_;
+  };
+
+  /**
+   * \brief Typed writing end of a SharedMemoryRing
+   * Only one writer may be attached to a ring at a time.
+   */
+  template<typename T>
+  class SharedRingWriter
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Shared memory records are copied with memcpy");
+
+  public:
+    /// Attaches to the ring or creates it (non real-time)
+    bool open(const std::string& name, std::size_t capacity)
+    {
+      return ring_.open(name, sizeof(T), capacity);
+    }
+
+    /// Attaches to an existing ring (non real-time)
+    bool attach(const std::string& name)
+    {
+      return ring_.attach(name, sizeof(T));
+    }
+
+    void close() { ring_.close(); }
+
+    bool isOpen() const { return ring_.isOpen(); }
+
+    /**
+     * \brief Writes a record (real-time safe, wait-free, never blocks on the readers)
+     * \return false if the writer is not attached
+     */
+    bool write(const T& record)
+    {
+      if (!ring_.isOpen())
+        return false;
+      ring_.write(&record);
+      return true;
+    }
+
+  private:
+    SharedMemoryRing ring_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_SHARED_MEMORY_RING_H
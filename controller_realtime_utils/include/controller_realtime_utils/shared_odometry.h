@@ -0,0 +1,49 @@
+#ifndef CONTROLLER_REALTIME_UTILS_SHARED_ODOMETRY_H
+#define CONTROLLER_REALTIME_UTILS_SHARED_ODOMETRY_H
+
+#include <stdint.h>
+
+#include <controller_realtime_utils/shared_memory_ring.h>
+
+namespace controller_realtime_utils
+{
+
+  /// Maximum number of joint values an odometry sample is computed from:
+  const std::size_t SHARED_ODOMETRY_MAX_INPUTS = 8;
+
+  /**
+   * \brief Odometry computed by one update of a controller, with the joint values it comes from
+   * The meaning and order of the inputs is documented by each controller.
+   */
+  struct SharedOdometrySample
+  {
+    double stamp;     // ROS time [s]
+    double x;         // [m]
+    double y;         // [m]
+    double heading;   // [rad]
+    double linear_x;  // [m/s]
+    double linear_y;  // [m/s]
+    double angular;   // [rad/s]
+    uint32_t input_count;  // 0 in open loop
+    uint32_t reserved;
+    double inputs[SHARED_ODOMETRY_MAX_INPUTS];
+
+    SharedOdometrySample()
+    : stamp(0.0), x(0.0), y(0.0), heading(0.0), linear_x(0.0), linear_y(0.0), angular(0.0)
+    , input_count(0), reserved(0), inputs()
+    {
+    }
+  };
+
+  /**
+   * Every odometry sample goes from a controller to the processes on the same machine through
+   * a SharedMemoryRing, at the control rate and without serialization. The controller owns
+   * the ring, it opens it with SharedOdometryWriter::open(), each consumer attaches its own
+   * SharedOdometryReader with attach().
+   */
+  typedef SharedRingWriter<SharedOdometrySample> SharedOdometryWriter;
+  typedef SharedRingReader<SharedOdometrySample> SharedOdometryReader;
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_SHARED_ODOMETRY_H
@@ -0,0 +1,159 @@
+#ifndef CONTROLLER_REALTIME_UTILS_SPEED_LIMITER_H
+#define CONTROLLER_REALTIME_UTILS_SPEED_LIMITER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <string>
+
+#include <ros/ros.h>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Velocity, acceleration and jerk limits of N command axes, applied in one call
+   * The limits are stored axis by axis in arrays, a disabled limit being infinite, so limit()
+   * runs the same branch-free code whichever limits are enabled and the compiler can
+   * vectorize it over the axes.
+   * For a position axis (a steering angle), the velocity limits bound the position [rad],
+   * the acceleration limits its rate [rad/s] and so on.
+   */
+  template<typename T, std::size_t N>
+  class SpeedLimiter
+  {
+  public:
+    /// Constructor, no limits
+    SpeedLimiter()
+    {
+      for (std::size_t i = 0; i < N; ++i)
+      {
+        setVelocityLimits(i, false, T(0), T(0));
+        setAccelerationLimits(i, false, T(0), T(0));
+        setJerkLimits(i, false, T(0), T(0));
+      }
+    }
+
+    /**
+     * \brief Velocity limits setter
+     * \param axis    Axis index, < N
+     * \param enabled if false, the velocity of the axis is not limited
+     * \param min     Minimum velocity [m/s], usually <= 0
+     * \param max     Maximum velocity [m/s], usually >= 0
+     */
+    void setVelocityLimits(std::size_t axis, bool enabled, T min, T max)
+    {
+      min_velocity_[axis] = enabled ? min : -infinity();
+      max_velocity_[axis] = enabled ? max : infinity();
+    }
+
+    /**
+     * \brief Acceleration limits setter
+     * \param axis    Axis index, < N
+     * \param enabled if false, the acceleration of the axis is not limited
+     * \param min     Minimum acceleration [m/s^2], usually <= 0
+     * \param max     Maximum acceleration [m/s^2], usually >= 0
+     */
+    void setAccelerationLimits(std::size_t axis, bool enabled, T min, T max)
+    {
+      min_acceleration_[axis] = enabled ? min : -infinity();
+      max_acceleration_[axis] = enabled ? max : infinity();
+    }
+
+    /**
+     * \brief Jerk limits setter
+     * \param axis    Axis index, < N
+     * \param enabled if false, the jerk of the axis is not limited
+     * \param min     Minimum jerk [m/s^3], usually <= 0
+     * \param max     Maximum jerk [m/s^3], usually >= 0
+     * \see http://en.wikipedia.org/wiki/Jerk_%28physics%29#Motion_control
+     */
+    void setJerkLimits(std::size_t axis, bool enabled, T min, T max)
+    {
+      min_jerk_[axis] = enabled ? min : -infinity();
+      max_jerk_[axis] = enabled ? max : infinity();
+    }
+
+    /**
+     * \brief Limits the jerk, then the acceleration, then the velocity of every axis (real-time safe)
+     * \param [in, out] v  Velocities [m/s]
+     * \param [in]      v0 Previous velocities to v  [m/s]
+     * \param [in]      v1 Previous velocities to v0 [m/s]
+     * \param [in]      dt Time step [s]
+     */
+    void limit(T (&v)[N], const T (&v0)[N], const T (&v1)[N], T dt) const
+    {
+      const T dt2 = T(2)*dt*dt;
+      for (std::size_t i = 0; i < N; ++i)
+      {
+        const T dv0 = v0[i] - v1[i];
+        const T da = clamp(v[i] - v0[i] - dv0, min_jerk_[i]*dt2, max_jerk_[i]*dt2);
+        const T dv = clamp(dv0 + da, min_acceleration_[i]*dt, max_acceleration_[i]*dt);
+        v[i] = clamp(v0[i] + dv, min_velocity_[i], max_velocity_[i]);
+      }
+    }
+
+    /// Smallest absolute acceleration limit of an axis, infinite if not limited
+    T accelerationBound(std::size_t axis) const
+    {
+      return std::min(max_acceleration_[axis], -min_acceleration_[axis]);
+    }
+
+    /// Smallest absolute jerk limit of an axis, infinite if not limited
+    T jerkBound(std::size_t axis) const
+    {
+      return std::min(max_jerk_[axis], -min_jerk_[axis]);
+    }
+
+  private:
+    static T infinity()
+    {
+      return std::numeric_limits<T>::infinity();
+    }
+
+    /// Bounds of a disabled limit are NaN when dt is 0 (infinity*0), the argument order makes them no-ops
+    static T clamp(T x, T min, T max)
+    {
+      return std::min(std::max(x, min), max);
+    }
+
+    T min_velocity_[N], max_velocity_[N];
+    T min_acceleration_[N], max_acceleration_[N];
+    T min_jerk_[N], max_jerk_[N];
+  };
+
+  /**
+   * \brief Reads the limits of an axis from the parameters has_velocity_limits, min_velocity,
+   * max_velocity and the same for acceleration and jerk, in a namespace (non real-time)
+   * The minimum limits default to the opposite of the maximum ones.
+   * \param nh      Node handle of the controller
+   * \param ns      Parameter namespace of the axis, e.g. linear/x
+   * \param axis    Axis index, < N
+   * \param limiter Limiter to configure
+   */
+  template<typename T, std::size_t N>
+  void readSpeedLimits(const ros::NodeHandle& nh, const std::string& ns, std::size_t axis,
+                       SpeedLimiter<T, N>& limiter)
+  {
+    const char* kinds[] = {"velocity", "acceleration", "jerk"};
+    for (int k = 0; k < 3; ++k)
+    {
+      const std::string kind(kinds[k]);
+      bool enabled = false;
+      T max = T(0), min = T(0);
+      nh.param(ns + "/has_" + kind + "_limits", enabled, enabled);
+      nh.param(ns + "/max_" + kind, max, max);
+      nh.param(ns + "/min_" + kind, min, -max);
+
+      if (k == 0)
+        limiter.setVelocityLimits(axis, enabled, min, max);
+      else if (k == 1)
+        limiter.setAccelerationLimits(axis, enabled, min, max);
+      else
+        limiter.setJerkLimits(axis, enabled, min, max);
+    }
+  }
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_SPEED_LIMITER_H
@@ -0,0 +1,109 @@
+#ifndef CONTROLLER_REALTIME_UTILS_SPSC_RING_H
+#define CONTROLLER_REALTIME_UTILS_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Bounded lock-free queue between exactly one producer thread and one consumer thread
+   * Storage is allocated once at construction, push() and pop() never allocate,
+   * never block and are wait-free.
+   */
+  template<typename T>
+  class SpscRing
+  {
+  public:
+
+    /**
+     * \brief Constructor
+     * \param capacity Minimum number of elements, rounded up to a power of two
+     */
+    explicit SpscRing(std::size_t capacity)
+    : buffer_(roundUpPowerOfTwo(capacity))
+    , mask_(buffer_.size() - 1)
+    , head_(0)
+    , tail_(0)
+    {
+    }
+
+    /**
+     * \brief Producer side, copies the element into the ring
+     * \return false if the ring is full, the element is then discarded
+     */
+    bool push(const T& element)
+    {
+      const std::size_t head = head_.load(std::memory_order_relaxed);
+      if (head - tail_.load(std::memory_order_acquire) == buffer_.size())
+        return false;
+
+      buffer_[head & mask_] = element;
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief Consumer side, copies the oldest element out of the ring
+     * \return false if the ring is empty
+     */
+    bool pop(T& element)
+    {
+      const std::size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail == head_.load(std::memory_order_acquire))
+        return false;
+
+      element = buffer_[tail & mask_];
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief Consumer side, copies the oldest element but leaves it in the ring
+     * \return false if the ring is empty
+     */
+    bool peek(T& element) const
+    {
+      const std::size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail == head_.load(std::memory_order_acquire))
+        return false;
+
+      element = buffer_[tail & mask_];
+      return true;
+    }
+
+    /// Number of elements in the ring, only a snapshot when called concurrently
+    std::size_t size() const
+    {
+      return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    std::size_t capacity() const { return buffer_.size(); }
+
+  private:
+    static std::size_t roundUpPowerOfTwo(std::size_t n)
+    {
+      std::size_t power = 1;
+      while (power < n)
+        power <<= 1;
+      return power;
+    }
+
+    std::vector<T> buffer_;
+    const std::size_t mask_;
+
+    /// Producer and consumer indexes live on separate cache lines to avoid false sharing:
+    char padding0_[64];
+    std::atomic<std::size_t> head_;
+    char padding1_[64];
+    std::atomic<std::size_t> tail_;
+    char padding2_[64];
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_SPSC_RING_H
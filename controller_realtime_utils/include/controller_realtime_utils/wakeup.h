@@ -0,0 +1,54 @@
+#ifndef CONTROLLER_REALTIME_UTILS_WAKEUP_H
+#define CONTROLLER_REALTIME_UTILS_WAKEUP_H
+
+#include <atomic>
+#include <stdint.h>
+
+namespace controller_realtime_utils
+{
+
+  /**
+   * \brief Wakes a background thread from the real-time thread without a lock
+   * notify() bumps a sequence and only makes a system call (a futex wake, which
+   * never blocks) when the background thread is actually asleep. The background
+   * thread takes a token with prepare(), checks its work, then sleeps in wait()
+   * unless a notify() happened since the token was taken, so no wake up is lost.
+   * Only one thread may wait at a time.
+   */
+  class Wakeup
+  {
+  public:
+    Wakeup();
+
+    /// Wakes the waiting thread, if any (real-time safe)
+    void notify()
+    {
+      sequence_.fetch_add(1);
+      if (waiting_.load())
+        wake();
+    }
+
+    /// Token for wait(), to take before checking whether there is work to do
+    uint32_t prepare() const
+    {
+      return sequence_.load();
+    }
+
+    /**
+     * \brief Sleeps until notify() is called after prepare() returned the token (non real-time)
+     * \param token   Value returned by prepare()
+     * \param timeout Maximum time to sleep [s]
+     * \return false if it timed out (spurious wake ups are reported as true, check the work again)
+     */
+    bool wait(uint32_t token, double timeout);
+
+  private:
+    void wake();
+
+    std::atomic<uint32_t> sequence_;
+    std::atomic<bool> waiting_;
+  };
+
+} // namespace controller_realtime_utils
+
+#endif // CONTROLLER_REALTIME_UTILS_WAKEUP_H
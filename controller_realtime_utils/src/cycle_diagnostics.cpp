@@ -0,0 +1,127 @@
+#include <controller_realtime_utils/cycle_diagnostics.h>
+
+#include <sstream>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+namespace controller_realtime_utils
+{
+  /// Compute time histogram: 1 us buckets up to 5 ms
+  static const double COMPUTE_TIME_BUCKET_WIDTH = 1e-6;
+  static const std::size_t COMPUTE_TIME_BUCKET_COUNT = 5000;
+
+  /// Period histogram: 10 us buckets up to 50 ms
+  static const double PERIOD_BUCKET_WIDTH = 1e-5;
+  static const std::size_t PERIOD_BUCKET_COUNT = 5000;
+
+  /// Command latency histogram: 100 us buckets up to 1 s
+  static const double COMMAND_LATENCY_BUCKET_WIDTH = 1e-4;
+  static const std::size_t COMMAND_LATENCY_BUCKET_COUNT = 10000;
+
+  static diagnostic_msgs::KeyValue keyValue(const std::string& key, double value)
+  {
+    std::ostringstream os;
+    os << value;
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = os.str();
+    return key_value;
+  }
+
+  CycleDiagnostics::CycleDiagnostics()
+  : compute_time_(COMPUTE_TIME_BUCKET_WIDTH, COMPUTE_TIME_BUCKET_COUNT)
+  , period_(PERIOD_BUCKET_WIDTH, PERIOD_BUCKET_COUNT)
+  , command_latency_(COMMAND_LATENCY_BUCKET_WIDTH, COMMAND_LATENCY_BUCKET_COUNT)
+  , overruns_(0)
+  , last_overruns_(0)
+  {
+  }
+
+  void CycleDiagnostics::init(ros::NodeHandle& nh, const std::string& name, double publish_period)
+  {
+    name_ = name;
+    diagnostics_pub_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    timer_ = nh.createTimer(ros::Duration(publish_period), &CycleDiagnostics::publish, this);
+  }
+
+  void CycleDiagnostics::addCounter(const std::string& name, const boost::function<unsigned long()>& total)
+  {
+    Counter counter;
+    counter.name = name;
+    counter.total = total;
+    counter.last_total = total();
+    counters_.push_back(counter);
+  }
+
+  void CycleDiagnostics::publish(const ros::TimerEvent& /*event*/)
+  {
+    const CycleHistogram::Summary compute_time = compute_time_.summarize();
+    const CycleHistogram::Summary period = period_.summarize();
+    const CycleHistogram::Summary command_latency = command_latency_.summarize();
+    const unsigned long overruns_total = overruns_.load(std::memory_order_relaxed);
+    const unsigned long overruns = overruns_total - last_overruns_;
+    last_overruns_ = overruns_total;
+
+    std::string lost_work;
+    std::vector<diagnostic_msgs::KeyValue> counter_values;
+    for (std::size_t i = 0; i < counters_.size(); ++i)
+    {
+      const unsigned long total = counters_[i].total();
+      const unsigned long count = total - counters_[i].last_total;
+      counters_[i].last_total = total;
+      if (count > 0 && lost_work.empty())
+        lost_work = counters_[i].name;
+      counter_values.push_back(keyValue(counters_[i].name, count));
+      counter_values.push_back(keyValue(counters_[i].name + " total", total));
+    }
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = name_ + ": cycle";
+    status.hardware_id = name_;
+    if (compute_time.count == 0)
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::STALE;
+      status.message = "No update during the last period";
+    }
+    else if (overruns > 0)
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "Update overruns";
+    }
+    else if (!lost_work.empty())
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = lost_work;
+    }
+    else
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "OK";
+    }
+
+    status.values.push_back(keyValue("Cycles", compute_time.count));
+    status.values.push_back(keyValue("Overruns", overruns));
+    status.values.push_back(keyValue("Overruns total", overruns_total));
+    status.values.push_back(keyValue("Compute time p50 [us]", compute_time.p50*1e6));
+    status.values.push_back(keyValue("Compute time p99 [us]", compute_time.p99*1e6));
+    status.values.push_back(keyValue("Compute time max [us]", compute_time.max*1e6));
+    status.values.push_back(keyValue("Period p50 [us]", period.p50*1e6));
+    status.values.push_back(keyValue("Period p99 [us]", period.p99*1e6));
+    status.values.push_back(keyValue("Period max [us]", period.max*1e6));
+    status.values.push_back(keyValue("Period jitter p99-p50 [us]", (period.p99 - period.p50)*1e6));
+    if (command_latency.count > 0)
+    {
+      status.values.push_back(keyValue("Commands", command_latency.count));
+      status.values.push_back(keyValue("Command latency p50 [ms]", command_latency.p50*1e3));
+      status.values.push_back(keyValue("Command latency p99 [ms]", command_latency.p99*1e3));
+      status.values.push_back(keyValue("Command latency max [ms]", command_latency.max*1e3));
+    }
+    status.values.insert(status.values.end(), counter_values.begin(), counter_values.end());
+
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+    diagnostics.status.push_back(status);
+    diagnostics_pub_.publish(diagnostics);
+  }
+
+} // namespace controller_realtime_utils
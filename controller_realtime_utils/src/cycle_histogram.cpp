@@ -0,0 +1,63 @@
+#include <controller_realtime_utils/cycle_histogram.h>
+
+#include <algorithm>
+
+namespace controller_realtime_utils
+{
+
+  CycleHistogram::CycleHistogram(double bucket_width, std::size_t bucket_count)
+  : bucket_width_(bucket_width)
+  , bucket_count_(bucket_count)
+  , counts_(new std::atomic<uint32_t>[bucket_count + 1])
+  , max_(0.0)
+  , previous_(bucket_count + 1, 0)
+  {
+    for (std::size_t i = 0; i <= bucket_count_; ++i)
+      counts_[i].store(0);
+  }
+
+  CycleHistogram::Summary CycleHistogram::summarize()
+  {
+    // Window counts, unsigned arithmetic also handles the counters wrapping around
+    std::vector<uint32_t> window(bucket_count_ + 1);
+    unsigned long total = 0;
+    for (std::size_t i = 0; i <= bucket_count_; ++i)
+    {
+      const uint32_t count = counts_[i].load(std::memory_order_relaxed);
+      window[i] = count - previous_[i];
+      previous_[i] = count;
+      total += window[i];
+    }
+
+    Summary summary;
+    summary.count = total;
+    summary.p50 = 0.0;
+    summary.p99 = 0.0;
+    summary.max = max_.exchange(0.0, std::memory_order_relaxed);
+    if (total == 0)
+      return summary;
+
+    const double p50_rank = 0.50*total;
+    const double p99_rank = 0.99*total;
+    bool p50_found = false;
+    unsigned long cumulated = 0;
+    for (std::size_t i = 0; i <= bucket_count_; ++i)
+    {
+      cumulated += window[i];
+      // The overflow bucket has no upper edge, and no bucket goes beyond the maximum
+      const double upper_edge = i < bucket_count_ ? std::min(bucket_width_*(i + 1), summary.max) : summary.max;
+      if (!p50_found && cumulated >= p50_rank)
+      {
+        summary.p50 = upper_edge;
+        p50_found = true;
+      }
+      if (cumulated >= p99_rank)
+      {
+        summary.p99 = upper_edge;
+        break;
+      }
+    }
+    return summary;
+  }
+
+} // namespace controller_realtime_utils
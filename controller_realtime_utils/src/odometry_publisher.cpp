@@ -0,0 +1,164 @@
+#include <controller_realtime_utils/odometry_publisher.h>
+
+#include <cmath>
+
+namespace controller_realtime_utils
+{
+  /// The publisher thread checks whether it must stop at least this often [s]:
+  static const double STOP_CHECK_PERIOD = 0.1;
+
+  OdometryPublisher::OdometryPublisher()
+  : written_(0)
+  , dropped_samples_(0)
+  , enable_odom_tf_(false)
+  , published_index_(0)
+  , skipped_snapshots_(0)
+  , running_(false)
+  {
+  }
+
+  OdometryPublisher::~OdometryPublisher()
+  {
+    stop();
+  }
+
+  void OdometryPublisher::init(ros::NodeHandle& root_nh, ros::NodeHandle& controller_nh,
+                               const std::string& base_frame_id,
+                               const boost::array<double, 6>& pose_covariance_diagonal,
+                               const boost::array<double, 6>& twist_covariance_diagonal,
+                               bool enable_odom_tf)
+  {
+    odom_pub_ = controller_nh.advertise<nav_msgs::Odometry>("odom", 100);
+    odom_.header.frame_id = "odom";
+    odom_.child_frame_id = base_frame_id;
+    odom_.pose.pose.position.z = 0;
+    odom_.pose.pose.orientation.x = 0;
+    odom_.pose.pose.orientation.y = 0;
+    odom_.twist.twist.linear.z  = 0;
+    odom_.twist.twist.angular.x = 0;
+    odom_.twist.twist.angular.y = 0;
+    odom_.pose.covariance.assign(0.0);
+    odom_.twist.covariance.assign(0.0);
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+      odom_.pose.covariance[7*i] = pose_covariance_diagonal[i];
+      odom_.twist.covariance[7*i] = twist_covariance_diagonal[i];
+    }
+
+    enable_odom_tf_ = enable_odom_tf;
+    if (enable_odom_tf_)
+    {
+      tf_odom_pub_ = root_nh.advertise<tf::tfMessage>("/tf", 100);
+      tf_odom_.transforms.resize(1);
+      tf_odom_.transforms[0].transform.translation.z = 0.0;
+      tf_odom_.transforms[0].transform.rotation.x = 0.0;
+      tf_odom_.transforms[0].transform.rotation.y = 0.0;
+      tf_odom_.transforms[0].child_frame_id = base_frame_id;
+      tf_odom_.transforms[0].header.frame_id = "odom";
+    }
+  }
+
+  void OdometryPublisher::initSamples(ros::NodeHandle& controller_nh, std::size_t capacity)
+  {
+    samples_.reset(new SpscRing<OdometrySnapshot>(capacity));
+    samples_pub_ = controller_nh.advertise<four_wheel_steering_msgs::OdometrySampleArray>("odom_samples", 100);
+    samples_msg_.header.frame_id = odom_.header.frame_id;
+    samples_msg_.child_frame_id = odom_.child_frame_id;
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+      samples_msg_.pose_covariance_diagonal[i] = odom_.pose.covariance[7*i];
+      samples_msg_.twist_covariance_diagonal[i] = odom_.twist.covariance[7*i];
+    }
+    samples_msg_.samples.reserve(samples_->capacity());
+  }
+
+  void OdometryPublisher::start()
+  {
+    stop();
+    running_ = true;
+    thread_ = boost::thread(&OdometryPublisher::run, this);
+  }
+
+  void OdometryPublisher::stop()
+  {
+    running_ = false;
+    wakeup_.notify();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  void OdometryPublisher::run()
+  {
+    while (running_)
+    {
+      const uint32_t token = wakeup_.prepare();
+      OdometrySnapshot snapshot;
+      snapshot_.read(snapshot);
+      if (snapshot.index != published_index_)
+      {
+        skipped_snapshots_.fetch_add(snapshot.index - published_index_ - 1, std::memory_order_relaxed);
+        published_index_ = snapshot.index;
+        publish(snapshot);
+        publishSamples();
+      }
+      else
+        wakeup_.wait(token, STOP_CHECK_PERIOD);
+    }
+  }
+
+  void OdometryPublisher::publish(const OdometrySnapshot& snapshot)
+  {
+    // Yaw only quaternion
+    const double qz = sin(snapshot.heading/2.0);
+    const double qw = cos(snapshot.heading/2.0);
+
+    odom_.header.stamp = snapshot.stamp;
+    odom_.pose.pose.position.x = snapshot.x;
+    odom_.pose.pose.position.y = snapshot.y;
+    odom_.pose.pose.orientation.z = qz;
+    odom_.pose.pose.orientation.w = qw;
+    odom_.twist.twist.linear.x  = snapshot.linear_x;
+    odom_.twist.twist.linear.y  = snapshot.linear_y;
+    odom_.twist.twist.angular.z = snapshot.angular;
+    odom_pub_.publish(odom_);
+
+    if (enable_odom_tf_)
+    {
+      geometry_msgs::TransformStamped& odom_frame = tf_odom_.transforms[0];
+      odom_frame.header.stamp = snapshot.stamp;
+      odom_frame.transform.translation.x = snapshot.x;
+      odom_frame.transform.translation.y = snapshot.y;
+      odom_frame.transform.rotation.z = qz;
+      odom_frame.transform.rotation.w = qw;
+      tf_odom_pub_.publish(tf_odom_);
+    }
+  }
+
+  void OdometryPublisher::publishSamples()
+  {
+    if (!samples_)
+      return;
+
+    samples_msg_.samples.clear();
+    OdometrySnapshot sample;
+    while (samples_->pop(sample))
+    {
+      if (samples_msg_.samples.empty())
+        samples_msg_.header.stamp = sample.stamp;
+
+      four_wheel_steering_msgs::OdometrySample compact;
+      compact.time_offset = (sample.stamp - samples_msg_.header.stamp).toSec();
+      compact.x = sample.x;
+      compact.y = sample.y;
+      compact.heading = sample.heading;
+      compact.linear_x = sample.linear_x;
+      compact.linear_y = sample.linear_y;
+      compact.angular = sample.angular;
+      samples_msg_.samples.push_back(compact);
+    }
+
+    if (!samples_msg_.samples.empty())
+      samples_pub_.publish(samples_msg_);
+  }
+
+} // namespace controller_realtime_utils
@@ -0,0 +1,124 @@
+#include <controller_realtime_utils/persistent_state.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <ros/ros.h>
+
+namespace controller_realtime_utils
+{
+  /// Identifies a state file, changes with the layout:
+  static const uint64_t STATE_FILE_MAGIC = 0x43544c5354415401ULL;
+
+  struct StateFileHeader
+  {
+    uint64_t magic;
+    uint64_t record_size;
+    /// Odd while the record is being written:
+    std::atomic<uint64_t> sequence;
+    char padding[40];
+  };
+
+  StateFile::StateFile()
+  : header_(NULL)
+  , record_(NULL)
+  , size_(0)
+  , record_size_(0)
+  {
+  }
+
+  StateFile::~StateFile()
+  {
+    close();
+  }
+
+  bool StateFile::open(const std::string& path, std::size_t record_size)
+  {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+      ROS_ERROR_STREAM("Could not open state file " << path << ": " << strerror(errno));
+      return false;
+    }
+
+    struct statfs filesystem;
+    if (fstatfs(fd, &filesystem) == 0 && filesystem.f_type != TMPFS_MAGIC)
+      ROS_WARN_STREAM("State file " << path << " is not on a tmpfs (e.g. /dev/shm), "
+                      "storing the state may block the real-time thread on page faults");
+
+    const std::size_t size = sizeof(StateFileHeader) + record_size;
+    struct stat status;
+    const bool valid_size = fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) == size;
+    if (!valid_size && ftruncate(fd, size) != 0)
+    {
+      ROS_ERROR_STREAM("Could not resize state file " << path << ": " << strerror(errno));
+      ::close(fd);
+      return false;
+    }
+
+    void* address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+      ROS_ERROR_STREAM("Could not map state file " << path << ": " << strerror(errno));
+      return false;
+    }
+
+    header_ = static_cast<StateFileHeader*>(address);
+    record_ = static_cast<char*>(address) + sizeof(StateFileHeader);
+    size_ = size;
+    record_size_ = record_size;
+
+    if (!valid_size || header_->magic != STATE_FILE_MAGIC || header_->record_size != record_size)
+    {
+      ROS_WARN_STREAM("State file " << path << " holds no valid state, it is reset");
+      header_->magic = STATE_FILE_MAGIC;
+      header_->record_size = record_size;
+      // 0 marks an empty file, a stored record has an even non-zero sequence
+      new (&header_->sequence) std::atomic<uint64_t>(0);
+      std::memset(record_, 0, record_size);
+    }
+    return true;
+  }
+
+  void StateFile::close()
+  {
+    if (header_ != NULL)
+      munmap(header_, size_);
+    header_ = NULL;
+    record_ = NULL;
+    size_ = 0;
+  }
+
+  bool StateFile::load(void* record) const
+  {
+    const uint64_t sequence = header_->sequence.load(std::memory_order_acquire);
+    if (sequence == 0 || (sequence & 1))
+      return false;
+    std::memcpy(record, record_, record_size_);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header_->sequence.load(std::memory_order_relaxed) == sequence;
+  }
+
+  void StateFile::store(const void* record)
+  {
+    const uint64_t sequence = header_->sequence.load(std::memory_order_relaxed);
+    header_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(record_, record, record_size_);
+    header_->sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+} // namespace controller_realtime_utils
@@ -0,0 +1,114 @@
+#include <controller_realtime_utils/pose_history.h>
+
+#include <cstring>
+#include <limits>
+
+namespace controller_realtime_utils
+{
+
+  PoseHistory::PoseHistory(std::size_t capacity)
+  : capacity_(0)
+  , head_(0)
+  , first_(0)
+  , last_stamp_(-std::numeric_limits<double>::infinity())
+  {
+    setCapacity(capacity);
+  }
+
+  void PoseHistory::setCapacity(std::size_t capacity)
+  {
+    slots_.reset(capacity > 0 ? new Slot[capacity] : NULL);
+    capacity_ = capacity;
+    for (std::size_t i = 0; i < capacity_; ++i)
+    {
+      // Sequence 0 never matches a written pose (2*index + 2)
+      slots_[i].sequence.store(0, std::memory_order_relaxed);
+      std::memset(&slots_[i].pose, 0, sizeof(StampedPose));
+    }
+    head_.store(0, std::memory_order_release);
+    first_.store(0, std::memory_order_release);
+    last_stamp_ = -std::numeric_limits<double>::infinity();
+  }
+
+  void PoseHistory::clear()
+  {
+    first_.store(head_.load(std::memory_order_relaxed), std::memory_order_release);
+    last_stamp_ = -std::numeric_limits<double>::infinity();
+  }
+
+  bool PoseHistory::add(double stamp, double x, double y, double heading)
+  {
+    if (capacity_ == 0 || !(stamp > last_stamp_))
+      return false;
+    last_stamp_ = stamp;
+
+    const StampedPose pose = {stamp, x, y, heading};
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[head % capacity_];
+    slot.sequence.store(2*head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.pose, &pose, sizeof(StampedPose));
+    slot.sequence.store(2*head + 2, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool PoseHistory::read(uint64_t index, StampedPose& pose) const
+  {
+    const Slot& slot = slots_[index % capacity_];
+    const uint64_t expected = 2*index + 2;
+    if (slot.sequence.load(std::memory_order_acquire) != expected)
+      return false;
+    std::memcpy(&pose, &slot.pose, sizeof(StampedPose));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+  }
+
+  bool PoseHistory::lookup(double stamp, StampedPose& pose) const
+  {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t first = first_.load(std::memory_order_acquire);
+    if (head - first > capacity_)
+      first = head - capacity_;
+    if (head == first)
+      return false;
+
+    StampedPose newer;
+    if (!read(head - 1, newer) || stamp > newer.stamp)
+      return false;
+
+    // First pose not older than stamp, a pose overwritten meanwhile was older than all the others
+    uint64_t low = first;
+    uint64_t high = head - 1;
+    while (low < high)
+    {
+      const uint64_t middle = low + (high - low)/2;
+      StampedPose sample;
+      if (read(middle, sample) && sample.stamp >= stamp)
+      {
+        high = middle;
+        newer = sample;
+      }
+      else
+        low = middle + 1;
+    }
+
+    if (newer.stamp == stamp)
+    {
+      pose = newer;
+      return true;
+    }
+
+    StampedPose older;
+    if (high == first || !read(high - 1, older) || older.stamp > stamp)
+      return false;
+
+    const double ratio = (stamp - older.stamp)/(newer.stamp - older.stamp);
+    pose.stamp = stamp;
+    pose.x = older.x + ratio*(newer.x - older.x);
+    pose.y = older.y + ratio*(newer.y - older.y);
+    pose.heading = older.heading + ratio*(newer.heading - older.heading);
+    return true;
+  }
+
+} // namespace controller_realtime_utils
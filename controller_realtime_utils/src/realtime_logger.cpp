@@ -0,0 +1,100 @@
+#include <controller_realtime_utils/realtime_logger.h>
+
+#include <cstdio>
+#include <ostream>
+
+namespace controller_realtime_utils
+{
+  /// Period of the logger thread polling [s]:
+  static const double POLLING_PERIOD = 0.01;
+
+  /// Record formatted when streamed, the stream macros only do it if the logger is enabled for their level
+  struct FormattedRecord
+  {
+    const RealtimeLogRecord& record;
+  };
+
+  static std::ostream& operator<<(std::ostream& stream, const FormattedRecord& formatted)
+  {
+    return stream << RealtimeLogger::format(formatted.record);
+  }
+
+  RealtimeLogger::RealtimeLogger(std::size_t capacity)
+  : ring_(capacity)
+  , dropped_(0)
+  , running_(false)
+  {
+  }
+
+  RealtimeLogger::~RealtimeLogger()
+  {
+    stop();
+  }
+
+  void RealtimeLogger::start(const std::string& name)
+  {
+    stop();
+    name_ = name;
+    running_ = true;
+    thread_ = boost::thread(&RealtimeLogger::run, this);
+  }
+
+  void RealtimeLogger::stop()
+  {
+    running_ = false;
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  std::string RealtimeLogger::format(const RealtimeLogRecord& record)
+  {
+    char buffer[512];
+    const double* v = record.values;
+    switch (record.value_count)
+    {
+      case 0: snprintf(buffer, sizeof(buffer), "%s", record.format); break;
+      case 1: snprintf(buffer, sizeof(buffer), record.format, v[0]); break;
+      case 2: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1]); break;
+      case 3: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1], v[2]); break;
+      case 4: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1], v[2], v[3]); break;
+      case 5: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1], v[2], v[3], v[4]); break;
+      case 6: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1], v[2], v[3], v[4], v[5]); break;
+      case 7: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1], v[2], v[3], v[4], v[5], v[6]); break;
+      default: snprintf(buffer, sizeof(buffer), record.format, v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]); break;
+    }
+    return buffer;
+  }
+
+  void RealtimeLogger::run()
+  {
+    while (running_)
+    {
+      flush();
+      boost::this_thread::sleep_for(boost::chrono::duration<double>(POLLING_PERIOD));
+    }
+    flush();
+  }
+
+  void RealtimeLogger::flush()
+  {
+    RealtimeLogRecord record;
+    while (ring_.pop(record))
+    {
+      const FormattedRecord formatted = {record};
+      switch (record.level)
+      {
+        case ros::console::levels::Debug: ROS_DEBUG_STREAM_NAMED(name_, formatted); break;
+        case ros::console::levels::Info:  ROS_INFO_STREAM_NAMED(name_, formatted); break;
+        case ros::console::levels::Warn:  ROS_WARN_STREAM_NAMED(name_, formatted); break;
+        default:                          ROS_ERROR_STREAM_NAMED(name_, formatted); break;
+      }
+    }
+
+    const unsigned long dropped = dropped_.exchange(0);
+    if (dropped > 0)
+    {
+      ROS_WARN_NAMED(name_, "%lu realtime log records dropped, the log ring is full", dropped);
+    }
+  }
+
+} // namespace controller_realtime_utils
@@ -0,0 +1,218 @@
+#include <controller_realtime_utils/shared_memory_ring.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ros/ros.h>
+
+namespace controller_realtime_utils
+{
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory atomics must be lock-free to be address-free");
+
+  /// Identifies an initialized ring, changes with the layout:
+  static const uint64_t SHARED_MEMORY_RING_MAGIC = 0x43544c52494e0002ULL;
+
+  struct SharedMemoryRingHeader
+  {
+    std::atomic<uint64_t> magic;
+    uint64_t capacity;
+    uint64_t record_size;
+    char padding0[40];
+    /// Number of records written so far, on its own cache line:
+    std::atomic<uint64_t> head;
+    char padding1[56];
+  };
+
+  /// A slot is the sequence counter followed by the record, padded to keep the counters aligned
+  static std::size_t slotSize(std::size_t record_size)
+  {
+    return sizeof(std::atomic<uint64_t>) + (record_size + 7)/8*8;
+  }
+
+  static std::size_t segmentSize(std::size_t record_size, uint64_t capacity)
+  {
+    return sizeof(SharedMemoryRingHeader) + capacity*slotSize(record_size);
+  }
+
+  static uint64_t roundUpPowerOfTwo(std::size_t n)
+  {
+    uint64_t power = 1;
+    while (power < n)
+      power <<= 1;
+    return power;
+  }
+
+  static std::atomic<uint64_t>& slotSequence(char* slot)
+  {
+    return *reinterpret_cast<std::atomic<uint64_t>*>(slot);
+  }
+
+  SharedMemoryRing::SharedMemoryRing()
+  : header_(NULL)
+  , slots_(NULL)
+  , size_(0)
+  , record_size_(0)
+  , slot_size_(0)
+  , mask_(0)
+  {
+  }
+
+  SharedMemoryRing::~SharedMemoryRing()
+  {
+    close();
+  }
+
+  bool SharedMemoryRing::map(int fd, std::size_t size)
+  {
+    void* address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+      return false;
+
+    header_ = static_cast<SharedMemoryRingHeader*>(address);
+    slots_ = static_cast<char*>(address) + sizeof(SharedMemoryRingHeader);
+    size_ = size;
+    return true;
+  }
+
+  bool SharedMemoryRing::attach(const std::string& name, std::size_t record_size)
+  {
+    return attachExisting(name, record_size, true);
+  }
+
+  bool SharedMemoryRing::attachExisting(const std::string& name, std::size_t record_size, bool report_errors)
+  {
+    close();
+
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+      if (report_errors)
+        ROS_ERROR_STREAM("Could not open shared memory " << name << ": " << strerror(errno));
+      return false;
+    }
+
+    struct stat status;
+    const bool mapped = fstat(fd, &status) == 0
+                     && static_cast<std::size_t>(status.st_size) >= sizeof(SharedMemoryRingHeader)
+                     && map(fd, status.st_size);
+    ::close(fd);
+
+    const uint64_t capacity = mapped ? header_->capacity : 0;
+    if (!mapped
+        || header_->magic.load(std::memory_order_acquire) != SHARED_MEMORY_RING_MAGIC
+        || header_->record_size != record_size
+        || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || size_ != segmentSize(record_size, capacity))
+    {
+      if (report_errors)
+        ROS_ERROR_STREAM("Shared memory " << name << " is not a ring of " << record_size << " bytes records");
+      close();
+      return false;
+    }
+
+    record_size_ = record_size;
+    slot_size_ = slotSize(record_size);
+    mask_ = capacity - 1;
+
+    // Fault the pages in now rather than in the real-time loop
+    for (uint64_t i = 0; i < capacity; ++i)
+      slotSequence(slots_ + i*slot_size_).load(std::memory_order_relaxed);
+    return true;
+  }
+
+  bool SharedMemoryRing::open(const std::string& name, std::size_t record_size, std::size_t capacity)
+  {
+    // Keep a valid existing ring, the other end may already use it
+    if (attachExisting(name, record_size, false))
+      return true;
+
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0660);
+    const uint64_t ring_capacity = roundUpPowerOfTwo(capacity);
+    const std::size_t size = segmentSize(record_size, ring_capacity);
+    if (fd < 0 || ftruncate(fd, size) != 0 || !map(fd, size))
+    {
+      ROS_ERROR_STREAM("Could not create shared memory " << name << ": " << strerror(errno));
+      if (fd >= 0)
+        ::close(fd);
+      header_ = NULL;
+      return false;
+    }
+    ::close(fd);
+
+    record_size_ = record_size;
+    slot_size_ = slotSize(record_size);
+    mask_ = ring_capacity - 1;
+
+    // The magic is written last, no one attaches to a half initialized ring
+    new (&header_->head) std::atomic<uint64_t>(0);
+    header_->capacity = ring_capacity;
+    header_->record_size = record_size;
+    for (uint64_t i = 0; i < ring_capacity; ++i)
+      new (slots_ + i*slot_size_) std::atomic<uint64_t>(0);
+    header_->magic.store(SHARED_MEMORY_RING_MAGIC, std::memory_order_release);
+    return true;
+  }
+
+  void SharedMemoryRing::close()
+  {
+    if (header_ != NULL)
+      munmap(header_, size_);
+    header_ = NULL;
+    slots_ = NULL;
+    size_ = 0;
+  }
+
+  uint64_t SharedMemoryRing::head() const
+  {
+    return header_->head.load(std::memory_order_acquire);
+  }
+
+  void SharedMemoryRing::write(const void* record)
+  {
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    char* slot = slots_ + (head & mask_)*slot_size_;
+    std::atomic<uint64_t>& sequence = slotSequence(slot);
+    sequence.store(2*head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(slot + sizeof(std::atomic<uint64_t>), record, record_size_);
+    sequence.store(2*head + 2, std::memory_order_release);
+    header_->head.store(head + 1, std::memory_order_release);
+  }
+
+  bool SharedMemoryRing::read(uint64_t& next, void* record, uint64_t& lost) const
+  {
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    const uint64_t capacity = mask_ + 1;
+    if (head - next > capacity)
+    {
+      lost += head - next - capacity;
+      next = head - capacity;
+    }
+
+    // Each slot is tried once, a slot overwritten meanwhile counts as lost
+    while (next != head)
+    {
+      char* slot = slots_ + (next & mask_)*slot_size_;
+      const std::atomic<uint64_t>& sequence = slotSequence(slot);
+      const uint64_t expected = 2*next + 2;
+      ++next;
+      if (sequence.load(std::memory_order_acquire) == expected)
+      {
+        std::memcpy(record, slot + sizeof(std::atomic<uint64_t>), record_size_);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == expected)
+          return true;
+      }
+      ++lost;
+    }
+    return false;
+  }
+
+} // namespace controller_realtime_utils
@@ -0,0 +1,44 @@
+#include <controller_realtime_utils/wakeup.h>
+
+#include <cerrno>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace controller_realtime_utils
+{
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the futex word must be a plain 32 bit integer");
+
+  Wakeup::Wakeup()
+  : sequence_(0)
+  , waiting_(false)
+  {
+  }
+
+  bool Wakeup::wait(uint32_t token, double timeout)
+  {
+    // Both sides use sequentially consistent operations: either notify() sees waiting_
+    // and wakes the futex, or the futex sees the new sequence and does not sleep
+    waiting_.store(true);
+    bool notified = sequence_.load() != token;
+    if (!notified)
+    {
+      struct timespec relative;
+      relative.tv_sec = static_cast<time_t>(timeout);
+      relative.tv_nsec = static_cast<long>((timeout - relative.tv_sec)*1e9);
+      const long result = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence_), FUTEX_WAIT_PRIVATE,
+                                  token, &relative, NULL, 0);
+      notified = result == 0 || errno != ETIMEDOUT;
+    }
+    waiting_.store(false);
+    return notified;
+  }
+
+  void Wakeup::wake()
+  {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence_), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
+
+} // namespace controller_realtime_utils
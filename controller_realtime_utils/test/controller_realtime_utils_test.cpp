@@ -0,0 +1,607 @@
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <controller_realtime_utils/command_queue.h>
+#include <controller_realtime_utils/cycle_histogram.h>
+#include <controller_realtime_utils/jerk_limited_profile.h>
+#include <controller_realtime_utils/persistent_state.h>
+#include <controller_realtime_utils/pose_history.h>
+#include <controller_realtime_utils/realtime_logger.h>
+#include <controller_realtime_utils/rolling_window.h>
+#include <controller_realtime_utils/seqlock.h>
+#include <controller_realtime_utils/shared_command_channel.h>
+#include <controller_realtime_utils/shared_odometry.h>
+#include <controller_realtime_utils/speed_limiter.h>
+#include <controller_realtime_utils/spsc_ring.h>
+#include <controller_realtime_utils/wakeup.h>
+
+using namespace controller_realtime_utils;
+
+TEST(SpscRingTest, testCapacity)
+{
+  EXPECT_EQ(SpscRing<int>(1).capacity(), 1u);
+  EXPECT_EQ(SpscRing<int>(100).capacity(), 128u);
+  EXPECT_EQ(SpscRing<int>(128).capacity(), 128u);
+}
+
+TEST(SpscRingTest, testFifoAndFull)
+{
+  SpscRing<int> ring(4);
+  int value = 0;
+  EXPECT_FALSE(ring.pop(value));
+
+  // Several laps around the ring
+  for (int lap = 0; lap < 3; ++lap)
+  {
+    for (int i = 0; i < 4; ++i)
+      EXPECT_TRUE(ring.push(10*lap + i));
+    EXPECT_FALSE(ring.push(-1));
+    EXPECT_EQ(ring.size(), 4u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+      ASSERT_TRUE(ring.pop(value));
+      EXPECT_EQ(value, 10*lap + i);
+    }
+    EXPECT_TRUE(ring.empty());
+  }
+}
+
+TEST(SpscRingTest, testConcurrentOrder)
+{
+  const int count = 100000;
+  SpscRing<int> ring(64);
+
+  std::thread producer([&ring, count]()
+  {
+    for (int i = 0; i < count; ++i)
+      while (!ring.push(i))
+        std::this_thread::yield();
+  });
+
+  int expected = 0;
+  int value;
+  while (expected < count)
+  {
+    if (ring.pop(value))
+    {
+      ASSERT_EQ(value, expected);
+      ++expected;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(RealtimeLoggerTest, testFormat)
+{
+  RealtimeLogRecord record;
+  record.level = ros::console::levels::Debug;
+  record.format = "lin %.2f ang %g";
+  record.value_count = 2;
+  record.values[0] = 1.5;
+  record.values[1] = -0.25;
+  EXPECT_EQ(RealtimeLogger::format(record), "lin 1.50 ang -0.25");
+
+  record.format = "no value";
+  record.value_count = 0;
+  EXPECT_EQ(RealtimeLogger::format(record), "no value");
+}
+
+TEST(RealtimeLoggerTest, testDropWhenFull)
+{
+  // Logger thread not started, nothing is consumed
+  RealtimeLogger logger(2);
+  EXPECT_TRUE(logger.debug("a %f", 1));
+  EXPECT_TRUE(logger.info("b %f %f", 1, 2.0f));
+  EXPECT_FALSE(logger.warn("c"));
+}
+
+TEST(LogThrottleTest, testOncePerPeriod)
+{
+  LogThrottle throttle(1.0);
+  EXPECT_TRUE(throttle.ready(ros::Time(10.0)));
+  EXPECT_FALSE(throttle.ready(ros::Time(10.5)));
+  EXPECT_FALSE(throttle.ready(ros::Time(10.999)));
+  EXPECT_TRUE(throttle.ready(ros::Time(11.0)));
+  EXPECT_FALSE(throttle.ready(ros::Time(11.2)));
+  // The clock went back, e.g. a simulation was restarted
+  EXPECT_TRUE(throttle.ready(ros::Time(2.0)));
+  EXPECT_FALSE(throttle.ready(ros::Time(2.5)));
+}
+
+TEST(CycleHistogramTest, testPercentiles)
+{
+  CycleHistogram histogram(1.0, 100);
+  for (int i = 0; i < 1000; ++i)
+    histogram.add(i % 100 + 0.5);
+
+  const CycleHistogram::Summary summary = histogram.summarize();
+  EXPECT_EQ(summary.count, 1000u);
+  EXPECT_DOUBLE_EQ(summary.p50, 50.0);
+  EXPECT_DOUBLE_EQ(summary.p99, 99.0);
+  EXPECT_DOUBLE_EQ(summary.max, 99.5);
+}
+
+TEST(CycleHistogramTest, testWindowAndOverflow)
+{
+  CycleHistogram histogram(1.0, 10);
+  histogram.add(2.5);
+  histogram.summarize();
+
+  // Only the values added since the previous summary are taken into account
+  const CycleHistogram::Summary empty = histogram.summarize();
+  EXPECT_EQ(empty.count, 0u);
+  EXPECT_EQ(empty.max, 0.0);
+
+  for (int i = 0; i < 98; ++i)
+    histogram.add(0.2);
+  histogram.add(-1.0);
+  histogram.add(42.0);
+  const CycleHistogram::Summary summary = histogram.summarize();
+  EXPECT_EQ(summary.count, 100u);
+  EXPECT_DOUBLE_EQ(summary.p50, 1.0);
+  EXPECT_DOUBLE_EQ(summary.p99, 1.0);
+  EXPECT_DOUBLE_EQ(summary.max, 42.0);
+
+  histogram.add(42.0);
+  EXPECT_DOUBLE_EQ(histogram.summarize().p99, 42.0);
+}
+
+struct StampedValue
+{
+  int value;
+  ros::Time stamp;
+};
+
+TEST(CommandQueueTest, testPopDueInOrder)
+{
+  CommandQueue<StampedValue> queue(8);
+  // A burst: three commands stamped 10 ms apart arriving at once
+  for (int i = 0; i < 3; ++i)
+  {
+    StampedValue command;
+    command.value = i;
+    command.stamp = ros::Time(1.0 + 0.01*i);
+    EXPECT_TRUE(queue.push(command));
+  }
+
+  const ros::Duration delay(0.1);
+  StampedValue command;
+  EXPECT_FALSE(queue.popDue(ros::Time(1.095), delay, command));
+
+  // Each command is applied at its stamp plus the delay, not all at once
+  EXPECT_TRUE(queue.popDue(ros::Time(1.1), delay, command));
+  EXPECT_EQ(command.value, 0);
+  EXPECT_FALSE(queue.popDue(ros::Time(1.105), delay, command));
+  EXPECT_TRUE(queue.popDue(ros::Time(1.115), delay, command));
+  EXPECT_EQ(command.value, 1);
+
+  // Late commands are all due, in order
+  EXPECT_TRUE(queue.popDue(ros::Time(2.0), delay, command));
+  EXPECT_EQ(command.value, 2);
+  EXPECT_FALSE(queue.popDue(ros::Time(2.0), delay, command));
+}
+
+TEST(CommandQueueTest, testClear)
+{
+  CommandQueue<StampedValue> queue(2);
+  StampedValue command;
+  command.value = 1;
+  command.stamp = ros::Time(1.0);
+  EXPECT_TRUE(queue.push(command));
+  EXPECT_TRUE(queue.push(command));
+  EXPECT_FALSE(queue.push(command));
+
+  queue.clear();
+  EXPECT_FALSE(queue.popDue(ros::Time(2.0), ros::Duration(0.0), command));
+  EXPECT_TRUE(queue.push(command));
+}
+
+static std::string sharedMemoryName()
+{
+  std::ostringstream name;
+  name << "/controller_realtime_utils_test_" << getpid();
+  return name.str();
+}
+
+static SharedCommand sharedCommand(double speed)
+{
+  SharedCommand command;
+  command.speed = speed;
+  return command;
+}
+
+TEST(SharedCommandChannelTest, testOrderAndOverrun)
+{
+  const std::string name = sharedMemoryName();
+  SharedCommandWriter writer;
+  EXPECT_FALSE(writer.attach(name));
+
+  SharedCommandReader reader;
+  ASSERT_TRUE(reader.open(name, 6));
+  ASSERT_TRUE(writer.attach(name));
+
+  SharedCommand command;
+  EXPECT_FALSE(reader.read(command));
+  for (int i = 0; i < 3; ++i)
+    EXPECT_TRUE(writer.write(sharedCommand(i)));
+  for (int i = 0; i < 3; ++i)
+  {
+    ASSERT_TRUE(reader.read(command));
+    EXPECT_EQ(command.speed, i);
+  }
+  EXPECT_FALSE(reader.read(command));
+
+  // The writer never waits: the 8 slots hold the last 8 commands
+  for (int i = 0; i < 11; ++i)
+    writer.write(sharedCommand(i));
+  for (int i = 3; i < 11; ++i)
+  {
+    ASSERT_TRUE(reader.read(command));
+    EXPECT_EQ(command.speed, i);
+  }
+  EXPECT_FALSE(reader.read(command));
+  EXPECT_EQ(reader.lost(), 3u);
+
+  // A controller restarting attaches to the same channel and skips the old commands
+  writer.write(sharedCommand(42));
+  SharedCommandReader new_reader;
+  ASSERT_TRUE(new_reader.open(name, 1));
+  EXPECT_FALSE(new_reader.read(command));
+  writer.write(sharedCommand(43));
+  ASSERT_TRUE(new_reader.read(command));
+  EXPECT_EQ(command.speed, 43);
+
+  shm_unlink(name.c_str());
+}
+
+TEST(SharedMemoryRingTest, testRecordSizeMismatch)
+{
+  const std::string name = sharedMemoryName();
+  SharedCommandReader reader;
+  ASSERT_TRUE(reader.open(name, 4));
+
+  // A ring of other records can't be attached, and is replaced when opened
+  SharedOdometryReader odometry_reader;
+  EXPECT_FALSE(odometry_reader.attach(name));
+  SharedOdometryWriter odometry_writer;
+  ASSERT_TRUE(odometry_writer.open(name, 4));
+  ASSERT_TRUE(odometry_reader.attach(name));
+
+  SharedOdometrySample sample;
+  sample.input_count = 2;
+  sample.inputs[1] = 3.0;
+  EXPECT_TRUE(odometry_writer.write(sample));
+  SharedOdometrySample read_sample;
+  ASSERT_TRUE(odometry_reader.read(read_sample));
+  EXPECT_EQ(read_sample.input_count, 2u);
+  EXPECT_EQ(read_sample.inputs[1], 3.0);
+
+  shm_unlink(name.c_str());
+}
+
+TEST(SeqLockTest, testReadLatest)
+{
+  SeqLock<double> cell;
+  double value = -1.0;
+  EXPECT_TRUE(cell.tryRead(value));
+  EXPECT_EQ(value, 0.0);
+
+  cell.write(1.5);
+  cell.write(2.5);
+  cell.read(value);
+  EXPECT_EQ(value, 2.5);
+  EXPECT_EQ(cell.sequence(), 4u);
+}
+
+struct Triple
+{
+  long a, b, c;
+};
+
+TEST(SeqLockTest, testConcurrentConsistency)
+{
+  // The reader must never see a value mixing two writes
+  SeqLock<Triple> cell;
+  const long count = 100000;
+  std::thread writer([&cell, count]()
+  {
+    for (long i = 1; i <= count; ++i)
+    {
+      const Triple triple = {i, 2*i, 3*i};
+      cell.write(triple);
+      if (i % 64 == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  long last = 0;
+  while (last < count)
+  {
+    Triple triple;
+    cell.read(triple);
+    ASSERT_EQ(triple.b, 2*triple.a);
+    ASSERT_EQ(triple.c, 3*triple.a);
+    ASSERT_GE(triple.a, last);
+    last = triple.a;
+    std::this_thread::yield();
+  }
+  writer.join();
+}
+
+TEST(WakeupTest, testNotifyBeforeWaitIsNotLost)
+{
+  Wakeup wakeup;
+  const uint32_t token = wakeup.prepare();
+  EXPECT_FALSE(wakeup.wait(token, 0.01));
+  wakeup.notify();
+  EXPECT_TRUE(wakeup.wait(token, 10.0));
+}
+
+TEST(WakeupTest, testNotifyWakesWaiter)
+{
+  // Every value written must be seen by the waiter, which only sleeps when it saw the last one
+  Wakeup wakeup;
+  std::atomic<long> value(0);
+  const long count = 10000;
+  std::thread writer([&wakeup, &value, count]()
+  {
+    for (long i = 1; i <= count; ++i)
+    {
+      value.store(i);
+      wakeup.notify();
+      if (i % 16 == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  long last = 0;
+  while (last < count)
+  {
+    const uint32_t token = wakeup.prepare();
+    const long current = value.load();
+    if (current != last)
+      last = current;
+    else
+      ASSERT_TRUE(wakeup.wait(token, 10.0));
+  }
+  writer.join();
+}
+
+TEST(PoseHistoryTest, testInterpolation)
+{
+  PoseHistory history(4);
+  StampedPose pose;
+  EXPECT_FALSE(history.lookup(0.0, pose));
+
+  EXPECT_TRUE(history.add(1.0, 0.0, 0.0, 0.0));
+  EXPECT_TRUE(history.add(2.0, 1.0, 2.0, 0.5));
+  EXPECT_FALSE(history.add(2.0, 5.0, 5.0, 5.0));
+
+  ASSERT_TRUE(history.lookup(1.25, pose));
+  EXPECT_DOUBLE_EQ(pose.x, 0.25);
+  EXPECT_DOUBLE_EQ(pose.y, 0.5);
+  EXPECT_DOUBLE_EQ(pose.heading, 0.125);
+  ASSERT_TRUE(history.lookup(2.0, pose));
+  EXPECT_DOUBLE_EQ(pose.x, 1.0);
+  EXPECT_FALSE(history.lookup(0.5, pose));
+  EXPECT_FALSE(history.lookup(2.5, pose));
+
+  // The oldest poses are overwritten
+  for (int i = 3; i <= 6; ++i)
+    history.add(i, i - 1.0, 0.0, 0.0);
+  EXPECT_FALSE(history.lookup(2.5, pose));
+  ASSERT_TRUE(history.lookup(3.5, pose));
+  EXPECT_DOUBLE_EQ(pose.x, 2.5);
+  ASSERT_TRUE(history.lookup(5.75, pose));
+  EXPECT_DOUBLE_EQ(pose.x, 4.75);
+
+  history.clear();
+  EXPECT_FALSE(history.lookup(5.0, pose));
+  EXPECT_TRUE(history.add(0.5, 0.0, 0.0, 0.0));
+}
+
+TEST(PoseHistoryTest, testConcurrentLookup)
+{
+  // Every pose lies on x = 2*stamp, y = -stamp, whatever the writer overwrites meanwhile
+  PoseHistory history(64);
+  const long count = 100000;
+  std::atomic<long> written(0);
+  std::thread writer([&history, &written, count]()
+  {
+    for (long i = 1; i <= count; ++i)
+    {
+      history.add(i, 2.0*i, -1.0*i, 0.0);
+      written.store(i);
+      if (i % 64 == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  long found = 0;
+  while (written.load() < count)
+  {
+    const double stamp = written.load() - 10.5;
+    StampedPose pose;
+    if (history.lookup(stamp, pose))
+    {
+      ASSERT_DOUBLE_EQ(pose.x, 2.0*stamp);
+      ASSERT_DOUBLE_EQ(pose.y, -stamp);
+      ++found;
+    }
+    std::this_thread::yield();
+  }
+  writer.join();
+  EXPECT_GT(found, 0);
+}
+
+TEST(RollingWindowTest, testMeanAndVariance)
+{
+  RollingWindow<double> window(4);
+  EXPECT_DOUBLE_EQ(window.mean(), 0.0);
+  EXPECT_DOUBLE_EQ(window.variance(), 0.0);
+
+  window.push(1.0);
+  window.push(3.0);
+  EXPECT_EQ(window.size(), 2u);
+  EXPECT_DOUBLE_EQ(window.mean(), 2.0);
+  EXPECT_DOUBLE_EQ(window.variance(), 1.0);
+
+  // The oldest values leave the window
+  for (int i = 0; i < 6; ++i)
+    window.push(10.0 + i);
+  EXPECT_EQ(window.size(), 4u);
+  EXPECT_DOUBLE_EQ(window.mean(), 13.5);
+  EXPECT_DOUBLE_EQ(window.variance(), 1.25);
+
+  window.clear();
+  EXPECT_EQ(window.size(), 0u);
+  window.push(-2.0);
+  EXPECT_DOUBLE_EQ(window.mean(), -2.0);
+
+  window.resize(2);
+  EXPECT_EQ(window.capacity(), 2u);
+  EXPECT_EQ(window.size(), 0u);
+}
+
+TEST(RollingWindowTest, testNoDrift)
+{
+  RollingWindow<double> window(10);
+  for (int i = 0; i < 100000; ++i)
+    window.push(i % 2 ? 1e6 : 0.1);
+  window.push(0.1);
+  window.push(1e6);
+  EXPECT_NEAR(window.mean(), 500000.05, 1e-6);
+
+  // Also in the middle of a pass, the error is the one of a single pass
+  for (int i = 0; i < 5; ++i)
+    window.push(0.1);
+  EXPECT_NEAR(window.mean(), 300000.07, 1e-6);
+}
+
+TEST(SpeedLimiterTest, testAxesLimitedIndependently)
+{
+  SpeedLimiter<double, 3> limiter;
+  limiter.setVelocityLimits(0, true, -1.0, 2.0);
+  limiter.setAccelerationLimits(1, true, -0.5, 0.5);
+  limiter.setJerkLimits(2, true, -10.0, 10.0);
+
+  const double v0[3] = {0.0, 0.0, 0.0};
+  const double v1[3] = {0.0, 0.0, 0.0};
+  double v[3] = {5.0, 5.0, 5.0};
+  limiter.limit(v, v0, v1, 0.1);
+  EXPECT_DOUBLE_EQ(v[0], 2.0);
+  EXPECT_DOUBLE_EQ(v[1], 0.05);
+  EXPECT_DOUBLE_EQ(v[2], 0.2);
+
+  // Without limits the command goes through, even with a null time step
+  SpeedLimiter<double, 3> unlimited;
+  double w[3] = {5.0, -3.0, 0.25};
+  unlimited.limit(w, v0, v1, 0.0);
+  EXPECT_DOUBLE_EQ(w[0], 5.0);
+  EXPECT_DOUBLE_EQ(w[1], -3.0);
+  EXPECT_DOUBLE_EQ(w[2], 0.25);
+}
+
+TEST(JerkLimitedProfileTest, testTrapezoidalRate)
+{
+  JerkLimitedProfile profile;
+  profile.plan(10.0, 0.0, 0.0, 1.0, 0.5, 1.0);
+
+  // Ramps of 0.5 s on the rate, 1.5 s at the maximum rate in between
+  EXPECT_NEAR(profile.endTime(), 12.5, 1e-9);
+  double value, rate;
+  profile.sample(10.5, value, rate);
+  EXPECT_NEAR(value, 0.125, 1e-9);
+  EXPECT_NEAR(rate, 0.5, 1e-9);
+  profile.sample(11.25, value, rate);
+  EXPECT_NEAR(value, 0.5, 1e-9);
+  profile.sample(12.5, value, rate);
+  EXPECT_DOUBLE_EQ(value, 1.0);
+  EXPECT_DOUBLE_EQ(rate, 0.0);
+  profile.sample(9.0, value, rate);
+  EXPECT_DOUBLE_EQ(value, 0.0);
+}
+
+TEST(JerkLimitedProfileTest, testLimitsAndContinuity)
+{
+  // From a rate going away from the target, the value overshoots then comes back
+  const double max_rate = 2.0, max_jerk = 5.0, dt = 1e-4;
+  JerkLimitedProfile profile;
+  profile.plan(0.0, 1.0, 1.5, -0.5, max_rate, max_jerk);
+
+  double value, rate, previous_value, previous_rate;
+  profile.sample(0.0, previous_value, previous_rate);
+  EXPECT_DOUBLE_EQ(previous_value, 1.0);
+  EXPECT_DOUBLE_EQ(previous_rate, 1.5);
+  for (double time = dt; time < profile.endTime() + 0.1; time += dt)
+  {
+    profile.sample(time, value, rate);
+    EXPECT_LE(std::fabs(rate), max_rate + 1e-9);
+    EXPECT_LE(std::fabs(rate - previous_rate), max_jerk*dt + 1e-9);
+    EXPECT_NEAR(value, previous_value + dt*(rate + previous_rate)/2.0, 1e-6);
+    previous_value = value;
+    previous_rate = rate;
+  }
+  EXPECT_DOUBLE_EQ(value, -0.5);
+  EXPECT_DOUBLE_EQ(rate, 0.0);
+
+  // Without jerk limit the rate is a step
+  profile.plan(0.0, 0.0, 0.0, 1.0, 2.0, std::numeric_limits<double>::infinity());
+  EXPECT_NEAR(profile.endTime(), 0.5, 1e-9);
+  profile.sample(0.25, value, rate);
+  EXPECT_NEAR(value, 0.5, 1e-9);
+}
+
+TEST(PersistentStateTest, testRestore)
+{
+  std::ostringstream path;
+  path << "/dev/shm/controller_realtime_utils_test_state_" << getpid();
+  unlink(path.str().c_str());
+
+  Triple state = {0, 0, 0};
+  {
+    PersistentState<Triple> file;
+    ASSERT_TRUE(file.open(path.str()));
+    EXPECT_FALSE(file.load(state));
+
+    const Triple stored = {1, 2, 3};
+    file.store(stored);
+    ASSERT_TRUE(file.load(state));
+    EXPECT_EQ(state.c, 3);
+  }
+
+  // A new run finds the state of the previous one
+  PersistentState<Triple> file;
+  ASSERT_TRUE(file.open(path.str()));
+  ASSERT_TRUE(file.load(state));
+  EXPECT_EQ(state.a, 1);
+  EXPECT_EQ(state.b, 2);
+  file.close();
+
+  // A state of another type is not loaded
+  PersistentState<double> other;
+  ASSERT_TRUE(other.open(path.str()));
+  double value = 0.0;
+  EXPECT_FALSE(other.load(value));
+  other.close();
+
+  unlink(path.str().c_str());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,106 @@
+// Heap allocation tracker for real-time code paths.
+//
+// Interposes malloc/calloc/realloc/free and operator new/delete for the whole
+// test executable. Only the calls made by a thread while it holds a ScopedTracking
+// are counted, so the ROS threads (spinner, realtime publishers) are free to allocate.
+//
+// Must be included by exactly one translation unit of the test executable.
+
+#ifndef CONTROLLER_REALTIME_UTILS_TESTING_ALLOCATION_TRACKER_H
+#define CONTROLLER_REALTIME_UTILS_TESTING_ALLOCATION_TRACKER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// glibc entry points of the real allocator
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* ptr, std::size_t size);
+extern "C" void __libc_free(void* ptr);
+
+namespace allocation_tracker
+{
+  namespace internal
+  {
+    static __thread bool enabled = false;
+    static __thread std::size_t allocations = 0;
+    static __thread std::size_t deallocations = 0;
+  }
+
+  /// Counts the allocations of the current thread during its lifetime
+  class ScopedTracking
+  {
+  public:
+    ScopedTracking()
+    {
+      internal::allocations = 0;
+      internal::deallocations = 0;
+      internal::enabled = true;
+    }
+
+    ~ScopedTracking()
+    {
+      internal::enabled = false;
+    }
+  };
+
+  /// Number of allocations made under the last (or current) ScopedTracking
+  inline std::size_t allocations() { return internal::allocations; }
+
+  /// Number of deallocations made under the last (or current) ScopedTracking
+  inline std::size_t deallocations() { return internal::deallocations; }
+}
+
+extern "C" void* malloc(std::size_t size)
+{
+  if (allocation_tracker::internal::enabled)
+    ++allocation_tracker::internal::allocations;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size)
+{
+  if (allocation_tracker::internal::enabled)
+    ++allocation_tracker::internal::allocations;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size)
+{
+  if (allocation_tracker::internal::enabled)
+    ++allocation_tracker::internal::allocations;
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr)
+{
+  if (ptr != NULL && allocation_tracker::internal::enabled)
+    ++allocation_tracker::internal::deallocations;
+  __libc_free(ptr);
+}
+
+void* operator new(std::size_t size)
+{
+  void* ptr = malloc(size);
+  if (ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  free(ptr);
+}
+
+#endif // CONTROLLER_REALTIME_UTILS_TESTING_ALLOCATION_TRACKER_H
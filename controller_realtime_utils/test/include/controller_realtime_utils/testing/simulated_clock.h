@@ -0,0 +1,148 @@
+// Runs a controller manager on a fake robot in simulated time, as fast as the CPU allows.
+//
+// The clock of the whole test process is moved with ros::Time::setNow(), so the
+// controllers and the test see the same time. Each step delivers the messages
+// published so far, then calls read(), update() and write() once. A message
+// published between two calls of run() is thus handled at the exact simulated
+// time now(), whatever the load of the machine.
+//
+// The test must not spin the global callback queue itself and must not sleep
+// with ros::Duration, that would wait for a clock only run() moves. What the
+// controllers publish from their own threads, like the odometry, is received
+// with runUntil() or waitForMessages().
+
+#ifndef CONTROLLER_REALTIME_UTILS_TESTING_SIMULATED_CLOCK_H
+#define CONTROLLER_REALTIME_UTILS_TESTING_SIMULATED_CLOCK_H
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <ros/callback_queue.h>
+#include <ros/ros.h>
+
+#include <controller_manager/controller_manager.h>
+#include <controller_manager_msgs/SwitchController.h>
+
+template<class Robot>
+class SimulatedClock
+{
+public:
+  explicit SimulatedClock(const ros::Time& start_time = ros::Time(1.0))
+  : time_(start_time)
+  , controller_manager_(&robot_, nh_)
+  {
+    ros::Time::setNow(time_);
+  }
+
+  Robot& robot() { return robot_; }
+  const Robot& robot() const { return robot_; }
+
+  controller_manager::ControllerManager& controllerManager() { return controller_manager_; }
+
+  const ros::Time& now() const { return time_; }
+
+  /// Loads and starts a controller, false if it fails to load or to start
+  bool startController(const std::string& name)
+  {
+    if (!controller_manager_.loadController(name))
+      return false;
+
+    runWhile([this, &name]()
+    {
+      return controller_manager_.switchController(std::vector<std::string>(1, name),
+                                                  std::vector<std::string>(),
+                                                  controller_manager_msgs::SwitchController::Request::STRICT);
+    });
+
+    controller_interface::ControllerBase* controller = controller_manager_.getControllerByName(name);
+    return controller != NULL && controller->isRunning();
+  }
+
+  /// Stops and unloads a controller, false if it fails
+  bool unloadController(const std::string& name)
+  {
+    const bool stopped = runWhile([this, &name]()
+    {
+      return controller_manager_.switchController(std::vector<std::string>(),
+                                                  std::vector<std::string>(1, name),
+                                                  controller_manager_msgs::SwitchController::Request::STRICT);
+    });
+    return stopped && runWhile([this, &name]() { return controller_manager_.unloadController(name); });
+  }
+
+  /// Runs one control period
+  void step()
+  {
+    ros::getGlobalCallbackQueue()->callAvailable();
+    robot_.read();
+    controller_manager_.update(time_, robot_.getPeriod());
+    robot_.write();
+
+    time_ += robot_.getPeriod();
+    ros::Time::setNow(time_);
+  }
+
+  /// Runs the control loop for a simulated duration
+  void run(const ros::Duration& duration)
+  {
+    const ros::Time end = time_ + duration;
+    while (time_ < end)
+      step();
+  }
+
+  /**
+   * \brief Runs the control loop until a condition holds
+   * Between two periods, the other threads are given a millisecond to deliver their messages.
+   * \return false if the condition does not hold within the simulated timeout
+   */
+  bool runUntil(const boost::function<bool()>& condition, const ros::Duration& timeout)
+  {
+    const ros::Time end = time_ + timeout;
+    while (!waitForMessages(condition, ros::WallDuration(0.001)))
+    {
+      if (time_ >= end)
+        return false;
+      step();
+    }
+    return true;
+  }
+
+  /**
+   * \brief Delivers the messages published by the other threads, without moving the clock,
+   *        until a condition holds
+   * \return false if the condition does not hold within the wall time timeout
+   */
+  bool waitForMessages(const boost::function<bool()>& condition,
+                       const ros::WallDuration& timeout = ros::WallDuration(5.0))
+  {
+    const ros::WallTime end = ros::WallTime::now() + timeout;
+    while (!condition())
+    {
+      if (ros::WallTime::now() >= end)
+        return false;
+      ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(0.001));
+    }
+    return true;
+  }
+
+private:
+  /// Calls the controller manager from another thread, it waits for update() to make the changes
+  bool runWhile(const boost::function<bool()>& call)
+  {
+    bool result = false;
+    boost::thread caller([&call, &result]() { result = call(); });
+    while (!caller.timed_join(boost::posix_time::milliseconds(1)))
+      step();
+    return result;
+  }
+
+  ros::NodeHandle nh_;
+  Robot robot_;
+  ros::Time time_;
+  controller_manager::ControllerManager controller_manager_;
+};
+
+#endif // CONTROLLER_REALTIME_UTILS_TESTING_SIMULATED_CLOCK_H
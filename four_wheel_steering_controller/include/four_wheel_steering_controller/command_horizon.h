@@ -0,0 +1,101 @@
+#ifndef FOUR_WHEEL_STEERING_CONTROLLER_COMMAND_HORIZON_H
+#define FOUR_WHEEL_STEERING_CONTROLLER_COMMAND_HORIZON_H
+
+#include <cstddef>
+
+namespace four_wheel_steering_controller
+{
+
+  /**
+   * \brief Short horizon of timed four wheel steering commands, interpolated in the real-time loop
+   * The points live in fixed size arrays, so a whole horizon can be copied to the
+   * real-time thread without allocating (it is trivially copyable).
+   */
+  class CommandHorizon
+  {
+  public:
+    static const std::size_t MAX_POINTS = 32;
+
+    CommandHorizon()
+    : size_(0)
+    {
+    }
+
+    void clear()
+    {
+      size_ = 0;
+    }
+
+    /**
+     * \brief Appends a point
+     * \param stamp          Time the command is meant to be applied at [s]
+     * \param lin            Linear speed [m/s]
+     * \param front_steering Front virtual steering angle [rad]
+     * \param rear_steering  Rear virtual steering angle [rad]
+     * \return false if the horizon is full or the stamp is not after the previous one
+     */
+    bool push(double stamp, double lin, double front_steering, double rear_steering)
+    {
+      if (size_ == MAX_POINTS || (size_ > 0 && stamp <= stamps_[size_-1]))
+        return false;
+
+      stamps_[size_] = stamp;
+      lin_[size_] = lin;
+      front_steering_[size_] = front_steering;
+      rear_steering_[size_] = rear_steering;
+      ++size_;
+      return true;
+    }
+
+    std::size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /// Stamp of the last point [s], the horizon must not be empty
+    double endTime() const { return stamps_[size_-1]; }
+
+    /**
+     * \brief Interpolates linearly the command at a time (real-time safe)
+     * After the last point, the last command is held.
+     * \param [in]  time           Current time [s]
+     * \param [out] lin            Linear speed [m/s]
+     * \param [out] front_steering Front virtual steering angle [rad]
+     * \param [out] rear_steering  Rear virtual steering angle [rad]
+     * \return false if the horizon is empty or starts after time
+     */
+    bool sample(double time, double& lin, double& front_steering, double& rear_steering) const
+    {
+      if (size_ == 0 || time < stamps_[0])
+        return false;
+
+      std::size_t next = 1;
+      while (next < size_ && stamps_[next] < time)
+        ++next;
+
+      if (next == size_)
+      {
+        lin = lin_[size_-1];
+        front_steering = front_steering_[size_-1];
+        rear_steering = rear_steering_[size_-1];
+        return true;
+      }
+
+      const std::size_t previous = next - 1;
+      const double ratio = (time - stamps_[previous])/(stamps_[next] - stamps_[previous]);
+      lin = lin_[previous] + ratio*(lin_[next] - lin_[previous]);
+      front_steering = front_steering_[previous] + ratio*(front_steering_[next] - front_steering_[previous]);
+      rear_steering = rear_steering_[previous] + ratio*(rear_steering_[next] - rear_steering_[previous]);
+      return true;
+    }
+
+  private:
+    std::size_t size_;
+    double stamps_[MAX_POINTS];
+    double lin_[MAX_POINTS];
+    double front_steering_[MAX_POINTS];
+    double rear_steering_[MAX_POINTS];
+  };
+
+} // namespace four_wheel_steering_controller
+
+#endif // FOUR_WHEEL_STEERING_CONTROLLER_COMMAND_HORIZON_H
@@ -3,15 +3,16 @@
 #define ODOMETRY_H_
 
 #include <ros/time.h>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
-#include <boost/accumulators/statistics/rolling_mean.hpp>
 #include <boost/function.hpp>
 
+#include <controller_realtime_utils/pose_history.h>
+#include <controller_realtime_utils/rolling_window.h>
+
+#include <vehicle_kinematics/four_wheel_steering_kinematics.h>
+#include <vehicle_kinematics/pose_integration.h>
+
 namespace four_wheel_steering_controller
 {
-  namespace bacc = boost::accumulators;
-
   /**
    * \brief The Odometry class handles odometry readings
    * (2D pose and velocity with related timestamp)
@@ -23,6 +24,17 @@ namespace four_wheel_steering_controller
     /// Integration function, used to integrate the odometry:
     typedef boost::function<void(double, double)> IntegrationFunction;
 
+    /// State kept across restarts of the controller:
+    struct State
+    {
+      double x;            //   [m]
+      double y;            //   [m]
+      double heading;      // [rad]
+      double wheel_pos[4]; // last wheel positions [rad], indexed by vehicle_kinematics::WheelIndex
+      double steering[4];  // last wheel steering positions [rad], indexed by vehicle_kinematics::WheelIndex
+      bool has_wheel_pos;  // whether the wheel positions were read, by updateFromPositions()
+    };
+
     /**
      * \brief Constructor
      * Timestamp will get the current time value
@@ -51,6 +63,20 @@ namespace four_wheel_steering_controller
     bool update(const double& fl_speed, const double& fr_speed, const double& rl_speed, const double& rr_speed,
                 double front_steering, double rear_steering, const ros::Time &time);
 
+    /**
+     * \brief Updates the odometry class with latest wheel positions, insensitive to the update period jitter
+     * The pose moves by the displacement the wheel position increments give,
+     * the wheel speeds only give the reported velocity.
+     * \param wheel_pos   wheel positions [rad], indexed by vehicle_kinematics::WheelIndex
+     * \param wheel_speed wheel speeds [rad/s], indexed by vehicle_kinematics::WheelIndex
+     * \param steering    wheel steering positions [rad], indexed by vehicle_kinematics::WheelIndex
+     * \param time        Current time
+     * \return true if the odometry is actually updated, false on the first call after init()
+     *         or with all the wheels sideways
+     */
+    bool updateFromPositions(const double (&wheel_pos)[4], const double (&wheel_speed)[4],
+                             const double (&steering)[4], const ros::Time &time);
+
     /**
      * \brief Updates the odometry class with latest velocity command
      * \param linear  Linear velocity [m/s]
@@ -89,7 +115,7 @@ namespace four_wheel_steering_controller
 
     /**
      * \brief linear velocity getter norm
-     * \return linear velocity [m/s]
+     * \return linear velocity [m/s], mean over the velocity rolling window in closed loop
      */
     double getLinear() const
     {
@@ -98,7 +124,7 @@ namespace four_wheel_steering_controller
 
     /**
      * \brief linear velocity getter along X on the robot base link frame
-     * \return linear velocity [m/s]
+     * \return linear velocity [m/s], mean over the velocity rolling window in closed loop
      */
     double getLinearX() const
     {
@@ -107,7 +133,7 @@ namespace four_wheel_steering_controller
 
     /**
      * \brief linear velocity getter along Y on the robot base link frame
-     * \return linear velocity [m/s]
+     * \return linear velocity [m/s], mean over the velocity rolling window in closed loop
      */
     double getLinearY() const
     {
@@ -116,7 +142,7 @@ namespace four_wheel_steering_controller
 
     /**
      * \brief angular velocity getter
-     * \return angular velocity [rad/s]
+     * \return angular velocity [rad/s], mean over the velocity rolling window in closed loop
      */
     double getAngular() const
     {
@@ -131,25 +157,51 @@ namespace four_wheel_steering_controller
      */
     void setWheelParams(double track, double wheel_radius, double wheel_base);
 
+    /**
+     * \brief State getter, to be saved
+     * \return pose and last wheel positions
+     */
+    State getState() const;
+
+    /**
+     * \brief Restores a saved state, after init()
+     * The next updateFromPositions() integrates the wheel displacements from the saved positions,
+     * unless a wheel travelled further, as when the encoders were reset: it then only takes
+     * the new positions as the baseline.
+     * \param state            Pose and last wheel positions
+     * \param max_wheel_travel Largest travel of a wheel since the saved positions [m]
+     */
+    void setState(const State& state, double max_wheel_travel);
+
+    /**
+     * \brief Pose at a past time, interpolated from the pose history (thread safe)
+     * \param [in]  time    Time of the pose
+     * \param [out] x       x position [m]
+     * \param [out] y       y position [m]
+     * \param [out] heading heading [rad]
+     * \return false if time is not covered by the history
+     */
+    bool getPoseAt(const ros::Time &time, double &x, double &y, double &heading) const;
+
+    /**
+     * \brief Pose history size setter, allocates the history (non real-time)
+     * \param history_size Number of poses kept, one per update
+     */
+    void setHistorySize(size_t history_size);
+
     /**
      * \brief Velocity rolling window size setter
      * \param velocity_rolling_window_size Velocity rolling window size
      */
     void setVelocityRollingWindowSize(size_t velocity_rolling_window_size);
 
-  private:
-
-    /// Rolling mean accumulator and window:
-    typedef bacc::accumulator_set<double, bacc::stats<bacc::tag::rolling_mean> > RollingMeanAcc;
-    typedef bacc::tag::rolling_window RollingWindow;
-
     /**
-     * \brief Integrates the velocities (linear on x and y and angular)
-     * \param linear_x  Linear  velocity along x of the robot frame  [m] (linear  displacement, i.e. m/s * dt) computed by encoders
-     * \param linear_y  Linear  velocity along y of the robot frame   [m] (linear  displacement, i.e. m/s * dt) computed by encoders
-     * \param angular Angular velocity [rad] (angular displacement, i.e. m/s * dt) computed by encoders
+     * \brief Integration method setter, used by update() (euler by default)
+     * \param method Integration method
      */
-    void integrateXY(double linear_x, double linear_y, double angular);
+    void setIntegrationMethod(vehicle_kinematics::IntegrationMethod method);
+
+  private:
 
     /**
      * \brief Integrates the velocities (linear and angular) using 2nd order Runge-Kutta
@@ -165,6 +217,13 @@ namespace four_wheel_steering_controller
      */
     void integrateExact(double linear, double angular);
 
+    /**
+     * \brief Pushes a velocity into the rolling windows and updates the reported velocity
+     * \param velocity  Velocity of the base link
+     * \param direction Sign of the linear velocity norm
+     */
+    void filterVelocity(const vehicle_kinematics::BodyVelocity<double>& velocity, double direction);
+
     /**
      *  \brief Reset linear and angular accumulators
      */
@@ -187,13 +246,30 @@ namespace four_wheel_steering_controller
     double wheel_radius_;
     double wheel_base_;
 
-    /// Previous wheel position/state [rad]:
-    double wheel_old_pos_;
+    /// Forward kinematics of the vehicle:
+    vehicle_kinematics::FourWheelSteeringKinematics<double> kinematics_;
+
+    /// Previous wheel positions and steerings [rad], for updateFromPositions():
+    double wheels_old_pos_[4];
+    double steerings_old_[4];
+    bool has_wheels_old_pos_;
+    /// Largest wheel travel [m] from the positions restored by setState(), negative once checked:
+    double restored_wheel_travel_limit_;
+
+    /// Integration of the velocities in update(), with the velocity of the previous update:
+    vehicle_kinematics::IntegrationMethod integration_method_;
+    vehicle_kinematics::BodyVelocity<double> velocity_old_;
+    bool has_velocity_old_;
 
     /// Rolling mean accumulators for the linar and angular velocities:
     size_t velocity_rolling_window_size_;
-    RollingMeanAcc linear_acc_;
-    RollingMeanAcc angular_acc_;
+    controller_realtime_utils::RollingWindow<double> linear_acc_;
+    controller_realtime_utils::RollingWindow<double> linear_x_acc_;
+    controller_realtime_utils::RollingWindow<double> linear_y_acc_;
+    controller_realtime_utils::RollingWindow<double> angular_acc_;
+
+    /// Poses of the last updates, for the lookups by time:
+    controller_realtime_utils::PoseHistory history_;
   };
 }
 
@@ -1,28 +1,50 @@
+#include <algorithm>
 #include <cmath>
 
-#include <tf/transform_datatypes.h>
-
-#include <boost/assign.hpp>
+#include <boost/bind.hpp>
 
 #include <four_wheel_steering_controller/four_wheel_steering_controller.h>
 #include <urdf_vehicle_kinematic/urdf_vehicle_kinematic.h>
 
 namespace four_wheel_steering_controller{
 
+  /// Commands received in a burst are kept until their time comes, up to:
+  static const std::size_t COMMAND_QUEUE_SIZE = 64;
+
+  /// Odometry samples kept for the local consumers, a second at 1 kHz:
+  static const std::size_t SHARED_ODOMETRY_SIZE = 1024;
+  static const std::size_t ODOM_SAMPLES_QUEUE_SIZE = 1024;
+
   FourWheelSteeringController::FourWheelSteeringController()
     : open_loop_(false)
-    , command_struct_()
-    , command_struct_four_wheel_steering_()
+    , odom_from_wheel_positions_(false)
+    , smooth_commands_(false)
+    , command_(COMMAND_QUEUE_SIZE)
+    , current_cmd_()
+    , shared_commands_lost_(0)
+    , command_horizon_sequence_(0)
+    , odom_state_max_wheel_travel_(1.0)
     , track_(0.0)
     , wheel_radius_(0.0)
     , wheel_base_(0.0)
     , cmd_vel_timeout_(0.5)
+    , cmd_delay_(0.0)
     , base_frame_id_("base_link")
     , enable_odom_tf_(true)
     , enable_twist_cmd_(false)
+    , enable_stamped_cmd_(false)
+    , ready_(false)
+    , configuration_failed_(false)
+    , start_pending_(false)
   {
   }
 
+  FourWheelSteeringController::~FourWheelSteeringController()
+  {
+    if (configuration_thread_.joinable())
+      configuration_thread_.join();
+  }
+
   bool FourWheelSteeringController::initRequest(hardware_interface::RobotHW *const robot_hw,
                          ros::NodeHandle& root_nh,
                          ros::NodeHandle& ctrlr_nh,
@@ -81,6 +103,7 @@ namespace four_wheel_steering_controller{
     const std::string complete_ns = controller_nh.getNamespace();
     std::size_t id = complete_ns.find_last_of("/");
     name_ = complete_ns.substr(id + 1);
+    rt_logger_.start(name_);
 
     // Get joint names from the parameter server
     std::vector<std::string> front_wheel_names, rear_wheel_names;
@@ -136,6 +159,66 @@ namespace four_wheel_steering_controller{
       rear_steering_joints_.resize(front_steering_names.size());
     }
 
+    // Get the joint object to use in the realtime loop
+    for (int i = 0; i < front_wheel_joints_.size(); ++i)
+    {
+      ROS_INFO_STREAM_NAMED(name_,
+                            "Adding left wheel with joint name: " << front_wheel_names[i]
+                            << " and right wheel with joint name: " << rear_wheel_names[i]);
+      front_wheel_joints_[i] = hw_vel->getHandle(front_wheel_names[i]);  // throws on failure
+      rear_wheel_joints_[i] = hw_vel->getHandle(rear_wheel_names[i]);  // throws on failure
+    }
+
+    // Get the steering joint object to use in the realtime loop
+    for (int i = 0; i < front_steering_joints_.size(); ++i)
+    {
+      ROS_INFO_STREAM_NAMED(name_,
+                            "Adding left steering with joint name: " << front_steering_names[i]
+                            << " and right steering with joint name: " << rear_steering_names[i]);
+      front_steering_joints_[i] = hw_pos->getHandle(front_steering_names[i]);  // throws on failure
+      rear_steering_joints_[i] = hw_pos->getHandle(rear_steering_names[i]);  // throws on failure
+    }
+
+    // Whoever waits for the controller is told when it is configured
+    ready_pub_ = controller_nh.advertise<std_msgs::Bool>("ready", 1, true);
+    std_msgs::Bool ready;
+    ready.data = false;
+    ready_pub_.publish(ready);
+
+    bool async_init = false;
+    controller_nh.param("async_init", async_init, async_init);
+    if (!async_init)
+      return configure(root_nh, controller_nh);
+
+    ROS_INFO_STREAM_NAMED(name_, "Configuring in the background, braking until ready.");
+    configuration_thread_ = boost::thread(&FourWheelSteeringController::configureInBackground, this,
+                                          root_nh, controller_nh);
+    return true;
+  }
+
+  void FourWheelSteeringController::configureInBackground(ros::NodeHandle root_nh, ros::NodeHandle controller_nh)
+  {
+    if (configure(root_nh, controller_nh))
+      return;
+    configuration_failed_.store(true, std::memory_order_release);
+    ROS_ERROR_STREAM_NAMED(name_, "Failed to configure the controller in the background, it only brakes "
+                          "and is never ready, fix the configuration and load it again.");
+  }
+
+  bool FourWheelSteeringController::configure(ros::NodeHandle root_nh, ros::NodeHandle controller_nh)
+  {
+    std::vector<std::string> front_wheel_names, rear_wheel_names, front_steering_names, rear_steering_names;
+    for (size_t i = 0; i < front_wheel_joints_.size(); ++i)
+    {
+      front_wheel_names.push_back(front_wheel_joints_[i].getName());
+      rear_wheel_names.push_back(rear_wheel_joints_[i].getName());
+    }
+    for (size_t i = 0; i < front_steering_joints_.size(); ++i)
+    {
+      front_steering_names.push_back(front_steering_joints_[i].getName());
+      rear_steering_names.push_back(rear_steering_joints_[i].getName());
+    }
+
     // Odometry related:
     double publish_rate;
     controller_nh.param("publish_rate", publish_rate, 50.0);
@@ -143,7 +226,22 @@ namespace four_wheel_steering_controller{
                           << publish_rate << "Hz.");
     publish_period_ = ros::Duration(1.0 / publish_rate);
 
+    double diagnostics_period = 1.0;
+    controller_nh.param("diagnostics_period", diagnostics_period, diagnostics_period);
+    ROS_INFO_STREAM_NAMED(name_, "Cycle diagnostics will be published every "
+                          << diagnostics_period << "s.");
+    cycle_diagnostics_.addCounter("Odometry snapshots skipped",
+                                  boost::bind(&controller_realtime_utils::OdometryPublisher::skippedSnapshots,
+                                              &odom_publisher_));
+    cycle_diagnostics_.addCounter("Odometry samples dropped",
+                                  boost::bind(&controller_realtime_utils::OdometryPublisher::droppedSamples,
+                                              &odom_publisher_));
+    cycle_diagnostics_.init(root_nh, name_, diagnostics_period);
+
     controller_nh.param("open_loop", open_loop_, open_loop_);
+    controller_nh.param("odom_from_wheel_positions", odom_from_wheel_positions_, odom_from_wheel_positions_);
+    if (odom_from_wheel_positions_)
+      ROS_INFO_STREAM_NAMED(name_, "Odometry integrated from the wheel positions.");
 
     int velocity_rolling_window_size = 10;
     controller_nh.param("velocity_rolling_window_size", velocity_rolling_window_size, velocity_rolling_window_size);
@@ -152,6 +250,24 @@ namespace four_wheel_steering_controller{
 
     odometry_.setVelocityRollingWindowSize(velocity_rolling_window_size);
 
+    std::string odom_integration = "euler";
+    controller_nh.param("odom_integration", odom_integration, odom_integration);
+    vehicle_kinematics::IntegrationMethod integration_method;
+    if (!vehicle_kinematics::integrationMethodFromString(odom_integration, integration_method))
+    {
+      ROS_ERROR_STREAM_NAMED(name_,
+          "Unknown odometry integration '" << odom_integration << "', "
+          "use euler, runge_kutta_2, exact or runge_kutta_4.");
+      return false;
+    }
+    ROS_INFO_STREAM_NAMED(name_, "Odometry integrated with the " << odom_integration << " method.");
+    odometry_.setIntegrationMethod(integration_method);
+
+    int odom_history_size = 1000;
+    controller_nh.param("odom_history_size", odom_history_size, odom_history_size);
+    ROS_INFO_STREAM_NAMED(name_, "Keeping the last " << odom_history_size << " odometry poses.");
+    odometry_.setHistorySize(std::max(odom_history_size, 0));
+
     // Twist command related:
     controller_nh.param("cmd_vel_timeout", cmd_vel_timeout_, cmd_vel_timeout_);
     ROS_INFO_STREAM_NAMED(name_, "Velocity commands will be considered old if they are older than "
@@ -166,27 +282,44 @@ namespace four_wheel_steering_controller{
     controller_nh.param("enable_twist_cmd", enable_twist_cmd_, enable_twist_cmd_);
     ROS_INFO_STREAM_NAMED(name_, "Twist cmd is " << (enable_twist_cmd_?"enabled":"disabled")<<" (default is four_wheel_steering)");
 
-    // Velocity and acceleration limits:
-    controller_nh.param("linear/x/has_velocity_limits"    , limiter_lin_.has_velocity_limits    , limiter_lin_.has_velocity_limits    );
-    controller_nh.param("linear/x/has_acceleration_limits", limiter_lin_.has_acceleration_limits, limiter_lin_.has_acceleration_limits);
-    controller_nh.param("linear/x/max_velocity"           , limiter_lin_.max_velocity           ,  limiter_lin_.max_velocity          );
-    controller_nh.param("linear/x/min_velocity"           , limiter_lin_.min_velocity           , -limiter_lin_.max_velocity          );
-    controller_nh.param("linear/x/max_acceleration"       , limiter_lin_.max_acceleration       ,  limiter_lin_.max_acceleration      );
-    controller_nh.param("linear/x/min_acceleration"       , limiter_lin_.min_acceleration       , -limiter_lin_.max_acceleration      );
-
-    controller_nh.param("angular/z/has_velocity_limits"    , limiter_ang_.has_velocity_limits    , limiter_ang_.has_velocity_limits    );
-    controller_nh.param("angular/z/has_acceleration_limits", limiter_ang_.has_acceleration_limits, limiter_ang_.has_acceleration_limits);
-    controller_nh.param("angular/z/max_velocity"           , limiter_ang_.max_velocity           ,  limiter_ang_.max_velocity          );
-    controller_nh.param("angular/z/min_velocity"           , limiter_ang_.min_velocity           , -limiter_ang_.max_velocity          );
-    controller_nh.param("angular/z/max_acceleration"       , limiter_ang_.max_acceleration       ,  limiter_ang_.max_acceleration      );
-    controller_nh.param("angular/z/min_acceleration"       , limiter_ang_.min_acceleration       , -limiter_ang_.max_acceleration      );
+    controller_nh.param("enable_stamped_cmd", enable_stamped_cmd_, enable_stamped_cmd_);
+    ROS_INFO_STREAM_NAMED(name_, "Stamped cmd is " << (enable_stamped_cmd_?"enabled":"disabled"));
+
+    double cmd_delay = cmd_delay_.toSec();
+    controller_nh.param("cmd_delay", cmd_delay, cmd_delay);
+    cmd_delay_ = ros::Duration(cmd_delay);
+    ROS_INFO_STREAM_NAMED(name_, "Commands will be applied " << cmd_delay << "s after their stamp.");
+
+    // Velocity, acceleration and jerk limits:
+    controller_realtime_utils::readSpeedLimits(controller_nh, "linear/x", LINEAR, limiter_);
+    controller_realtime_utils::readSpeedLimits(controller_nh, "angular/z", ANGULAR, limiter_);
+    controller_realtime_utils::readSpeedLimits(controller_nh, "front_steering", FRONT_STEERING, limiter_);
+    controller_realtime_utils::readSpeedLimits(controller_nh, "rear_steering", REAR_STEERING, limiter_);
+
+    controller_nh.param("smooth_commands", smooth_commands_, smooth_commands_);
+    if (smooth_commands_)
+      ROS_INFO_STREAM_NAMED(name_, "Commands will be reached through jerk limited transitions.");
 
     // If either parameter is not available, we need to look up the value in the URDF
     bool lookup_track = !controller_nh.getParam("track", track_);
     bool lookup_wheel_radius = !controller_nh.getParam("wheel_radius", wheel_radius_);
     bool lookup_wheel_base = !controller_nh.getParam("wheel_base", wheel_base_);
 
-    urdf_vehicle_kinematic::UrdfVehicleKinematic uvk(root_nh, base_frame_id_);
+    // Geometry derived from the URDF, kept across runs when a cache file is given
+    std::string geometry_cache_file;
+    controller_nh.param("geometry_cache_file", geometry_cache_file, geometry_cache_file);
+    // Only the wheel and steering joints are extracted from the URDF when selective
+    bool selective_urdf_parsing = false;
+    controller_nh.param("selective_urdf_parsing", selective_urdf_parsing, selective_urdf_parsing);
+    std::vector<std::string> geometry_joints;
+    if (selective_urdf_parsing)
+    {
+      geometry_joints.insert(geometry_joints.end(), front_wheel_names.begin(), front_wheel_names.end());
+      geometry_joints.insert(geometry_joints.end(), rear_wheel_names.begin(), rear_wheel_names.end());
+      geometry_joints.insert(geometry_joints.end(), front_steering_names.begin(), front_steering_names.end());
+      geometry_joints.insert(geometry_joints.end(), rear_steering_names.begin(), rear_steering_names.end());
+    }
+    urdf_vehicle_kinematic::UrdfVehicleKinematic uvk(root_nh, base_frame_id_, geometry_cache_file, geometry_joints);
     if(lookup_track)
       if(!uvk.getDistanceBetweenJoints(front_steering_names[0], front_steering_names[1], track_))
         return false;
@@ -209,44 +342,90 @@ namespace four_wheel_steering_controller{
     const double wr = wheel_radius_;
     const double wb = wheel_base_;
     odometry_.setWheelParams(ws, wr, wb);
+    kinematics_.setWheelParams(ws, wr, wb);
     ROS_INFO_STREAM_NAMED(name_,
                           "Odometry params : wheel separation " << ws
                           << ", wheel radius " << wr
                           << ", wheel base " << wb);
 
     setOdomPubFields(root_nh, controller_nh);
+    odom_publisher_.start();
 
-    // Get the joint object to use in the realtime loop
-    for (int i = 0; i < front_wheel_joints_.size(); ++i)
+    std::string shared_odometry_channel;
+    controller_nh.param("shared_odometry_channel", shared_odometry_channel, shared_odometry_channel);
+    if (!shared_odometry_channel.empty())
     {
-      ROS_INFO_STREAM_NAMED(name_,
-                            "Adding left wheel with joint name: " << front_wheel_names[i]
-                            << " and right wheel with joint name: " << rear_wheel_names[i]);
-      front_wheel_joints_[i] = hw_vel->getHandle(front_wheel_names[i]);  // throws on failure
-      rear_wheel_joints_[i] = hw_vel->getHandle(rear_wheel_names[i]);  // throws on failure
+      if (!shared_odometry_writer_.open(shared_odometry_channel, SHARED_ODOMETRY_SIZE))
+        return false;
+      ROS_INFO_STREAM_NAMED(name_, "Writing every odometry sample to shared memory " << shared_odometry_channel);
     }
 
-    // Get the steering joint object to use in the realtime loop
-    for (int i = 0; i < front_steering_joints_.size(); ++i)
+    std::string odom_state_file;
+    controller_nh.param("odom_state_file", odom_state_file, odom_state_file);
+    if (!odom_state_file.empty())
     {
-      ROS_INFO_STREAM_NAMED(name_,
-                            "Adding left steering with joint name: " << front_steering_names[i]
-                            << " and right steering with joint name: " << rear_steering_names[i]);
-      front_steering_joints_[i] = hw_pos->getHandle(front_steering_names[i]);  // throws on failure
-      rear_steering_joints_[i] = hw_pos->getHandle(rear_steering_names[i]);  // throws on failure
+      if (!odom_state_.open(odom_state_file))
+        return false;
+      controller_nh.param("odom_state_max_wheel_travel", odom_state_max_wheel_travel_, odom_state_max_wheel_travel_);
+      ROS_INFO_STREAM_NAMED(name_, "Odometry state kept in " << odom_state_file
+                            << ", the wheel positions are restored up to " << odom_state_max_wheel_travel_ << "m away");
     }
 
-    if(enable_twist_cmd_ == true)
-      sub_command_ = controller_nh.subscribe("cmd_vel", 1, &FourWheelSteeringController::cmdVelCallback, this);
+    std::string shared_command_channel;
+    controller_nh.param("shared_command_channel", shared_command_channel, shared_command_channel);
+    if (!shared_command_channel.empty())
+    {
+      if (!shared_command_reader_.open(shared_command_channel, COMMAND_QUEUE_SIZE))
+        return false;
+      ROS_INFO_STREAM_NAMED(name_, "Reading commands from shared memory " << shared_command_channel);
+      if (smooth_commands_ || cmd_delay_.toSec() != 0.0)
+        ROS_WARN_STREAM_NAMED(name_, "The shared memory commands are applied as they are read, "
+                              "cmd_delay and smooth_commands only apply to the commands of the topics.");
+    }
+
+    // The subscriber queues are as long as the command queue not to drop the bursts
+    const uint32_t queue_size = command_.capacity();
+    if(enable_twist_cmd_ == true && enable_stamped_cmd_ == true)
+      sub_command_ = controller_nh.subscribe("cmd_vel_stamped", queue_size, &FourWheelSteeringController::cmdVelStampedCallback, this);
+    else if(enable_twist_cmd_ == true)
+      sub_command_ = controller_nh.subscribe("cmd_vel", queue_size, &FourWheelSteeringController::cmdVelCallback, this);
+    else if(enable_stamped_cmd_ == true)
+      sub_command_four_wheel_steering_ = controller_nh.subscribe("cmd_four_wheel_steering_stamped", queue_size, &FourWheelSteeringController::cmdFourWheelSteeringStampedCallback, this);
     else
-      sub_command_four_wheel_steering_ = controller_nh.subscribe("cmd_four_wheel_steering", 1, &FourWheelSteeringController::cmdFourWheelSteeringCallback, this);
+      sub_command_four_wheel_steering_ = controller_nh.subscribe("cmd_four_wheel_steering", queue_size, &FourWheelSteeringController::cmdFourWheelSteeringCallback, this);
 
+    if(enable_twist_cmd_ == false)
+      sub_command_horizon_ = controller_nh.subscribe("cmd_four_wheel_steering_horizon", 1, &FourWheelSteeringController::cmdFourWheelSteeringHorizonCallback, this);
+
+    get_pose_at_time_service_ = controller_nh.advertiseService("get_pose_at_time", &FourWheelSteeringController::getPoseAtTimeCallback, this);
+
+    ready_.store(true, std::memory_order_release);
+    std_msgs::Bool ready;
+    ready.data = true;
+    ready_pub_.publish(ready);
+    ROS_INFO_STREAM_NAMED(name_, "Configured, ready.");
     return true;
   }
 
   void FourWheelSteeringController::update(const ros::Time& time, const ros::Duration& period)
   {
+    // Nothing but the joint handles can be used before the configuration is done, or if it failed
+    if (!ready_.load(std::memory_order_acquire))
+    {
+      brake();
+      return;
+    }
+    if (start_pending_)
+    {
+      start_pending_ = false;
+      startRunning(time);
+    }
+    const bool trace = trace_throttle_.ready(time);
+
+    controller_realtime_utils::ScopedCycleTimer cycle_timer(cycle_diagnostics_, period);
+
     // COMPUTE AND PUBLISH ODOMETRY
+    controller_realtime_utils::SharedOdometrySample odometry_sample;
     if (open_loop_)
     {
       odometry_.updateOpenLoop(last0_cmd_.lin, last0_cmd_.ang, time);
@@ -268,67 +447,131 @@ namespace four_wheel_steering_controller{
       if (std::isnan(fl_steering) || std::isnan(fr_steering)
           || std::isnan(rl_steering) || std::isnan(rr_steering))
         return;
-      double front_steering_pos = 0.0;
-      if(fabs(fl_steering) > 0.001 || fabs(fr_steering) > 0.001)
+      const double front_steering_pos = vehicle_kinematics::virtualSteeringAngle(fl_steering, fr_steering);
+      const double rear_steering_pos = vehicle_kinematics::virtualSteeringAngle(rl_steering, rr_steering);
+      if (trace)
+        rt_logger_.debug("front_steering_pos %f rear_steering_pos %f", front_steering_pos, rear_steering_pos);
+
+      // Estimate linear and angular velocity using joint information
+      if (odom_from_wheel_positions_)
       {
-        front_steering_pos = atan(2*tan(fl_steering)*tan(fr_steering)/
-                                        (tan(fl_steering) + tan(fr_steering)));
+        const double wheel_pos[4] = {front_wheel_joints_[0].getPosition(), front_wheel_joints_[1].getPosition(),
+                                     rear_wheel_joints_[0].getPosition(), rear_wheel_joints_[1].getPosition()};
+        const double wheel_speed[4] = {fl_speed, fr_speed, rl_speed, rr_speed};
+        const double steering[4] = {fl_steering, fr_steering, rl_steering, rr_steering};
+        if (std::isnan(wheel_pos[0]) || std::isnan(wheel_pos[1])
+            || std::isnan(wheel_pos[2]) || std::isnan(wheel_pos[3]))
+          return;
+        odometry_.updateFromPositions(wheel_pos, wheel_speed, steering, time);
       }
-      double rear_steering_pos = 0.0;
-      if(fabs(rl_steering) > 0.001 || fabs(rr_steering) > 0.001)
+      else
       {
-        rear_steering_pos = atan(2*tan(rl_steering)*tan(rr_steering)/
-                                       (tan(rl_steering) + tan(rr_steering)));
+        odometry_.update(fl_speed, fr_speed, rl_speed, rr_speed,
+                         front_steering_pos, rear_steering_pos, time);
       }
 
-      ROS_DEBUG_STREAM_THROTTLE(1, "rl_steering "<<rl_steering<<" rr_steering "<<rr_steering<<" rear_steering_pos "<<rear_steering_pos);
-      // Estimate linear and angular velocity using joint information
-      odometry_.update(fl_speed, fr_speed, rl_speed, rr_speed,
-                       front_steering_pos, rear_steering_pos, time);
+      odometry_sample.input_count = 8;
+      odometry_sample.inputs[0] = fl_speed;
+      odometry_sample.inputs[1] = fr_speed;
+      odometry_sample.inputs[2] = rl_speed;
+      odometry_sample.inputs[3] = rr_speed;
+      odometry_sample.inputs[4] = fl_steering;
+      odometry_sample.inputs[5] = fr_steering;
+      odometry_sample.inputs[6] = rl_steering;
+      odometry_sample.inputs[7] = rr_steering;
+    }
+
+    // Every sample goes to the local consumers, odom and tf are decimated to publish_rate
+    if (shared_odometry_writer_.isOpen())
+    {
+      odometry_sample.stamp = time.toSec();
+      odometry_sample.x = odometry_.getX();
+      odometry_sample.y = odometry_.getY();
+      odometry_sample.heading = odometry_.getHeading();
+      odometry_sample.linear_x = odometry_.getLinearX();
+      odometry_sample.linear_y = odometry_.getLinearY();
+      odometry_sample.angular = odometry_.getAngular();
+      shared_odometry_writer_.write(odometry_sample);
     }
 
-    // Publish odometry message
+    odom_state_.store(odometry_.getState());
+
+    odom_publisher_.addSample(time, odometry_.getX(), odometry_.getY(), odometry_.getHeading(),
+                              odometry_.getLinearX(), odometry_.getLinearY(), odometry_.getAngular());
+
+    // Publish odometry message, the message itself is built and sent by the publisher thread
     if (last_state_publish_time_ + publish_period_ < time)
     {
       last_state_publish_time_ += publish_period_;
-      // Compute and store orientation info
-      const geometry_msgs::Quaternion orientation(
-            tf::createQuaternionMsgFromYaw(odometry_.getHeading()));
+      odom_publisher_.update(time, odometry_.getX(), odometry_.getY(), odometry_.getHeading(),
+                             odometry_.getLinearX(), odometry_.getLinearY(),
+                             odometry_.getAngular());
+    }
 
-      // Populate odom message and publish
-      if (odom_pub_->trylock())
-      {
-        odom_pub_->msg_.header.stamp = time;
-        odom_pub_->msg_.pose.pose.position.x = odometry_.getX();
-        odom_pub_->msg_.pose.pose.position.y = odometry_.getY();
-        odom_pub_->msg_.pose.pose.orientation = orientation;
-        odom_pub_->msg_.twist.twist.linear.x  = odometry_.getLinearX();
-        odom_pub_->msg_.twist.twist.linear.y  = odometry_.getLinearY();
-        odom_pub_->msg_.twist.twist.angular.z = odometry_.getAngular();
-        odom_pub_->unlockAndPublish();
-      }
+    // MOVE ROBOT
+    // Apply in order the commands whose time has come:
+    Commands due_cmd;
+    while (command_.popDue(time, cmd_delay_, due_cmd))
+    {
+      current_cmd_ = due_cmd;
+      cycle_diagnostics_.addCommandLatency((time - due_cmd.stamp).toSec());
+    }
 
-      // Publish tf /odom frame
-      if (enable_odom_tf_ && tf_odom_pub_->trylock())
+    // Commands written in shared memory are applied as soon as they are read, without cmd_delay
+    // nor smoothing: their stamp only serves the timeout and the latency
+    controller_realtime_utils::SharedCommand shared_cmd;
+    while (shared_command_reader_.read(shared_cmd))
+    {
+      current_cmd_.lin = shared_cmd.speed;
+      current_cmd_.ang = shared_cmd.angular;
+      current_cmd_.front_steering = shared_cmd.front_steering;
+      current_cmd_.rear_steering = shared_cmd.rear_steering;
+      current_cmd_.stamp = shared_cmd.stamp > 0.0 ? ros::Time(shared_cmd.stamp) : time;
+      current_cmd_.has_profiles = false;
+      cycle_diagnostics_.addCommandLatency((time - current_cmd_.stamp).toSec());
+    }
+    if (shared_command_reader_.lost() != shared_commands_lost_)
+    {
+      shared_commands_lost_ = shared_command_reader_.lost();
+      rt_logger_.warn("%g shared memory commands overwritten before being read", shared_commands_lost_);
+    }
+
+    Commands curr_cmd = current_cmd_;
+
+    // Follow the transitions planned when the command arrived
+    if (curr_cmd.has_profiles)
+    {
+      double rate;
+      curr_cmd.profiles[LINEAR].sample(time.toSec(), curr_cmd.lin, rate);
+      curr_cmd.profiles[ANGULAR].sample(time.toSec(), curr_cmd.ang, rate);
+      curr_cmd.profiles[FRONT_STEERING].sample(time.toSec(), curr_cmd.front_steering, rate);
+      curr_cmd.profiles[REAR_STEERING].sample(time.toSec(), curr_cmd.rear_steering, rate);
+    }
+
+    // Take the latest horizon, if it is being written it will be taken next cycle
+    if (command_horizon_buffer_.sequence() != command_horizon_sequence_)
+    {
+      const uint32_t sequence = command_horizon_buffer_.sequence();
+      CommandHorizon horizon;
+      if (command_horizon_buffer_.tryRead(horizon))
       {
-        geometry_msgs::TransformStamped& odom_frame = tf_odom_pub_->msg_.transforms[0];
-        odom_frame.header.stamp = time;
-        odom_frame.transform.translation.x = odometry_.getX();
-        odom_frame.transform.translation.y = odometry_.getY();
-        odom_frame.transform.rotation = orientation;
-        tf_odom_pub_->unlockAndPublish();
+        command_horizon_ = horizon;
+        command_horizon_sequence_ = sequence;
       }
     }
 
-    // MOVE ROBOT
-    // Retreive current velocity command and time step:
-    Commands curr_cmd;
-    if(enable_twist_cmd_ == false)
-      curr_cmd = *(command_four_wheel_steering_.readFromRT());
-    else
-      curr_cmd = *(command_.readFromRT());
+    // The horizon overrides the older commands while it lasts
+    Commands horizon_cmd;
+    if (command_horizon_.sample(time.toSec(), horizon_cmd.lin,
+                                horizon_cmd.front_steering, horizon_cmd.rear_steering))
+    {
+      const ros::Time horizon_end(command_horizon_.endTime());
+      horizon_cmd.stamp = time < horizon_end ? time : horizon_end;
+      if (horizon_cmd.stamp >= curr_cmd.stamp)
+        curr_cmd = horizon_cmd;
+    }
 
-    const double dt = (time - curr_cmd.stamp).toSec();
+    const double dt = (time - curr_cmd.stamp - cmd_delay_).toSec();
 
     // Brake if cmd_vel has timeout:
     if (dt > cmd_vel_timeout_)
@@ -342,119 +585,54 @@ namespace four_wheel_steering_controller{
     // Limit velocities and accelerations:
     const double cmd_dt(period.toSec());
 
-    limiter_lin_.limit(curr_cmd.lin, last0_cmd_.lin, last1_cmd_.lin, cmd_dt);
-    limiter_ang_.limit(curr_cmd.ang, last0_cmd_.ang, last1_cmd_.ang, cmd_dt);
+    double limited_cmd[LIMITED_AXES] = {curr_cmd.lin, curr_cmd.ang, curr_cmd.front_steering, curr_cmd.rear_steering};
+    const double last0_cmd[LIMITED_AXES] = {last0_cmd_.lin, last0_cmd_.ang, last0_cmd_.front_steering, last0_cmd_.rear_steering};
+    const double last1_cmd[LIMITED_AXES] = {last1_cmd_.lin, last1_cmd_.ang, last1_cmd_.front_steering, last1_cmd_.rear_steering};
+    limiter_.limit(limited_cmd, last0_cmd, last1_cmd, cmd_dt);
+    curr_cmd.lin = limited_cmd[LINEAR];
+    curr_cmd.ang = limited_cmd[ANGULAR];
+    curr_cmd.front_steering = limited_cmd[FRONT_STEERING];
+    curr_cmd.rear_steering = limited_cmd[REAR_STEERING];
 
     last1_cmd_ = last0_cmd_;
     last0_cmd_ = curr_cmd;
 
 
-    const double angular_speed = odometry_.getAngular();
-
-    ROS_DEBUG_STREAM("angular_speed "<<angular_speed<<" curr_cmd.lin "<<curr_cmd.lin<< " wheel_radius_ "<<wheel_radius_);
-    double vel_left_front = 0, vel_right_front = 0;
-    double vel_left_rear = 0, vel_right_rear = 0;
-    double front_left_steering = 0, front_right_steering = 0;
-    double rear_left_steering = 0, rear_right_steering = 0;
+    // Compute wheels velocities and steering angles:
+    vehicle_kinematics::FourWheelSteeringWheelCommands<double> wheels_cmd;
+    // Twist commands only need two atan (rear = -front), for which libm beats the vector kernel
     if(enable_twist_cmd_ == true)
-    {
-      // Compute wheels velocities:
-      if(fabs(curr_cmd.lin) > 0.001)
-      {
-        vel_left_front  = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin - curr_cmd.ang*track_/2,2)
-                                                                           +pow(wheel_base_*curr_cmd.ang/2.0,2)))/wheel_radius_;
-        vel_right_front = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin + curr_cmd.ang*track_/2,2)
-                                                                           +pow(wheel_base_*curr_cmd.ang/2.0,2)))/wheel_radius_;
-        vel_left_rear = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin - curr_cmd.ang*track_/2,2)
-                                                                         +pow(wheel_base_*curr_cmd.ang/2.0,2)))/wheel_radius_;
-        vel_right_rear = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin + curr_cmd.ang*track_/2,2)
-                                                                          +pow(wheel_base_*curr_cmd.ang/2.0,2)))/wheel_radius_;
-      }
-
-      // Compute steering angles
-      if(fabs(2.0*curr_cmd.lin) > fabs(curr_cmd.ang*track_))
-      {
-        front_left_steering = atan(curr_cmd.ang*wheel_base_ /
-                                    (2.0*curr_cmd.lin - curr_cmd.ang*track_));
-        front_right_steering = atan(curr_cmd.ang*wheel_base_ /
-                                     (2.0*curr_cmd.lin + curr_cmd.ang*track_));
-        rear_left_steering = -atan(curr_cmd.ang*wheel_base_ /
-                                    (2.0*curr_cmd.lin - curr_cmd.ang*track_));
-        rear_right_steering = -atan(curr_cmd.ang*wheel_base_ /
-                                     (2.0*curr_cmd.lin + curr_cmd.ang*track_));
-      }
-      else if(fabs(curr_cmd.lin) > 0.001)
-      {
-        front_left_steering = copysign(M_PI_2, curr_cmd.ang);
-        front_right_steering = copysign(M_PI_2, curr_cmd.ang);
-        rear_left_steering = copysign(M_PI_2, -curr_cmd.ang);
-        rear_right_steering = copysign(M_PI_2, -curr_cmd.ang);
-      }
-
-    }
+      kinematics_.twistToWheels(curr_cmd.lin, curr_cmd.ang, wheels_cmd);
     else
-    {
-      // Compute steering angles
-      double steering_diff =  track_*(tan(curr_cmd.front_steering) - tan(curr_cmd.rear_steering))/2.0;
-      if(fabs(wheel_base_ - fabs(steering_diff)) > 0.001)
-      {
-        front_left_steering = wheel_base_*curr_cmd.front_steering/(wheel_base_-steering_diff);
-        front_right_steering = wheel_base_*curr_cmd.front_steering/(wheel_base_+steering_diff);
-        rear_left_steering = wheel_base_*curr_cmd.rear_steering/(wheel_base_-steering_diff);
-        rear_right_steering = wheel_base_*curr_cmd.rear_steering/(wheel_base_+steering_diff);
-      }
-
-      // Compute wheels velocities:
-      if(fabs(curr_cmd.lin) > 0.001)
-      {
-        //Virutal front and rear wheelbase
-        // distance between the projection of the CIR on the wheelbase and the front axle
-        double l_front = 0;
-        if(fabs(tan(front_left_steering) - tan(front_right_steering)) > 0.01)
-        {
-          l_front = tan(front_right_steering) * tan(front_left_steering) * track_
-              / (tan(front_left_steering) - tan(front_right_steering));
-        }
-        // distance between the projection of the CIR on the wheelbase and the rear axle
-        double l_rear = 0;
-        if(fabs(tan(rear_left_steering) - tan(rear_right_steering)) > 0.01)
-        {
-          l_rear = tan(rear_right_steering) * tan(rear_left_steering) * track_
-              / (tan(rear_left_steering) - tan(rear_right_steering));
-        }
-
-        double angular_speed_cmd = curr_cmd.lin * (tan(curr_cmd.front_steering)-tan(curr_cmd.rear_steering))/wheel_base_;
-
-        vel_left_front  = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin - angular_speed_cmd*track_/2,2)
-                                                                           +pow(l_front*angular_speed_cmd,2)))/wheel_radius_;
-        vel_right_front = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin + angular_speed_cmd*track_/2,2)
-                                                                           +pow(wheel_base_*angular_speed_cmd/2.0,2)))/wheel_radius_;
-        vel_left_rear = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin - angular_speed_cmd*track_/2,2)
-                                                                         +pow(wheel_base_*angular_speed_cmd/2.0,2)))/wheel_radius_;
-        vel_right_rear = copysign(1.0, curr_cmd.lin) * sqrt((pow(curr_cmd.lin + angular_speed_cmd*track_/2,2)
-                                                                          +pow(wheel_base_*angular_speed_cmd/2.0,2)))/wheel_radius_;
-      }
+      vehicle_kinematics::simd::fourWheelSteeringToWheels(kinematics_, curr_cmd.lin, curr_cmd.front_steering,
+                                                          curr_cmd.rear_steering, wheels_cmd);
 
+    if (trace)
+    {
+      rt_logger_.debug("curr_cmd.lin %f wheel velocities %f %f %f %f", curr_cmd.lin,
+                       wheels_cmd.velocity[vehicle_kinematics::FRONT_LEFT], wheels_cmd.velocity[vehicle_kinematics::FRONT_RIGHT],
+                       wheels_cmd.velocity[vehicle_kinematics::REAR_LEFT], wheels_cmd.velocity[vehicle_kinematics::REAR_RIGHT]);
+      rt_logger_.debug("wheel steerings %f %f %f %f",
+                       wheels_cmd.steering[vehicle_kinematics::FRONT_LEFT], wheels_cmd.steering[vehicle_kinematics::FRONT_RIGHT],
+                       wheels_cmd.steering[vehicle_kinematics::REAR_LEFT], wheels_cmd.steering[vehicle_kinematics::REAR_RIGHT]);
     }
 
-    ROS_DEBUG_STREAM_THROTTLE(1, "vel_left_rear "<<vel_left_rear<<" front_right_steering "<<front_right_steering);
     // Set wheels velocities:
     if(front_wheel_joints_.size() == 2 && rear_wheel_joints_.size() == 2)
     {
-      front_wheel_joints_[0].setCommand(vel_left_front);
-      front_wheel_joints_[1].setCommand(vel_right_front);
-      rear_wheel_joints_[0].setCommand(vel_left_rear);
-      rear_wheel_joints_[1].setCommand(vel_right_rear);
+      front_wheel_joints_[0].setCommand(wheels_cmd.velocity[vehicle_kinematics::FRONT_LEFT]);
+      front_wheel_joints_[1].setCommand(wheels_cmd.velocity[vehicle_kinematics::FRONT_RIGHT]);
+      rear_wheel_joints_[0].setCommand(wheels_cmd.velocity[vehicle_kinematics::REAR_LEFT]);
+      rear_wheel_joints_[1].setCommand(wheels_cmd.velocity[vehicle_kinematics::REAR_RIGHT]);
     }
 
     /// TODO check limits to not apply the same steering on right and left when saturated !
     if(front_steering_joints_.size() == 2 && rear_steering_joints_.size() == 2)
     {
-      ROS_DEBUG_STREAM("front_left_steering "<<front_left_steering<<" rear_right_steering "<<rear_right_steering);
-      front_steering_joints_[0].setCommand(front_left_steering);
-      front_steering_joints_[1].setCommand(front_right_steering);
-      rear_steering_joints_[0].setCommand(rear_left_steering);
-      rear_steering_joints_[1].setCommand(rear_right_steering);
+      front_steering_joints_[0].setCommand(wheels_cmd.steering[vehicle_kinematics::FRONT_LEFT]);
+      front_steering_joints_[1].setCommand(wheels_cmd.steering[vehicle_kinematics::FRONT_RIGHT]);
+      rear_steering_joints_[0].setCommand(wheels_cmd.steering[vehicle_kinematics::REAR_LEFT]);
+      rear_steering_joints_[1].setCommand(wheels_cmd.steering[vehicle_kinematics::REAR_RIGHT]);
     }
   }
 
@@ -462,14 +640,44 @@ namespace four_wheel_steering_controller{
   {
     brake();
 
+    if (configuration_failed_.load(std::memory_order_acquire))
+    {
+      rt_logger_.error("Started with a failed configuration, braking.");
+      start_pending_ = false;
+      return;
+    }
+    start_pending_ = !ready_.load(std::memory_order_acquire);
+    if (!start_pending_)
+      startRunning(time);
+  }
+
+  void FourWheelSteeringController::startRunning(const ros::Time& time)
+  {
+    // Forget the commands of a previous run
+    command_.clear();
+    current_cmd_ = Commands();
+    controller_realtime_utils::SharedCommand shared_cmd;
+    while (shared_command_reader_.read(shared_cmd)) {}
+    command_horizon_.clear();
+    command_horizon_sequence_ = command_horizon_buffer_.sequence();
+
     // Register starting time used to keep fixed rate
     last_state_publish_time_ = time;
 
     odometry_.init(time);
+
+    // Warm restart, go on from the pose of the previous run
+    Odometry::State odom_state;
+    if (odom_state_.load(odom_state))
+    {
+      odometry_.setState(odom_state, odom_state_max_wheel_travel_);
+      rt_logger_.info("Odometry restored at x %f y %f heading %f", odom_state.x, odom_state.y, odom_state.heading);
+    }
   }
 
   void FourWheelSteeringController::stopping(const ros::Time& /*time*/)
   {
+    start_pending_ = false;
     brake();
   }
 
@@ -492,44 +700,131 @@ namespace four_wheel_steering_controller{
 
   void FourWheelSteeringController::cmdVelCallback(const geometry_msgs::Twist& command)
   {
-    if (isRunning())
-    {
-      command_struct_.ang   = command.angular.z;
-      command_struct_.lin   = command.linear.x;
-      command_struct_.stamp = ros::Time::now();
-      command_.writeFromNonRT (command_struct_);
-      ROS_DEBUG_STREAM_NAMED(name_,
-                             "Added values to command. "
-                             << "Ang: "   << command_struct_.ang << ", "
-                             << "Lin: "   << command_struct_.lin << ", "
-                             << "Stamp: " << command_struct_.stamp);
-    }
-    else
+    Commands command_struct;
+    command_struct.ang = command.angular.z;
+    command_struct.lin = command.linear.x;
+    queueCommand(command_struct);
+  }
+
+  void FourWheelSteeringController::cmdVelStampedCallback(const geometry_msgs::TwistStamped& command)
+  {
+    Commands command_struct;
+    command_struct.ang   = command.twist.angular.z;
+    command_struct.lin   = command.twist.linear.x;
+    command_struct.stamp = command.header.stamp;
+    queueCommand(command_struct);
+  }
+
+  void FourWheelSteeringController::cmdFourWheelSteeringCallback(const four_wheel_steering_msgs::FourWheelSteering& command)
+  {
+    Commands command_struct;
+    command_struct.front_steering = command.front_steering_angle;
+    command_struct.rear_steering  = command.rear_steering_angle;
+    command_struct.lin            = command.speed;
+    queueCommand(command_struct);
+  }
+
+  void FourWheelSteeringController::cmdFourWheelSteeringStampedCallback(const four_wheel_steering_msgs::FourWheelSteeringStamped& command)
+  {
+    Commands command_struct;
+    command_struct.front_steering = command.data.front_steering_angle;
+    command_struct.rear_steering  = command.data.rear_steering_angle;
+    command_struct.lin            = command.data.speed;
+    command_struct.stamp          = command.header.stamp;
+    queueCommand(command_struct);
+  }
+
+  void FourWheelSteeringController::cmdFourWheelSteeringHorizonCallback(const four_wheel_steering_msgs::FourWheelSteeringHorizon& horizon)
+  {
+    if (!isRunning())
     {
       ROS_ERROR_NAMED(name_, "Can't accept new commands. Controller is not running.");
+      return;
+    }
+
+    CommandHorizon command_horizon;
+    for (size_t i = 0; i < horizon.points.size(); ++i)
+    {
+      const four_wheel_steering_msgs::FourWheelSteeringStamped& point = horizon.points[i];
+      if (!command_horizon.push(point.header.stamp.toSec(), point.data.speed,
+                                point.data.front_steering_angle, point.data.rear_steering_angle))
+      {
+        ROS_ERROR_STREAM_NAMED(name_, "Rejected command horizon: it must have at most "
+                               << CommandHorizon::MAX_POINTS << " points with increasing stamps.");
+        return;
+      }
     }
+    command_horizon_buffer_.write(command_horizon);
+    ROS_DEBUG_STREAM_NAMED(name_, "Added command horizon of " << command_horizon.size() << " points.");
   }
 
-  void FourWheelSteeringController::cmdFourWheelSteeringCallback(const four_wheel_steering_msgs::FourWheelSteering& command)
+  void FourWheelSteeringController::queueCommand(Commands command)
   {
-    if (isRunning())
-    {
-      command_struct_four_wheel_steering_.front_steering   = command.front_steering_angle;
-      command_struct_four_wheel_steering_.rear_steering   = command.rear_steering_angle;
-      command_struct_four_wheel_steering_.lin   = command.speed;
-      command_struct_four_wheel_steering_.stamp = ros::Time::now();
-      command_four_wheel_steering_.writeFromNonRT (command_struct_four_wheel_steering_);
-      ROS_DEBUG_STREAM_NAMED(name_,
-                             "Added values to command. "
-                             << "Steering front : "   << command_struct_four_wheel_steering_.front_steering << ", "
-                             << "Steering rear : "   << command_struct_four_wheel_steering_.rear_steering << ", "
-                             << "Lin: "   << command_struct_four_wheel_steering_.lin << ", "
-                             << "Stamp: " << command_struct_four_wheel_steering_.stamp);
-    }
-    else
+    if (!isRunning())
     {
       ROS_ERROR_NAMED(name_, "Can't accept new commands. Controller is not running.");
+      return;
     }
+
+    // The queue applies the commands in order, one waiting for its time blocks the ones after it:
+    // a stamp too far ahead of the clock is taken as now, an older stamp than the last one is dropped
+    const ros::Time now = ros::Time::now();
+    const ros::Duration timeout(cmd_vel_timeout_);
+    if (command.stamp.isZero())
+      command.stamp = now;
+    else if (command.stamp > now + timeout)
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(1.0, name_, "Command stamped " << command.stamp << " is more than "
+                                     << cmd_vel_timeout_ << "s ahead of the clock, applied now");
+      command.stamp = now;
+    }
+    // Unless the clock went back, e.g. a simulation was restarted
+    if (last_queued_stamp_ > now + timeout)
+      last_queued_stamp_ = ros::Time();
+    if (command.stamp < last_queued_stamp_)
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(1.0, name_, "Dropped command stamped " << command.stamp
+                                     << ", older than the last one " << last_queued_stamp_);
+      return;
+    }
+    last_queued_stamp_ = command.stamp;
+
+    if (smooth_commands_)
+      planProfiles(command);
+
+    if (!command_.push(command))
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(1.0, name_, "Command queue is full, dropped command stamped " << command.stamp);
+      return;
+    }
+    ROS_DEBUG_STREAM_NAMED(name_,
+                           "Added values to command. "
+                           << "Ang: "   << command.ang << ", "
+                           << "Steering front : " << command.front_steering << ", "
+                           << "Steering rear : "  << command.rear_steering << ", "
+                           << "Lin: "   << command.lin << ", "
+                           << "Stamp: " << command.stamp);
+  }
+
+  void FourWheelSteeringController::planProfiles(Commands& command)
+  {
+    const double start_time = (command.stamp + cmd_delay_).toSec();
+    const double targets[LIMITED_AXES] = {command.lin, command.ang, command.front_steering, command.rear_steering};
+
+    // Start from the planned state, unless the previous command timed out and the controller braked
+    const bool from_planned = planned_cmd_.has_profiles
+        && (command.stamp - planned_cmd_.stamp).toSec() <= cmd_vel_timeout_;
+
+    for (int i = 0; i < LIMITED_AXES; ++i)
+    {
+      double value = 0.0, rate = 0.0;
+      if (from_planned)
+        planned_cmd_.profiles[i].sample(start_time, value, rate);
+      command.profiles[i].plan(start_time, value, rate, targets[i],
+                               limiter_.accelerationBound(i), limiter_.jerkBound(i));
+    }
+    command.has_profiles = true;
+    planned_cmd_ = command;
   }
 
   bool FourWheelSteeringController::getWheelNames(ros::NodeHandle& controller_nh,
@@ -585,6 +880,13 @@ namespace four_wheel_steering_controller{
       return true;
   }
 
+  bool FourWheelSteeringController::getPoseAtTimeCallback(four_wheel_steering_msgs::GetPoseAtTime::Request& request,
+                                                          four_wheel_steering_msgs::GetPoseAtTime::Response& response)
+  {
+    response.success = odometry_.getPoseAt(request.stamp, response.x, response.y, response.heading);
+    return true;
+  }
+
   void FourWheelSteeringController::setOdomPubFields(ros::NodeHandle& root_nh, ros::NodeHandle& controller_nh)
   {
     // Get and check params for covariances
@@ -602,34 +904,26 @@ namespace four_wheel_steering_controller{
     for (int i = 0; i < twist_cov_list.size(); ++i)
       ROS_ASSERT(twist_cov_list[i].getType() == XmlRpc::XmlRpcValue::TypeDouble);
 
-    // Setup odometry realtime publisher + odom message constant fields
-    odom_pub_.reset(new realtime_tools::RealtimePublisher<nav_msgs::Odometry>(controller_nh, "odom", 100));
-    odom_pub_->msg_.header.frame_id = "odom";
-    odom_pub_->msg_.child_frame_id = base_frame_id_;
-    odom_pub_->msg_.pose.pose.position.z = 0;
-    odom_pub_->msg_.pose.covariance = boost::assign::list_of
-        (static_cast<double>(pose_cov_list[0])) (0)  (0)  (0)  (0)  (0)
-        (0)  (static_cast<double>(pose_cov_list[1])) (0)  (0)  (0)  (0)
-        (0)  (0)  (static_cast<double>(pose_cov_list[2])) (0)  (0)  (0)
-        (0)  (0)  (0)  (static_cast<double>(pose_cov_list[3])) (0)  (0)
-        (0)  (0)  (0)  (0)  (static_cast<double>(pose_cov_list[4])) (0)
-        (0)  (0)  (0)  (0)  (0)  (static_cast<double>(pose_cov_list[5]));
-    odom_pub_->msg_.twist.twist.linear.y  = 0;
-    odom_pub_->msg_.twist.twist.linear.z  = 0;
-    odom_pub_->msg_.twist.twist.angular.x = 0;
-    odom_pub_->msg_.twist.twist.angular.y = 0;
-    odom_pub_->msg_.twist.covariance = boost::assign::list_of
-        (static_cast<double>(twist_cov_list[0])) (0)  (0)  (0)  (0)  (0)
-        (0)  (static_cast<double>(twist_cov_list[1])) (0)  (0)  (0)  (0)
-        (0)  (0)  (static_cast<double>(twist_cov_list[2])) (0)  (0)  (0)
-        (0)  (0)  (0)  (static_cast<double>(twist_cov_list[3])) (0)  (0)
-        (0)  (0)  (0)  (0)  (static_cast<double>(twist_cov_list[4])) (0)
-        (0)  (0)  (0)  (0)  (0)  (static_cast<double>(twist_cov_list[5]));
-    tf_odom_pub_.reset(new realtime_tools::RealtimePublisher<tf::tfMessage>(root_nh, "/tf", 100));
-    tf_odom_pub_->msg_.transforms.resize(1);
-    tf_odom_pub_->msg_.transforms[0].transform.translation.z = 0.0;
-    tf_odom_pub_->msg_.transforms[0].child_frame_id = base_frame_id_;
-    tf_odom_pub_->msg_.transforms[0].header.frame_id = "odom";
+    boost::array<double, 6> pose_covariance_diagonal;
+    boost::array<double, 6> twist_covariance_diagonal;
+    for (int i = 0; i < 6; ++i)
+    {
+      pose_covariance_diagonal[i] = static_cast<double>(pose_cov_list[i]);
+      twist_covariance_diagonal[i] = static_cast<double>(twist_cov_list[i]);
+    }
+
+    // Setup odometry publisher + odom message constant fields
+    odom_publisher_.init(root_nh, controller_nh, base_frame_id_,
+                         pose_covariance_diagonal, twist_covariance_diagonal, enable_odom_tf_);
+
+    // Every sample of the control loop, batched with each odometry message
+    bool enable_odom_samples = false;
+    controller_nh.param("enable_odom_samples", enable_odom_samples, enable_odom_samples);
+    if (enable_odom_samples)
+    {
+      odom_publisher_.initSamples(controller_nh, ODOM_SAMPLES_QUEUE_SIZE);
+      ROS_INFO_STREAM_NAMED(name_, "Publishing every odometry sample on odom_samples");
+    }
   }
 
 } // namespace four_wheel_steering_controller
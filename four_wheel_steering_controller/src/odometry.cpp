@@ -4,8 +4,6 @@
 
 namespace four_wheel_steering_controller
 {
-  namespace bacc = boost::accumulators;
-
   Odometry::Odometry(size_t velocity_rolling_window_size)
   : timestamp_(0.0)
   , last_update_timestamp_(0.0)
@@ -19,10 +17,18 @@ namespace four_wheel_steering_controller
   , track_(0.0)
   , wheel_radius_(0.0)
   , wheel_base_(0.0)
-  , wheel_old_pos_(0.0)
+  , wheels_old_pos_()
+  , steerings_old_()
+  , has_wheels_old_pos_(false)
+  , restored_wheel_travel_limit_(-1.0)
+  , integration_method_(vehicle_kinematics::INTEGRATION_EULER)
+  , velocity_old_()
+  , has_velocity_old_(false)
   , velocity_rolling_window_size_(velocity_rolling_window_size)
-  , linear_acc_(RollingWindow::window_size = velocity_rolling_window_size)
-  , angular_acc_(RollingWindow::window_size = velocity_rolling_window_size)
+  , linear_acc_(velocity_rolling_window_size)
+  , linear_x_acc_(velocity_rolling_window_size)
+  , linear_y_acc_(velocity_rolling_window_size)
+  , angular_acc_(velocity_rolling_window_size)
   {
   }
 
@@ -30,7 +36,12 @@ namespace four_wheel_steering_controller
   {
     // Reset accumulators and timestamp:
     resetAccumulators();
+    history_.clear();
+    has_velocity_old_ = false;
+    has_wheels_old_pos_ = false;
+    restored_wheel_travel_limit_ = -1.0;
     timestamp_ = time;
+    last_update_timestamp_ = time;
   }
 
 
@@ -38,30 +49,86 @@ namespace four_wheel_steering_controller
                         const double &rl_speed, const double &rr_speed,
                         double front_steering, double rear_steering, const ros::Time &time)
   {
-//    const double front_tmp = cos(front_steering)*(tan(front_steering)-tan(rear_steering))/wheel_base_;
-//    const double front_linear_speed = wheel_radius_ * copysign(1.0, fl_speed+fr_speed)*
-//        sqrt((pow(fl_speed,2)+pow(fr_speed,2))/(2+pow(track_*front_tmp,2)/2.0));
-
-    const double rear_tmp = cos(rear_steering)*(tan(front_steering)-tan(rear_steering))/wheel_base_;
-    const double rear_linear_speed = wheel_radius_ * copysign(1.0, rl_speed+rr_speed)*
-        sqrt((pow(rl_speed,2)+pow(rr_speed,2))/(2+pow(track_*rear_tmp,2)/2.0));
+    vehicle_kinematics::BodyVelocity<double> velocity;
+    kinematics_.wheelsToBody(rl_speed, rr_speed, front_steering, rear_steering, velocity);
 
-    angular_ = rear_linear_speed*rear_tmp;
-
-    linear_x_ = rear_linear_speed*cos(rear_steering);
-    linear_y_ = rear_linear_speed*sin(rear_steering)
-                + wheel_base_*angular_/2.0;
-    linear_ =  copysign(1.0, rear_linear_speed)*sqrt(pow(linear_x_,2)+pow(linear_y_,2));
+    /// Filter the velocities, the pose is integrated from the raw ones:
+    filterVelocity(velocity, rl_speed+rr_speed);
 
     /// Compute x, y and heading using velocity
     const double dt = (time - last_update_timestamp_).toSec();
     last_update_timestamp_ = time;
     /// Integrate odometry:
-    integrateXY(linear_x_*dt, linear_y_*dt, angular_*dt);
+    vehicle_kinematics::Pose2D<double> pose = {x_, y_, heading_};
+    vehicle_kinematics::integratePose(integration_method_, has_velocity_old_ ? velocity_old_ : velocity,
+                                      velocity, dt, pose);
+    x_ = pose.x;
+    y_ = pose.y;
+    heading_ = pose.heading;
+    velocity_old_ = velocity;
+    has_velocity_old_ = true;
 
+    history_.add(time.toSec(), x_, y_, heading_);
     return true;
   }
 
+  bool Odometry::updateFromPositions(const double (&wheel_pos)[4], const double (&wheel_speed)[4],
+                                     const double (&steering)[4], const ros::Time &time)
+  {
+    using vehicle_kinematics::REAR_LEFT;
+    using vehicle_kinematics::REAR_RIGHT;
+
+    /// The velocities are only reported, they do not move the pose:
+    vehicle_kinematics::BodyVelocity<double> velocity;
+    const bool has_velocity = kinematics_.wheelsToBody(wheel_speed, steering, velocity);
+    if (has_velocity)
+      filterVelocity(velocity, wheel_speed[REAR_LEFT]+wheel_speed[REAR_RIGHT]);
+    last_update_timestamp_ = time;
+
+    /// Positions restored from a previous run are only a baseline for a plausible travel:
+    /// encoders reset by a driver restart would move the pose by the whole distance travelled
+    if (has_wheels_old_pos_ && restored_wheel_travel_limit_ >= 0.0)
+    {
+      for (int i = 0; i < 4; ++i)
+        if (fabs(wheel_pos[i] - wheels_old_pos_[i])*wheel_radius_ > restored_wheel_travel_limit_)
+          has_wheels_old_pos_ = false;
+    }
+    restored_wheel_travel_limit_ = -1.0;
+
+    /// Integrate the displacement of the wheels since the last update, with the mean steering:
+    bool integrated = false;
+    if (has_wheels_old_pos_)
+    {
+      double wheel_diff_pos[4];
+      double mean_steering[4];
+      for (int i = 0; i < 4; ++i)
+      {
+        wheel_diff_pos[i] = wheel_pos[i] - wheels_old_pos_[i];
+        mean_steering[i] = (steering[i] + steerings_old_[i])/2.0;
+      }
+
+      vehicle_kinematics::BodyVelocity<double> displacement;
+      if (kinematics_.wheelsToBody(wheel_diff_pos, mean_steering, displacement))
+      {
+        vehicle_kinematics::Pose2D<double> pose = {x_, y_, heading_};
+        vehicle_kinematics::integratePose(integration_method_, displacement, displacement, 1.0, pose);
+        x_ = pose.x;
+        y_ = pose.y;
+        heading_ = pose.heading;
+        integrated = true;
+      }
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+      wheels_old_pos_[i] = wheel_pos[i];
+      steerings_old_[i] = steering[i];
+    }
+    has_wheels_old_pos_ = true;
+
+    history_.add(time.toSec(), x_, y_, heading_);
+    return has_velocity && integrated;
+  }
+
   void Odometry::updateOpenLoop(double linear, double angular, const ros::Time &time)
   {
     /// Save last linear and angular velocity:
@@ -72,6 +139,53 @@ namespace four_wheel_steering_controller
     const double dt = (time - timestamp_).toSec();
     timestamp_ = time;
     integrateExact(linear * dt, angular * dt);
+    history_.add(time.toSec(), x_, y_, heading_);
+  }
+
+  Odometry::State Odometry::getState() const
+  {
+    State state;
+    state.x = x_;
+    state.y = y_;
+    state.heading = heading_;
+    for (int i = 0; i < 4; ++i)
+    {
+      state.wheel_pos[i] = wheels_old_pos_[i];
+      state.steering[i] = steerings_old_[i];
+    }
+    state.has_wheel_pos = has_wheels_old_pos_;
+    return state;
+  }
+
+  void Odometry::setState(const State& state, double max_wheel_travel)
+  {
+    x_ = state.x;
+    y_ = state.y;
+    heading_ = state.heading;
+    for (int i = 0; i < 4; ++i)
+    {
+      wheels_old_pos_[i] = state.wheel_pos[i];
+      steerings_old_[i] = state.steering[i];
+    }
+    has_wheels_old_pos_ = state.has_wheel_pos;
+    restored_wheel_travel_limit_ = max_wheel_travel;
+  }
+
+  bool Odometry::getPoseAt(const ros::Time &time, double &x, double &y, double &heading) const
+  {
+    controller_realtime_utils::StampedPose pose;
+    if (!history_.lookup(time.toSec(), pose))
+      return false;
+
+    x = pose.x;
+    y = pose.y;
+    heading = pose.heading;
+    return true;
+  }
+
+  void Odometry::setHistorySize(size_t history_size)
+  {
+    history_.setCapacity(history_size);
   }
 
   void Odometry::setWheelParams(double track, double wheel_radius, double wheel_base)
@@ -79,23 +193,22 @@ namespace four_wheel_steering_controller
     track_ = track;
     wheel_radius_     = wheel_radius;
     wheel_base_       = wheel_base;
+    kinematics_.setWheelParams(track, wheel_radius, wheel_base);
   }
 
   void Odometry::setVelocityRollingWindowSize(size_t velocity_rolling_window_size)
   {
     velocity_rolling_window_size_ = velocity_rolling_window_size;
 
-    resetAccumulators();
+    linear_acc_.resize(velocity_rolling_window_size_);
+    linear_x_acc_.resize(velocity_rolling_window_size_);
+    linear_y_acc_.resize(velocity_rolling_window_size_);
+    angular_acc_.resize(velocity_rolling_window_size_);
   }
 
-  void Odometry::integrateXY(double linear_x, double linear_y, double angular)
+  void Odometry::setIntegrationMethod(vehicle_kinematics::IntegrationMethod method)
   {
-    const double delta_x = linear_x*cos(heading_) - linear_y*sin(heading_);
-    const double delta_y = linear_x*sin(heading_) + linear_y*cos(heading_);
-
-    x_ += delta_x;
-    y_ += delta_y;
-    heading_ += angular;
+    integration_method_ = method;
   }
 
   void Odometry::integrateRungeKutta2(double linear, double angular)
@@ -123,10 +236,24 @@ namespace four_wheel_steering_controller
     }
   }
 
+  void Odometry::filterVelocity(const vehicle_kinematics::BodyVelocity<double>& velocity, double direction)
+  {
+    linear_acc_.push(copysign(1.0, direction)*sqrt(pow(velocity.linear_x,2)+pow(velocity.linear_y,2)));
+    linear_x_acc_.push(velocity.linear_x);
+    linear_y_acc_.push(velocity.linear_y);
+    angular_acc_.push(velocity.angular);
+    linear_ = linear_acc_.mean();
+    linear_x_ = linear_x_acc_.mean();
+    linear_y_ = linear_y_acc_.mean();
+    angular_ = angular_acc_.mean();
+  }
+
   void Odometry::resetAccumulators()
   {
-    linear_acc_ = RollingMeanAcc(RollingWindow::window_size = velocity_rolling_window_size_);
-    angular_acc_ = RollingMeanAcc(RollingWindow::window_size = velocity_rolling_window_size_);
+    linear_acc_.clear();
+    linear_x_acc_.clear();
+    linear_y_acc_.clear();
+    angular_acc_.clear();
   }
 
 } // namespace four_wheel_steering_controller
@@ -111,6 +111,24 @@ public:
     }
   }
 
+  /// Last commands of the controller, indexed as the joint names
+  double wheelVelocityCommand(unsigned int i) const { return joints_[i].velocity_command; }
+  double steeringCommand(unsigned int i) const { return steering_joints_[i].position_command; }
+
+  /// Turns all the wheels by an angle [rad], as when the vehicle is pushed
+  void pushWheels(double angle)
+  {
+    for (unsigned int i = 0; i < 4; ++i)
+      joints_[i].position += angle;
+  }
+
+  /// Sets the wheel positions back to zero, as when the driver restarts
+  void resetWheels()
+  {
+    for (unsigned int i = 0; i < 4; ++i)
+      joints_[i].position = 0.0;
+  }
+
   bool start_callback(std_srvs::Empty::Request& /*req*/, std_srvs::Empty::Response& /*res*/)
   {
     running_ = true;
@@ -1,28 +1,28 @@
 #include "test_common.h"
+
+#include <sstream>
+
+#include <unistd.h>
 #include <tf/transform_listener.h>
 
 // TEST CASES
 TEST_F(FourWheelSteeringControllerTest, testForward)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
+  ASSERT_TRUE(isControllerAlive());
   // zero everything before test
   four_wheel_steering_msgs::FourWheelSteering cmd_vel;
   cmd_vel.speed = 0.0;
   cmd_vel.front_steering_angle = 0.0;
   cmd_vel.rear_steering_angle = 0.0;
   publish_4ws(cmd_vel);
-  ros::Duration(0.1).sleep();
+  run(0.1);
   // get initial odom
   nav_msgs::Odometry old_odom = getLastOdom();
   // send a velocity command of 0.1 m/s
   cmd_vel.speed = 0.1;
   publish_4ws(cmd_vel);
   // wait for 10s
-  ros::Duration(10.0).sleep();
+  run(10.0);
 
   nav_msgs::Odometry new_odom = getLastOdom();
 
@@ -52,18 +52,14 @@ TEST_F(FourWheelSteeringControllerTest, testForward)
 
 TEST_F(FourWheelSteeringControllerTest, testCrab)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
+  ASSERT_TRUE(isControllerAlive());
   // zero everything before test
   four_wheel_steering_msgs::FourWheelSteering cmd_vel;
   cmd_vel.speed = 0.0;
   cmd_vel.front_steering_angle = 0.0;
   cmd_vel.rear_steering_angle = 0.0;
   publish_4ws(cmd_vel);
-  ros::Duration(0.1).sleep();
+  run(0.1);
   // get initial odom
   nav_msgs::Odometry old_odom = getLastOdom();
   // send a velocityand steering command
@@ -73,7 +69,7 @@ TEST_F(FourWheelSteeringControllerTest, testCrab)
   publish_4ws(cmd_vel);
   // wait for 10s
   double travel_time = 8.0;
-  ros::Duration(travel_time).sleep();
+  run(travel_time);
 
   nav_msgs::Odometry new_odom = getLastOdom();
 
@@ -105,18 +101,14 @@ TEST_F(FourWheelSteeringControllerTest, testCrab)
 
 TEST_F(FourWheelSteeringControllerTest, testSymmetricTurn)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
+  ASSERT_TRUE(isControllerAlive());
   // zero everything before test
   four_wheel_steering_msgs::FourWheelSteering cmd_vel;
   cmd_vel.speed = 0.0;
   cmd_vel.front_steering_angle = 0.0;
   cmd_vel.rear_steering_angle = 0.0;
   publish_4ws(cmd_vel);
-  ros::Duration(0.1).sleep();
+  run(0.1);
   // get initial odom
   nav_msgs::Odometry old_odom = getLastOdom();
   // send a velocity command
@@ -128,7 +120,7 @@ TEST_F(FourWheelSteeringControllerTest, testSymmetricTurn)
   cmd_vel.rear_steering_angle = -0.18776;
   publish_4ws(cmd_vel);
   // wait for 10s to make a half turn
-  ros::Duration(10.0).sleep();
+  run(10.0);
 
   nav_msgs::Odometry new_odom = getLastOdom();
 
@@ -159,18 +151,14 @@ TEST_F(FourWheelSteeringControllerTest, testSymmetricTurn)
 
 TEST_F(FourWheelSteeringControllerTest, testNonSymmetricTurn)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
+  ASSERT_TRUE(isControllerAlive());
   // zero everything before test
   four_wheel_steering_msgs::FourWheelSteering cmd_vel;
   cmd_vel.speed = 0.0;
   cmd_vel.front_steering_angle = 0.0;
   cmd_vel.rear_steering_angle = 0.0;
   publish_4ws(cmd_vel);
-  ros::Duration(0.1).sleep();
+  run(0.1);
   // get initial odom
   nav_msgs::Odometry old_odom = getLastOdom();
   // send a velocity command
@@ -183,7 +171,7 @@ TEST_F(FourWheelSteeringControllerTest, testNonSymmetricTurn)
   cmd_vel.rear_steering_angle = 0.15866;
   publish_4ws(cmd_vel);
   // wait for 10s to make a half turn
-  ros::Duration(10.0).sleep();
+  run(10.0);
 
   nav_msgs::Odometry new_odom = getLastOdom();
 
@@ -212,18 +200,221 @@ TEST_F(FourWheelSteeringControllerTest, testNonSymmetricTurn)
   EXPECT_NEAR(new_odom.twist.twist.angular.z, cmd_angular, EPS);
 }
 
-TEST_F(FourWheelSteeringControllerTest, testOdomFrame)
+TEST_F(FourWheelSteeringControllerTest, testHorizon)
 {
-  // wait for ROS
-  while(!isControllerAlive())
+  ASSERT_TRUE(isControllerAlive());
+  // zero everything before test
+  four_wheel_steering_msgs::FourWheelSteering cmd_vel;
+  cmd_vel.speed = 0.0;
+  cmd_vel.front_steering_angle = 0.0;
+  cmd_vel.rear_steering_angle = 0.0;
+  publish_4ws(cmd_vel);
+  run(0.1);
+
+  // a single horizon of 10s at 0.1 m/s, with a point every second
+  const ros::Time start = now() + ros::Duration(1.0);
+  four_wheel_steering_msgs::FourWheelSteeringHorizon horizon;
+  horizon.header.stamp = now();
+  for (int i = 0; i <= 10; ++i)
   {
-    ros::Duration(0.1).sleep();
+    four_wheel_steering_msgs::FourWheelSteeringStamped point;
+    point.header.stamp = start + ros::Duration(i);
+    point.data.speed = 0.1;
+    horizon.points.push_back(point);
   }
-  // set up tf listener
+  publish_horizon(horizon);
+
+  // get odom once the robot is moving, no other command is sent
+  run(3.0);
+  nav_msgs::Odometry old_odom = getLastOdom();
+  run(5.0);
+  nav_msgs::Odometry new_odom = getLastOdom();
+
+  // check if the robot traveled 0.5 meter in XY plane
+  const double dx = new_odom.pose.pose.position.x - old_odom.pose.pose.position.x;
+  const double dy = new_odom.pose.pose.position.y - old_odom.pose.pose.position.y;
+  EXPECT_NEAR(sqrt(dx*dx + dy*dy), 0.5, POSITION_TOLERANCE);
+  EXPECT_NEAR(fabs(new_odom.twist.twist.linear.x), 0.1, EPS);
+  EXPECT_LT(fabs(new_odom.twist.twist.angular.z), EPS);
+}
+
+TEST_F(FourWheelSteeringControllerTest, testWarmRestart)
+{
+  ASSERT_TRUE(isControllerAlive());
+  // odometry from the wheel positions, saved in a state file
+  std::ostringstream state_file;
+  state_file << "/dev/shm/four_wheel_steering_controller_test_state_" << getpid();
+  unlink(state_file.str().c_str());
+  setControllerParam("odom_state_file", state_file.str());
+  setControllerParam("odom_from_wheel_positions", true);
+  ASSERT_TRUE(unloadController());
+  ASSERT_TRUE(startController());
+
+  four_wheel_steering_msgs::FourWheelSteering cmd_vel;
+  cmd_vel.speed = 0.5;
+  cmd_vel.front_steering_angle = 0.0;
+  cmd_vel.rear_steering_angle = 0.0;
+  publish_4ws(cmd_vel);
+  run(2.0);
+  cmd_vel.speed = 0.0;
+  publish_4ws(cmd_vel);
+  run(0.5);
+  nav_msgs::Odometry old_odom = getLastOdom();
+  EXPECT_GT(old_odom.pose.pose.position.x, 0.9);
+
+  // the vehicle is pushed half a meter while the controller is unloaded
+  ASSERT_TRUE(unloadController());
+  double wheel_radius = 0.0;
+  ASSERT_TRUE(getControllerParam("wheel_radius", wheel_radius));
+  pushWheels(0.5/wheel_radius);
+
+  // a new instance goes on from the saved pose and integrates the push from the saved wheel positions
+  ASSERT_TRUE(startController());
+  run(0.5);
+  nav_msgs::Odometry new_odom = getLastOdom();
+  EXPECT_NEAR(new_odom.pose.pose.position.x - old_odom.pose.pose.position.x, 0.5, POSITION_TOLERANCE);
+  EXPECT_NEAR(new_odom.pose.pose.position.y, old_odom.pose.pose.position.y, POSITION_TOLERANCE);
+  EXPECT_NEAR(tf::getYaw(new_odom.pose.pose.orientation), tf::getYaw(old_odom.pose.pose.orientation),
+              ORIENTATION_TOLERANCE);
+
+  // a stop and start of the same instance does not move the pose
+  ASSERT_TRUE(unloadController());
+  ASSERT_TRUE(startController());
+  run(0.5);
+  nav_msgs::Odometry restarted_odom = getLastOdom();
+  EXPECT_NEAR(restarted_odom.pose.pose.position.x, new_odom.pose.pose.position.x, POSITION_TOLERANCE);
+  EXPECT_NEAR(restarted_odom.pose.pose.position.y, new_odom.pose.pose.position.y, POSITION_TOLERANCE);
+
+  // encoders reset by a driver restart are not taken for a travel back to the start
+  ASSERT_TRUE(unloadController());
+  resetWheels();
+  ASSERT_TRUE(startController());
+  run(0.5);
+  nav_msgs::Odometry reset_odom = getLastOdom();
+  EXPECT_NEAR(reset_odom.pose.pose.position.x, restarted_odom.pose.pose.position.x, POSITION_TOLERANCE);
+  EXPECT_NEAR(reset_odom.pose.pose.position.y, restarted_odom.pose.pose.position.y, POSITION_TOLERANCE);
+
+  deleteControllerParam("odom_state_file");
+  deleteControllerParam("odom_from_wheel_positions");
+  unlink(state_file.str().c_str());
+}
+
+TEST_F(FourWheelSteeringControllerTest, testSmoothCommands)
+{
+  ASSERT_TRUE(isControllerAlive());
+  const double max_acceleration = 1.0, max_jerk = 5.0;
+  const double max_steering_rate = 0.5, max_steering_acceleration = 2.0;
+  setControllerParam("smooth_commands", true);
+  setControllerParam("linear/x/has_acceleration_limits", true);
+  setControllerParam("linear/x/max_acceleration", max_acceleration);
+  setControllerParam("linear/x/has_jerk_limits", true);
+  setControllerParam("linear/x/max_jerk", max_jerk);
+  const std::string steering_axes[] = {"front_steering", "rear_steering"};
+  for (int i = 0; i < 2; ++i)
+  {
+    setControllerParam(steering_axes[i] + "/has_acceleration_limits", true);
+    setControllerParam(steering_axes[i] + "/max_acceleration", max_steering_rate);
+    setControllerParam(steering_axes[i] + "/has_jerk_limits", true);
+    setControllerParam(steering_axes[i] + "/max_jerk", max_steering_acceleration);
+  }
+  ASSERT_TRUE(unloadController());
+  ASSERT_TRUE(startController());
+  double wheel_radius = 0.0;
+  ASSERT_TRUE(getControllerParam("wheel_radius", wheel_radius));
+
+  // a crab command: every wheel steers as the command and rolls at its speed
+  four_wheel_steering_msgs::FourWheelSteering cmd_vel;
+  cmd_vel.speed = 1.0;
+  cmd_vel.front_steering_angle = 0.2;
+  cmd_vel.rear_steering_angle = 0.2;
+  publish_4ws(cmd_vel);
+
+  // sample the commands written to the front left joints at every update
+  const double dt = period().toSec();
+  std::vector<double> speeds(1, 0.0), steerings(1, 0.0);
+  for (int i = 0; i < 200; ++i)
+  {
+    step();
+    speeds.push_back(wheelVelocityCommand(0)*wheel_radius);
+    steerings.push_back(steeringCommand(0));
+  }
+
+  // the targets are reached, without overshoot, within the time optimal transitions
+  const std::size_t speed_reached = static_cast<std::size_t>(
+        (cmd_vel.speed/max_acceleration + max_acceleration/max_jerk)/dt) + 3;
+  const std::size_t steering_reached = static_cast<std::size_t>(
+        (cmd_vel.front_steering_angle/max_steering_rate + max_steering_rate/max_steering_acceleration)/dt) + 3;
+  EXPECT_NEAR(speeds[speed_reached], cmd_vel.speed, EPS);
+  EXPECT_NEAR(speeds.back(), cmd_vel.speed, 1e-6);
+  EXPECT_NEAR(steerings[steering_reached], cmd_vel.front_steering_angle, EPS);
+  EXPECT_NEAR(steerings.back(), cmd_vel.front_steering_angle, 1e-6);
+
+  // the first and second derivatives stay within the limits
+  const double tolerance = 1e-6;
+  for (std::size_t i = 2; i < speeds.size(); ++i)
+  {
+    EXPECT_LE(speeds[i], cmd_vel.speed + tolerance);
+    EXPECT_LE(steerings[i], cmd_vel.front_steering_angle + tolerance);
+    EXPECT_LE(std::abs(speeds[i] - speeds[i-1])/dt, max_acceleration + tolerance) << "at update " << i;
+    EXPECT_LE(std::abs(speeds[i] - 2*speeds[i-1] + speeds[i-2])/(dt*dt), max_jerk + tolerance) << "at update " << i;
+    EXPECT_LE(std::abs(steerings[i] - steerings[i-1])/dt, max_steering_rate + tolerance) << "at update " << i;
+    EXPECT_LE(std::abs(steerings[i] - 2*steerings[i-1] + steerings[i-2])/(dt*dt),
+              max_steering_acceleration + tolerance) << "at update " << i;
+  }
+
+  deleteControllerParam("smooth_commands");
+  deleteControllerParam("linear");
+  deleteControllerParam("front_steering");
+  deleteControllerParam("rear_steering");
+  ASSERT_TRUE(unloadController());
+  ASSERT_TRUE(startController());
+}
+
+TEST_F(FourWheelSteeringControllerTest, testStampedCommands)
+{
+  ASSERT_TRUE(isControllerAlive());
+  double cmd_vel_timeout = 0.0;
+  ASSERT_TRUE(getControllerParam("cmd_vel_timeout", cmd_vel_timeout));
+  setControllerParam("enable_stamped_cmd", true);
+  ASSERT_TRUE(unloadController());
+  ASSERT_TRUE(startController());
+  double wheel_radius = 0.0;
+  ASSERT_TRUE(getControllerParam("wheel_radius", wheel_radius));
+
+  // a stamp far ahead of the clock is applied now instead of blocking the commands after it
+  four_wheel_steering_msgs::FourWheelSteeringStamped cmd_vel;
+  cmd_vel.header.stamp = now() + ros::Duration(4*cmd_vel_timeout);
+  cmd_vel.data.speed = 0.5;
+  publish_4ws_stamped(cmd_vel);
+  run(0.5);
+  EXPECT_NEAR(wheelVelocityCommand(0)*wheel_radius, 0.5, EPS);
+
+  // a stamp older than the last one is dropped
+  cmd_vel.header.stamp = now() - ros::Duration(1.0);
+  cmd_vel.data.speed = 1.0;
+  publish_4ws_stamped(cmd_vel);
+  run(0.5);
+  EXPECT_NEAR(wheelVelocityCommand(0)*wheel_radius, 0.5, EPS);
+
+  // the next ones go on
+  cmd_vel.header.stamp = now();
+  cmd_vel.data.speed = 0.0;
+  publish_4ws_stamped(cmd_vel);
+  run(0.5);
+  EXPECT_NEAR(wheelVelocityCommand(0)*wheel_radius, 0.0, EPS);
+
+  deleteControllerParam("enable_stamped_cmd");
+  ASSERT_TRUE(unloadController());
+  ASSERT_TRUE(startController());
+}
+
+TEST_F(FourWheelSteeringControllerTest, testOdomFrame)
+{
+  ASSERT_TRUE(isControllerAlive());
+  // set up tf listener, the transforms are sent as the simulated clock goes on
   tf::TransformListener listener;
-  ros::Duration(2.0).sleep();
   // check the odom frame exist
-  EXPECT_TRUE(listener.frameExists("odom"));
+  EXPECT_TRUE(runUntil([&listener]() { return listener.frameExists("odom"); }, 2.0));
 }
 
 int main(int argc, char** argv)
@@ -231,11 +422,8 @@ int main(int argc, char** argv)
   testing::InitGoogleTest(&argc, argv);
   ros::init(argc, argv, "four_wheel_steering_4ws_cmd_test");
 
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
-  //ros::Duration(0.5).sleep();
+  // No spinner, the simulated clock delivers the messages between two updates
   int ret = RUN_ALL_TESTS();
-  spinner.stop();
   ros::shutdown();
   return ret;
 }
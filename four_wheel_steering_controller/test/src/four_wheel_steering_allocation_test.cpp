@@ -0,0 +1,143 @@
+// Runs the controller in process on the fake hardware and checks that
+// update() never touches the heap.
+
+#include <controller_realtime_utils/testing/allocation_tracker.h>
+
+#include <gtest/gtest.h>
+
+#include <geometry_msgs/Twist.h>
+#include <four_wheel_steering_msgs/FourWheelSteering.h>
+
+#include <four_wheel_steering_controller/four_wheel_steering_controller.h>
+
+#include "four_wheel_steering.h"
+
+// Number of update() calls checked, several odometry publish periods
+const int UPDATE_COUNT = 500;
+
+class FourWheelSteeringAllocationTest : public ::testing::Test
+{
+public:
+  FourWheelSteeringAllocationTest()
+  : cmd_twist_pub(nh.advertise<geometry_msgs::Twist>("twist/four_wheel_steering_controller/cmd_vel", 1))
+  , cmd_4ws_pub(nh.advertise<four_wheel_steering_msgs::FourWheelSteering>("4ws/four_wheel_steering_controller/cmd_four_wheel_steering", 1))
+  {
+  }
+
+  /// Sends a turning command once the running controller is connected
+  void publishCommands()
+  {
+    for (int i = 0; i < 50 && cmd_twist_pub.getNumSubscribers() + cmd_4ws_pub.getNumSubscribers() == 0; ++i)
+      ros::Duration(0.1).sleep();
+
+    geometry_msgs::Twist cmd_vel;
+    cmd_vel.linear.x = 1.0;
+    cmd_vel.angular.z = 0.2;
+    cmd_twist_pub.publish(cmd_vel);
+
+    four_wheel_steering_msgs::FourWheelSteering cmd_4ws;
+    cmd_4ws.speed = 1.0;
+    cmd_4ws.front_steering_angle = 0.2;
+    cmd_4ws.rear_steering_angle = -0.1;
+    cmd_4ws_pub.publish(cmd_4ws);
+
+    ros::Duration(0.5).sleep();
+  }
+
+  /**
+   * \brief Initializes and starts the controller found in the given namespace,
+   *        then returns the number of heap operations made by its update() calls
+   */
+  size_t countUpdateAllocations(const std::string& controller_ns)
+  {
+    ros::NodeHandle root_nh;
+    ros::NodeHandle controller_nh(controller_ns);
+    four_wheel_steering_controller::FourWheelSteeringController controller;
+    std::set<std::string> claimed_resources;
+    if (!controller.initRequest(&robot, root_nh, controller_nh, claimed_resources))
+    {
+      ADD_FAILURE() << "Could not initialize " << controller_ns;
+      return 0;
+    }
+
+    controller.startRequest(ros::Time::now());
+
+    // A controller configured in the background brakes until it is ready,
+    // then finishes starting on the update after
+    ros::Time time = ros::Time::now();
+    const ros::Duration period = robot.getPeriod();
+    for (int i = 0; i < 100 && !controller.isReady(); ++i)
+    {
+      time += period;
+      controller.updateRequest(time, period);
+      ros::Duration(0.05).sleep();
+    }
+    if (!controller.isReady())
+    {
+      ADD_FAILURE() << controller_ns << " is not ready";
+      return 0;
+    }
+    time += period;
+    controller.updateRequest(time, period);
+
+    publishCommands();
+    time = ros::Time::now();
+
+    size_t heap_operations = 0;
+    for (int i = 0; i < UPDATE_COUNT; ++i)
+    {
+      time += period;
+      {
+        allocation_tracker::ScopedTracking tracking;
+        controller.updateRequest(time, period);
+      }
+      heap_operations += allocation_tracker::allocations() + allocation_tracker::deallocations();
+      robot.write();
+    }
+    return heap_operations;
+  }
+
+private:
+  ros::NodeHandle nh;
+  ros::Publisher cmd_twist_pub;
+  ros::Publisher cmd_4ws_pub;
+  FourWheelSteering robot;
+};
+
+TEST_F(FourWheelSteeringAllocationTest, testTrackerCountsAllocations)
+{
+  {
+    allocation_tracker::ScopedTracking tracking;
+    delete new double(1.0);
+  }
+  EXPECT_EQ(allocation_tracker::allocations(), 1u);
+  EXPECT_EQ(allocation_tracker::deallocations(), 1u);
+}
+
+TEST_F(FourWheelSteeringAllocationTest, testTwistCmdUpdateIsAllocationFree)
+{
+  EXPECT_EQ(countUpdateAllocations("twist/four_wheel_steering_controller"), 0u);
+}
+
+TEST_F(FourWheelSteeringAllocationTest, testFourWheelSteeringCmdUpdateIsAllocationFree)
+{
+  EXPECT_EQ(countUpdateAllocations("4ws/four_wheel_steering_controller"), 0u);
+}
+
+TEST_F(FourWheelSteeringAllocationTest, testAsyncInitUpdateIsAllocationFree)
+{
+  EXPECT_EQ(countUpdateAllocations("async/four_wheel_steering_controller"), 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "four_wheel_steering_allocation_test");
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+  int ret = RUN_ALL_TESTS();
+  spinner.stop();
+  ros::shutdown();
+  return ret;
+}
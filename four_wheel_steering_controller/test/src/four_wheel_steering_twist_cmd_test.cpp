@@ -4,24 +4,20 @@
 // TEST CASES
 TEST_F(FourWheelSteeringControllerTest, testForward)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
+  ASSERT_TRUE(isControllerAlive());
   // zero everything before test
   geometry_msgs::Twist cmd_vel;
   cmd_vel.linear.x = 0.0;
   cmd_vel.angular.z = 0.0;
   publish(cmd_vel);
-  ros::Duration(0.1).sleep();
+  run(0.1);
   // get initial odom
   nav_msgs::Odometry old_odom = getLastOdom();
   // send a velocity command of 0.1 m/s
   cmd_vel.linear.x = 0.1;
   publish(cmd_vel);
   // wait for 10s
-  ros::Duration(10.0).sleep();
+  run(10.0);
 
   nav_msgs::Odometry new_odom = getLastOdom();
 
@@ -51,17 +47,13 @@ TEST_F(FourWheelSteeringControllerTest, testForward)
 
 TEST_F(FourWheelSteeringControllerTest, testTurn)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
+  ASSERT_TRUE(isControllerAlive());
   // zero everything before test
   geometry_msgs::Twist cmd_vel;
   cmd_vel.linear.x = 0.0;
   cmd_vel.angular.z = 0.0;
   publish(cmd_vel);
-  ros::Duration(0.1).sleep();
+  run(0.1);
   // get initial odom
   nav_msgs::Odometry old_odom = getLastOdom();
   // send a velocity command
@@ -69,7 +61,7 @@ TEST_F(FourWheelSteeringControllerTest, testTurn)
   cmd_vel.angular.z = M_PI/10.0;
   publish(cmd_vel);
   // wait for 10s to make a half turn
-  ros::Duration(10.0).sleep();
+  run(10.0);
 
   nav_msgs::Odometry new_odom = getLastOdom();
 
@@ -100,16 +92,96 @@ TEST_F(FourWheelSteeringControllerTest, testTurn)
 
 TEST_F(FourWheelSteeringControllerTest, testOdomFrame)
 {
-  // wait for ROS
-  while(!isControllerAlive())
-  {
-    ros::Duration(0.1).sleep();
-  }
-  // set up tf listener
+  ASSERT_TRUE(isControllerAlive());
+  // set up tf listener, the transforms are sent as the simulated clock goes on
   tf::TransformListener listener;
-  ros::Duration(2.0).sleep();
   // check the odom frame exist
-  EXPECT_TRUE(listener.frameExists("odom"));
+  EXPECT_TRUE(runUntil([&listener]() { return listener.frameExists("odom"); }, 2.0));
+}
+
+TEST_F(FourWheelSteeringControllerTest, testOdomTopic)
+{
+  ASSERT_TRUE(isControllerAlive());
+  geometry_msgs::Twist cmd_vel;
+  cmd_vel.linear.x = 0.5;
+  cmd_vel.angular.z = 0.0;
+  publish(cmd_vel);
+  run(2.0);
+
+  // the odometry of the last update, stamped with the simulated time of the update
+  nav_msgs::Odometry odom = getLastOdom();
+  EXPECT_EQ(odom.header.stamp, now() - period());
+  EXPECT_EQ(odom.header.frame_id, "odom");
+  EXPECT_EQ(odom.child_frame_id, "base_footprint");
+
+  // covariances from the configuration
+  for (int i = 0; i < 5; ++i)
+  {
+    EXPECT_DOUBLE_EQ(odom.pose.covariance[7*i], 0.001);
+    EXPECT_DOUBLE_EQ(odom.twist.covariance[7*i], 0.001);
+  }
+  EXPECT_DOUBLE_EQ(odom.pose.covariance[35], 0.03);
+  EXPECT_DOUBLE_EQ(odom.twist.covariance[35], 0.03);
+  EXPECT_DOUBLE_EQ(odom.pose.covariance[1], 0.0);
+
+  // planar motion, straight ahead at the commanded speed
+  EXPECT_EQ(odom.pose.pose.position.z, 0.0);
+  EXPECT_EQ(odom.pose.pose.orientation.x, 0.0);
+  EXPECT_EQ(odom.pose.pose.orientation.y, 0.0);
+  EXPECT_NEAR(odom.pose.pose.orientation.w, 1.0, EPS);
+  EXPECT_GT(odom.pose.pose.position.x, 0.5);
+  EXPECT_NEAR(odom.pose.pose.position.y, 0.0, POSITION_TOLERANCE);
+  EXPECT_NEAR(odom.twist.twist.linear.x, cmd_vel.linear.x, VELOCITY_TOLERANCE);
+  EXPECT_NEAR(odom.twist.twist.angular.z, 0.0, EPS);
+
+  // a message for each update
+  run(0.1);
+  nav_msgs::Odometry next_odom = getLastOdom();
+  EXPECT_EQ(next_odom.header.stamp, now() - period());
+  EXPECT_NEAR(next_odom.pose.pose.position.x - odom.pose.pose.position.x, 0.1*cmd_vel.linear.x, POSITION_TOLERANCE);
+}
+
+TEST_F(FourWheelSteeringControllerTest, testOdomSamples)
+{
+  ASSERT_TRUE(isControllerAlive());
+  geometry_msgs::Twist cmd_vel;
+  cmd_vel.linear.x = 1.0;
+  cmd_vel.angular.z = 0.2;
+  publish(cmd_vel);
+  run(2.0);
+
+  nav_msgs::Odometry odom = getLastOdom();
+  const std::vector<four_wheel_steering_msgs::OdometrySampleArray>& batches = getOdomSamples();
+  ASSERT_FALSE(batches.empty());
+
+  // Put end to end, the batches hold the sample of every update once and in order,
+  // whatever the number of samples of each batch
+  ros::Time expected_stamp = batches.front().header.stamp;
+  std::size_t sample_count = 0;
+  four_wheel_steering_msgs::OdometrySample last_sample;
+  for (std::size_t i = 0; i < batches.size(); ++i)
+  {
+    EXPECT_EQ(batches[i].header.frame_id, "odom");
+    EXPECT_EQ(batches[i].child_frame_id, "base_footprint");
+    EXPECT_DOUBLE_EQ(batches[i].pose_covariance_diagonal[5], 0.03);
+    for (std::size_t j = 0; j < batches[i].samples.size(); ++j)
+    {
+      const ros::Time stamp = batches[i].header.stamp + ros::Duration(batches[i].samples[j].time_offset);
+      ASSERT_NEAR((stamp - expected_stamp).toSec(), 0.0, 1e-6) << "batch " << i << ", sample " << j;
+      expected_stamp += period();
+      last_sample = batches[i].samples[j];
+      ++sample_count;
+    }
+  }
+  EXPECT_GE(sample_count, static_cast<std::size_t>(2.0/period().toSec()) - 1);
+
+  // The last sample is the odometry of the last update, the pose in full precision
+  EXPECT_NEAR((expected_stamp - period() - odom.header.stamp).toSec(), 0.0, 1e-6);
+  EXPECT_EQ(last_sample.x, odom.pose.pose.position.x);
+  EXPECT_EQ(last_sample.y, odom.pose.pose.position.y);
+  EXPECT_NEAR(last_sample.heading, tf::getYaw(odom.pose.pose.orientation), 1e-9);
+  EXPECT_NEAR(last_sample.linear_x, odom.twist.twist.linear.x, 1e-6);
+  EXPECT_NEAR(last_sample.angular, odom.twist.twist.angular.z, 1e-6);
 }
 
 int main(int argc, char** argv)
@@ -117,11 +189,8 @@ int main(int argc, char** argv)
   testing::InitGoogleTest(&argc, argv);
   ros::init(argc, argv, "four_wheel_steering_twist_cmd_test");
 
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
-  //ros::Duration(0.5).sleep();
+  // No spinner, the simulated clock delivers the messages between two updates
   int ret = RUN_ALL_TESTS();
-  spinner.stop();
   ros::shutdown();
   return ret;
 }
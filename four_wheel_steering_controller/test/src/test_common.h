@@ -35,11 +35,18 @@
 
 #include <geometry_msgs/Twist.h>
 #include <four_wheel_steering_msgs/FourWheelSteering.h>
+#include <four_wheel_steering_msgs/FourWheelSteeringStamped.h>
+#include <four_wheel_steering_msgs/FourWheelSteeringHorizon.h>
+#include <four_wheel_steering_msgs/OdometrySampleArray.h>
 #include <nav_msgs/Odometry.h>
 #include <tf/tf.h>
 
 #include <std_srvs/Empty.h>
 
+#include <controller_realtime_utils/testing/simulated_clock.h>
+
+#include "four_wheel_steering.h"
+
 // Floating-point value comparison threshold
 const double EPS = 0.01;
 const double POSITION_TOLERANCE = 0.01; // 1 cm-s precision
@@ -48,6 +55,11 @@ const double JERK_LINEAR_VELOCITY_TOLERANCE = 0.10; // 10 cm-s-1 precision
 const double JERK_ANGULAR_VELOCITY_TOLERANCE = 0.05; // 3 deg-s-1 precision
 const double ORIENTATION_TOLERANCE = 0.03; // 0.57 degree precision
 
+/**
+ * Runs the controller in process, on the fake robot and in simulated time.
+ * The controller publishes the odometry of every update on the odom topic,
+ * and every odometry sample in batches on odom_samples.
+ */
 class FourWheelSteeringControllerTest : public ::testing::Test
 {
 public:
@@ -55,18 +67,39 @@ public:
   FourWheelSteeringControllerTest()
   : cmd_twist_pub(nh.advertise<geometry_msgs::Twist>("cmd_vel", 100))
   , cmd_4ws_pub(nh.advertise<four_wheel_steering_msgs::FourWheelSteering>("cmd_four_wheel_steering", 100))
+  , cmd_4ws_stamped_pub(nh.advertise<four_wheel_steering_msgs::FourWheelSteeringStamped>("cmd_four_wheel_steering_stamped", 100))
+  , cmd_horizon_pub(nh.advertise<four_wheel_steering_msgs::FourWheelSteeringHorizon>("cmd_four_wheel_steering_horizon", 100))
   , odom_sub(nh.subscribe("odom", 100, &FourWheelSteeringControllerTest::odomCallback, this))
-  , start_srv(nh.serviceClient<std_srvs::Empty>("start"))
-  , stop_srv(nh.serviceClient<std_srvs::Empty>("stop"))
+  , odom_samples_sub(nh.subscribe("odom_samples", 100, &FourWheelSteeringControllerTest::odomSamplesCallback, this))
   {
+    nh.setParam("four_wheel_steering_controller/publish_rate", 1.0/clock.robot().getPeriod().toSec());
+    nh.setParam("four_wheel_steering_controller/enable_odom_samples", true);
+    clock.startController("four_wheel_steering_controller");
   }
 
   ~FourWheelSteeringControllerTest()
   {
     odom_sub.shutdown();
+    odom_samples_sub.shutdown();
   }
 
-  nav_msgs::Odometry getLastOdom(){ return last_odom; }
+  /// Odometry published for the last update, waits for the publisher thread of the controller
+  nav_msgs::Odometry getLastOdom()
+  {
+    const ros::Time last_update = now() - period();
+    EXPECT_TRUE(clock.waitForMessages([this, last_update]() { return last_odom.header.stamp >= last_update; }))
+      << "No odometry published for the update at " << last_update;
+    return last_odom;
+  }
+  /// Every batch of odometry samples received, waits for the one holding the last update
+  const std::vector<four_wheel_steering_msgs::OdometrySampleArray>& getOdomSamples()
+  {
+    const ros::Time last_update = now() - period();
+    EXPECT_TRUE(clock.waitForMessages([this, last_update]() { return last_sample_stamp >= last_update; }))
+      << "No odometry sample published for the update at " << last_update;
+    return odom_samples;
+  }
+  /// The commands are handled by the next update, at now()
   void publish(geometry_msgs::Twist cmd_vel)
   {
     cmd_twist_pub.publish(cmd_vel);
@@ -75,33 +108,76 @@ public:
   {
     cmd_4ws_pub.publish(cmd_vel);
   }
+  void publish_4ws_stamped(four_wheel_steering_msgs::FourWheelSteeringStamped cmd_vel)
+  {
+    cmd_4ws_stamped_pub.publish(cmd_vel);
+  }
+  void publish_horizon(four_wheel_steering_msgs::FourWheelSteeringHorizon horizon)
+  {
+    cmd_horizon_pub.publish(horizon);
+  }
   bool isControllerAlive(){ return (odom_sub.getNumPublishers() > 0)
         && ((cmd_twist_pub.getNumSubscribers() > 0) || (cmd_4ws_pub.getNumSubscribers() > 0)); }
+  bool isControllerLoaded(){ return clock.controllerManager().getControllerByName("four_wheel_steering_controller") != NULL; }
+  bool startController(){ return clock.startController("four_wheel_steering_controller"); }
+  bool unloadController(){ return clock.unloadController("four_wheel_steering_controller"); }
+
+  template<typename T> void setControllerParam(const std::string& key, const T& value)
+  {
+    nh.setParam("four_wheel_steering_controller/" + key, value);
+  }
+  template<typename T> bool getControllerParam(const std::string& key, T& value)
+  {
+    return nh.getParam("four_wheel_steering_controller/" + key, value);
+  }
+  void deleteControllerParam(const std::string& key){ nh.deleteParam("four_wheel_steering_controller/" + key); }
+
+  /// Runs the control loop for a simulated duration
+  void run(double seconds){ clock.run(ros::Duration(seconds)); }
+  /// Runs one control period
+  void step(){ clock.step(); }
+  /// Runs the control loop until the condition holds, for at most a simulated duration
+  bool runUntil(const boost::function<bool()>& condition, double seconds)
+  {
+    return clock.runUntil(condition, ros::Duration(seconds));
+  }
+  ros::Time now() const { return clock.now(); }
+  ros::Duration period() const { return clock.robot().getPeriod(); }
 
-  void start(){ std_srvs::Empty srv; start_srv.call(srv); }
-  void stop(){ std_srvs::Empty srv; stop_srv.call(srv); }
+  void start(){ std_srvs::Empty srv; clock.robot().start_callback(srv.request, srv.response); }
+  void stop(){ std_srvs::Empty srv; clock.robot().stop_callback(srv.request, srv.response); }
+  void pushWheels(double angle){ clock.robot().pushWheels(angle); }
+  void resetWheels(){ clock.robot().resetWheels(); }
+  double wheelVelocityCommand(unsigned int i) const { return clock.robot().wheelVelocityCommand(i); }
+  double steeringCommand(unsigned int i) const { return clock.robot().steeringCommand(i); }
 
 private:
   ros::NodeHandle nh;
-  ros::Publisher cmd_twist_pub, cmd_4ws_pub;
-  ros::Subscriber odom_sub;
+  ros::Publisher cmd_twist_pub, cmd_4ws_pub, cmd_4ws_stamped_pub, cmd_horizon_pub;
+  ros::Subscriber odom_sub, odom_samples_sub;
   nav_msgs::Odometry last_odom;
-
-  ros::ServiceClient start_srv;
-  ros::ServiceClient stop_srv;
+  std::vector<four_wheel_steering_msgs::OdometrySampleArray> odom_samples;
+  ros::Time last_sample_stamp;
+  SimulatedClock<FourWheelSteering> clock;
 
   void odomCallback(const nav_msgs::Odometry& odom)
   {
-    ROS_INFO_STREAM("Callback reveived: pos.x: " << odom.pose.pose.position.x
+    ROS_DEBUG_STREAM("Callback reveived: pos.x: " << odom.pose.pose.position.x
                      << ", orient.z: " << odom.pose.pose.orientation.z
                      << ", lin_est: " << odom.twist.twist.linear.x
                      << ", ang_est: " << odom.twist.twist.angular.z);
     last_odom = odom;
   }
+
+  void odomSamplesCallback(const four_wheel_steering_msgs::OdometrySampleArray& samples)
+  {
+    odom_samples.push_back(samples);
+    if (!samples.samples.empty())
+      last_sample_stamp = samples.header.stamp + ros::Duration(samples.samples.back().time_offset);
+  }
 };
 
 inline tf::Quaternion tfQuatFromGeomQuat(const geometry_msgs::Quaternion& quat)
 {
   return tf::Quaternion(quat.x, quat.y, quat.z, quat.w);
 }
-
@@ -0,0 +1,33 @@
+#ifndef URDF_VEHICLE_KINEMATIC_URDF_SELECTIVE_PARSER_H
+#define URDF_VEHICLE_KINEMATIC_URDF_SELECTIVE_PARSER_H
+
+#include <string>
+#include <vector>
+
+#include <urdf_parser/urdf_parser.h>
+
+namespace urdf_vehicle_kinematic {
+
+/**
+ * \brief Extract some joints of a URDF, with their ancestors, without building the whole model
+ *        This is a filtered scan, not a streaming one: the whole description is read once
+ *        as a flat sequence of tags, without building a DOM. Only the name, type, origin,
+ *        axis, parent, child and limits of the top level joints and the first collision
+ *        cylinder of the top level links are kept, visuals, meshes, sensors and plugins are
+ *        skipped. The scan does not stop once the requested joints are found: a parent joint
+ *        may be declared later, and a later error would make urdfdom reject the description.
+ *        The returned model holds the requested joints, the joints and links up to the root,
+ *        and the child links of the requested joints.
+ * \param xml         Robot description
+ * \param joint_names Joints to extract
+ * \return Partial model, NULL if a joint is missing or the description holds something the
+ *         scan does not handle (unexpanded xacro, document type declaration, unknown entity,
+ *         nested or duplicate joint, malformed tag...): parse
+ *         it in full with urdf::parseURDF then
+ */
+boost::shared_ptr<urdf::ModelInterface> parseURDFJoints(const std::string& xml,
+                                                        const std::vector<std::string>& joint_names);
+
+}
+
+#endif
@@ -1,19 +1,69 @@
 #ifndef URDF_VEHICLE_KINEMATIC_H
 #define URDF_VEHICLE_KINEMATIC_H
 
+#include <unordered_map>
+#include <vector>
+
 #include <ros/ros.h>
 
 #include <urdf_parser/urdf_parser.h>
 
 namespace urdf_vehicle_kinematic {
 
+/// Geometry of a joint, relative to a base link
+struct JointGeometry
+{
+  /// Pose of the joint frame in the base link
+  urdf::Pose pose;
+  /// Name of the parent link
+  std::string parent_link;
+  /// Radius of the child link if it is modeled as a cylinder, NaN otherwise [m]
+  double wheel_radius;
+  /// Smallest absolute position limit if the joint is revolute, NaN otherwise [rad]
+  double steering_limit;
+};
+
+/// Geometry of the links and joints relative to a base link, by name
+struct GeometryIndex
+{
+  /// Whether it was built from the whole description, or only holds some joints and their ancestors
+  bool complete;
+  std::unordered_map<std::string, urdf::Pose> link_poses;
+  /// Parent link of each link below the base link
+  std::unordered_map<std::string, std::string> link_parents;
+  std::unordered_map<std::string, JointGeometry> joints;
+};
+
 class UrdfVehicleKinematic {
 
 public:
-  UrdfVehicleKinematic(ros::NodeHandle& root_nh, const std::string &base_link);
+  /**
+   * \brief Constructor, gets the parsed robot_description and its geometry index
+   *        from a process-wide cache keyed by a hash of the description, parsing
+   *        it only when no other instance holds it (thread safe, the parsing is done
+   *        without holding the cache lock). The cache keeps the model and index after
+   *        the instances using them are gone, so that the controllers loaded or restarted
+   *        later reuse them, until another description is used (see clearCache).
+   * \param root_nh    Node handle to read robot_description from
+   * \param base_link  Link the geometry is expressed in
+   * \param cache_file Binary file keeping the geometry across runs, keyed by the hash of
+   *                   the description, the base link and the joint names: when they match,
+   *                   robot_description is not parsed at all. Rewritten otherwise. When joint
+   *                   names are given, the file name is suffixed with a hash of them, so that
+   *                   instances asking for other joints keep their own file. Empty to disable.
+   * \param joint_names Joints the geometry will be asked for. When given, only they and
+   *                    their ancestors are extracted from the description by a filtered
+   *                    scan (see parseURDFJoints), it is parsed in full if the scan fails.
+   *                    Empty to parse it in full.
+   */
+  UrdfVehicleKinematic(ros::NodeHandle& root_nh, const std::string &base_link,
+                       const std::string& cache_file = "",
+                       const std::vector<std::string>& joint_names = std::vector<std::string>());
 
   /**
    * \brief Get transform vector between the joint and parent_link
+   *        Looked up in the geometry index, parent_link has to be an ancestor of the joint,
+   *        base_link or one of its descendants
    * \param [in] joint_name   Child joint_name from where to begin
    * \param [in] parent_link_name Name of link to find as parent of the joint
    * \param [out] transform_vector Distance vector between joint and parent_link [m]
@@ -49,10 +99,26 @@ public:
    */
   bool getJointSteeringLimits(const std::string& joint_name,
                               double& steering_limit);
+  /// Parsed robot description, shared with the other instances built from the same description.
+  /// Partial when the joints were extracted, NULL when the geometry was loaded from a cache file.
+  boost::shared_ptr<const urdf::ModelInterface> model() const;
+
+  /// Geometry index, shared with the other instances built from the same description
+  boost::shared_ptr<const GeometryIndex> geometryIndex() const;
+
+  /// Frees the cached descriptions, the instances keep the model and index they use
+  static void clearCache();
+
 private:
+  /// Geometry of a joint of the index, NULL (and an error logged) if it is not there
+  const JointGeometry* findJoint(const std::string& joint_name) const;
+
   std::string base_link_;
 
-  boost::shared_ptr<urdf::ModelInterface> model_;
+  /// Shared with the other instances built from the same description, read only.
+  /// Partial when the joints were extracted, NULL when the geometry was loaded from a cache.
+  boost::shared_ptr<const urdf::ModelInterface> model_;
+  boost::shared_ptr<const GeometryIndex> index_;
 };
 
 }
@@ -0,0 +1,429 @@
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <urdf_vehicle_kinematic/urdf_selective_parser.h>
+
+/*
+ * \brief Pull tokenizer over the text of an XML document
+ *        Yields the start and end tags with their attributes, skips text, comments, CDATA
+ *        sections and processing instructions. No tree is built. A document type declaration
+ *        is an error, its internal subset may declare entities that expand to tags.
+ */
+class XmlTagReader
+{
+public:
+  enum Tag { START, EMPTY, END, DONE, ERROR };
+
+  explicit XmlTagReader(const std::string& xml):
+    xml_(xml), position_(0)
+  {
+  }
+
+  /// Next tag, its name and attributes are then available until the following call
+  Tag next()
+  {
+    while (true)
+    {
+      const std::size_t begin = xml_.find('<', position_);
+      if (begin == std::string::npos)
+        return DONE;
+
+      if (xml_.compare(begin, 4, "<!--") == 0)
+      {
+        if (!skipPast(begin + 4, "-->"))
+          return ERROR;
+      }
+      else if (xml_.compare(begin, 9, "<![CDATA[") == 0)
+      {
+        if (!skipPast(begin + 9, "]]>"))
+          return ERROR;
+      }
+      else if (at(begin + 1) == '?')
+      {
+        if (!skipPast(begin + 2, "?>"))
+          return ERROR;
+      }
+      else if (at(begin + 1) == '!')
+        return ERROR;
+      else if (at(begin + 1) == '/')
+      {
+        std::size_t p = begin + 2;
+        if (!readName(p, name_))
+          return ERROR;
+        skipSpaces(p);
+        if (at(p) != '>')
+          return ERROR;
+        position_ = p + 1;
+        return END;
+      }
+      else
+        return readStartTag(begin + 1);
+    }
+  }
+
+  const std::string& name() const { return name_; }
+
+  /// Value of an attribute of the last start tag, false if it has none
+  bool attribute(const char* key, std::string& value) const
+  {
+    for (std::size_t i = 0; i < attributes_.size(); ++i)
+      if (attributes_[i].first == key)
+      {
+        value = attributes_[i].second;
+        return true;
+      }
+    return false;
+  }
+
+private:
+  char at(std::size_t p) const
+  {
+    return p < xml_.size() ? xml_[p] : '\0';
+  }
+
+  bool skipPast(std::size_t p, const char* end)
+  {
+    const std::size_t found = xml_.find(end, p);
+    if (found == std::string::npos)
+      return false;
+    position_ = found + std::strlen(end);
+    return true;
+  }
+
+  void skipSpaces(std::size_t& p) const
+  {
+    while (at(p) == ' ' || at(p) == '\t' || at(p) == '\n' || at(p) == '\r')
+      ++p;
+  }
+
+  bool readName(std::size_t& p, std::string& name) const
+  {
+    const std::size_t begin = p;
+    while (at(p) != '\0' && std::strchr(" \t\n\r/>=\"'<", at(p)) == NULL)
+      ++p;
+    name.assign(xml_, begin, p - begin);
+    return p > begin;
+  }
+
+  Tag readStartTag(std::size_t p)
+  {
+    attributes_.clear();
+    if (!readName(p, name_))
+      return ERROR;
+
+    while (true)
+    {
+      skipSpaces(p);
+      if (at(p) == '>')
+      {
+        position_ = p + 1;
+        return START;
+      }
+      if (at(p) == '/' && at(p + 1) == '>')
+      {
+        position_ = p + 2;
+        return EMPTY;
+      }
+
+      std::pair<std::string, std::string> attribute;
+      if (!readName(p, attribute.first))
+        return ERROR;
+      skipSpaces(p);
+      if (at(p) != '=')
+        return ERROR;
+      ++p;
+      skipSpaces(p);
+      const char quote = at(p);
+      if (quote != '"' && quote != '\'')
+        return ERROR;
+      const std::size_t end = xml_.find(quote, p + 1);
+      if (end == std::string::npos || !decode(xml_.substr(p + 1, end - p - 1), attribute.second))
+        return ERROR;
+      attributes_.push_back(attribute);
+      p = end + 1;
+    }
+  }
+
+  /// Replaces the predefined entities, false on any other one
+  static bool decode(const std::string& text, std::string& value)
+  {
+    static const char* entities[][2] = {{"&lt;", "<"}, {"&gt;", ">"}, {"&amp;", "&"},
+                                        {"&quot;", "\""}, {"&apos;", "'"}};
+    value.clear();
+    for (std::size_t p = 0; p < text.size();)
+    {
+      if (text[p] != '&')
+      {
+        value += text[p++];
+        continue;
+      }
+      std::size_t e = 0;
+      while (e < 5 && text.compare(p, std::strlen(entities[e][0]), entities[e][0]) != 0)
+        ++e;
+      if (e == 5)
+        return false;
+      value += entities[e][1];
+      p += std::strlen(entities[e][0]);
+    }
+    return true;
+  }
+
+  const std::string& xml_;
+  std::size_t position_;
+  std::string name_;
+  std::vector<std::pair<std::string, std::string> > attributes_;
+};
+
+/*
+ * \brief Parse numbers separated by spaces, independently of the locale
+ * \param [in]  text   Text, e.g. "0 0.5 1"
+ * \param [out] values Numbers
+ * \return false if the text does not hold exactly N numbers
+ */
+template<std::size_t N>
+static bool parseNumbers(const std::string& text, double (&values)[N])
+{
+  std::istringstream stream(text);
+  stream.imbue(std::locale::classic());
+  for (std::size_t i = 0; i < N; ++i)
+    if (!(stream >> values[i]))
+      return false;
+  stream >> std::ws;
+  return stream.eof();
+}
+
+/*
+ * \brief Parse a numeric attribute of the last start tag
+ * \param required Whether urdfdom rejects the tag without this attribute
+ * \return false if the attribute is not a number, or is required and missing
+ */
+static bool parseAttribute(const XmlTagReader& reader, const char* key, double& value, bool required = false)
+{
+  std::string text;
+  if (!reader.attribute(key, text))
+    return !required;
+  double values[1];
+  if (!parseNumbers(text, values))
+    return false;
+  value = values[0];
+  return true;
+}
+
+/// Set the type of a joint from its URDF name, false if it is not one
+static bool setJointType(const std::string& type, urdf::Joint& joint)
+{
+  if (type == "revolute")
+    joint.type = urdf::Joint::REVOLUTE;
+  else if (type == "continuous")
+    joint.type = urdf::Joint::CONTINUOUS;
+  else if (type == "prismatic")
+    joint.type = urdf::Joint::PRISMATIC;
+  else if (type == "floating")
+    joint.type = urdf::Joint::FLOATING;
+  else if (type == "planar")
+    joint.type = urdf::Joint::PLANAR;
+  else if (type == "fixed")
+    joint.type = urdf::Joint::FIXED;
+  else
+    return false;
+  return true;
+}
+
+namespace urdf_vehicle_kinematic {
+
+boost::shared_ptr<urdf::ModelInterface> parseURDFJoints(const std::string& xml,
+                                                        const std::vector<std::string>& joint_names)
+{
+  const boost::shared_ptr<urdf::ModelInterface> none;
+  boost::shared_ptr<urdf::ModelInterface> model(new urdf::ModelInterface);
+
+  // Every joint is kept, it is small, by child link name to walk up the tree.
+  // Links only leave their name and the radius of their first collision cylinder.
+  std::unordered_map<std::string, boost::shared_ptr<urdf::Joint> > joints_by_child;
+  std::unordered_map<std::string, boost::shared_ptr<urdf::Joint> > joints_by_name;
+  std::unordered_map<std::string, double> cylinder_radii;
+  std::unordered_set<std::string> link_names;
+
+  XmlTagReader reader(xml);
+  std::vector<std::string> path;
+  boost::shared_ptr<urdf::Joint> joint;
+  std::string link_name;
+  int link_collisions = 0;
+  int geometry_shapes = 0;
+  bool has_axis = false;
+
+  for (XmlTagReader::Tag tag = reader.next(); tag != XmlTagReader::DONE; tag = reader.next())
+  {
+    if (tag == XmlTagReader::ERROR)
+      return none;
+
+    if (tag == XmlTagReader::END)
+    {
+      if (path.empty() || path.back() != reader.name())
+        return none;
+      path.pop_back();
+      if (path.size() == 1 && joint)
+      {
+        if (joint->parent_link_name.empty() || joint->child_link_name.empty()
+            || joints_by_name.count(joint->name) || joints_by_child.count(joint->child_link_name))
+          return none;
+        // urdfdom rejects these joints without limits, let it tell why
+        if (!joint->limits && (joint->type == urdf::Joint::REVOLUTE || joint->type == urdf::Joint::PRISMATIC))
+          return none;
+        // Default axis of urdfdom, the fixed and floating joints have none
+        if (!has_axis && joint->type != urdf::Joint::FIXED && joint->type != urdf::Joint::FLOATING)
+          joint->axis = urdf::Vector3(1.0, 0.0, 0.0);
+        joints_by_child[joint->child_link_name] = joint;
+        joints_by_name[joint->name] = joint;
+        joint.reset();
+      }
+      continue;
+    }
+
+    const std::string& name = reader.name();
+    const std::size_t depth = path.size();
+    // Unexpanded xacro, the description is not a URDF yet
+    if (name.compare(0, 6, "xacro:") == 0)
+      return none;
+    // Joints or links nested in a joint or a link are not what urdfdom sees
+    if (depth == 2 && (path[1] == "joint" || path[1] == "link") && (name == "joint" || name == "link"))
+      return none;
+
+    if (depth == 0)
+    {
+      if (name != "robot")
+        return none;
+      reader.attribute("name", model->name_);
+    }
+    else if (depth == 1)
+    {
+      if (name == "joint")
+      {
+        joint.reset(new urdf::Joint());
+        joint->parent_to_joint_origin_transform.clear();
+        has_axis = false;
+        std::string type;
+        if (!reader.attribute("name", joint->name) || !reader.attribute("type", type)
+            || !setJointType(type, *joint) || tag == XmlTagReader::EMPTY)
+          return none;
+      }
+      else if (name == "link")
+      {
+        if (!reader.attribute("name", link_name) || !link_names.insert(link_name).second)
+          return none;
+        link_collisions = 0;
+      }
+    }
+    else if (joint && depth == 2)
+    {
+      if (name == "origin")
+      {
+        std::string text;
+        double xyz[3] = {0.0, 0.0, 0.0};
+        double rpy[3] = {0.0, 0.0, 0.0};
+        if ((reader.attribute("xyz", text) && !parseNumbers(text, xyz))
+            || (reader.attribute("rpy", text) && !parseNumbers(text, rpy)))
+          return none;
+        urdf::Pose& origin = joint->parent_to_joint_origin_transform;
+        origin.position = urdf::Vector3(xyz[0], xyz[1], xyz[2]);
+        origin.rotation.setFromRPY(rpy[0], rpy[1], rpy[2]);
+      }
+      else if (name == "parent")
+        reader.attribute("link", joint->parent_link_name);
+      else if (name == "child")
+        reader.attribute("link", joint->child_link_name);
+      else if (name == "axis" && joint->type != urdf::Joint::FIXED && joint->type != urdf::Joint::FLOATING)
+      {
+        std::string text;
+        double xyz[3] = {0.0, 0.0, 0.0};
+        if (reader.attribute("xyz", text) && !parseNumbers(text, xyz))
+          return none;
+        joint->axis = urdf::Vector3(xyz[0], xyz[1], xyz[2]);
+        has_axis = true;
+      }
+      else if (name == "limit")
+      {
+        joint->limits.reset(new urdf::JointLimits());
+        if (!parseAttribute(reader, "lower", joint->limits->lower)
+            || !parseAttribute(reader, "upper", joint->limits->upper)
+            || !parseAttribute(reader, "effort", joint->limits->effort, true)
+            || !parseAttribute(reader, "velocity", joint->limits->velocity, true))
+          return none;
+      }
+    }
+    else if (depth == 2 && path[1] == "link" && name == "collision")
+    {
+      ++link_collisions;
+      geometry_shapes = 0;
+    }
+    // Only the first shape of the first collision of a link is looked at, as urdf::Link::collision
+    else if (depth == 4 && path[1] == "link" && path[2] == "collision" && path[3] == "geometry"
+             && link_collisions == 1 && geometry_shapes++ == 0 && name == "cylinder")
+    {
+      double radius = 0.0, length = 0.0;
+      if (!parseAttribute(reader, "radius", radius, true) || !parseAttribute(reader, "length", length, true))
+        return none;
+      cylinder_radii[link_name] = radius;
+    }
+
+    if (tag == XmlTagReader::START)
+      path.push_back(name);
+  }
+  if (!path.empty())
+    return none;
+
+  // Requested joints and everything up to the root
+  std::unordered_set<std::string> kept_links;
+  for (std::size_t i = 0; i < joint_names.size(); ++i)
+  {
+    std::unordered_map<std::string, boost::shared_ptr<urdf::Joint> >::const_iterator found =
+        joints_by_name.find(joint_names[i]);
+    if (found == joints_by_name.end() || !link_names.count(found->second->child_link_name))
+      return none;
+    kept_links.insert(found->second->child_link_name);
+
+    boost::shared_ptr<urdf::Joint> ancestor = found->second;
+    while (ancestor && !model->joints_.count(ancestor->name))
+    {
+      if (!link_names.count(ancestor->parent_link_name))
+        return none;
+      model->joints_[ancestor->name] = ancestor;
+      kept_links.insert(ancestor->parent_link_name);
+      found = joints_by_child.find(ancestor->parent_link_name);
+      ancestor = found == joints_by_child.end() ? boost::shared_ptr<urdf::Joint>() : found->second;
+    }
+  }
+
+  for (std::unordered_set<std::string>::const_iterator it = kept_links.begin(); it != kept_links.end(); ++it)
+  {
+    boost::shared_ptr<urdf::Link> link(new urdf::Link());
+    link->name = *it;
+    std::unordered_map<std::string, double>::const_iterator radius = cylinder_radii.find(*it);
+    if (radius != cylinder_radii.end())
+    {
+      boost::shared_ptr<urdf::Cylinder> cylinder(new urdf::Cylinder());
+      cylinder->type = urdf::Geometry::CYLINDER;
+      cylinder->radius = radius->second;
+      link->collision.reset(new urdf::Collision());
+      link->collision->geometry = cylinder;
+    }
+    model->links_[*it] = link;
+  }
+
+  for (std::map<std::string, boost::shared_ptr<urdf::Joint> >::const_iterator it = model->joints_.begin();
+       it != model->joints_.end(); ++it)
+  {
+    const boost::shared_ptr<urdf::Link>& parent = model->links_[it->second->parent_link_name];
+    const boost::shared_ptr<urdf::Link>& child = model->links_[it->second->child_link_name];
+    child->parent_joint = it->second;
+    parent->child_joints.push_back(it->second);
+    parent->child_links.push_back(child);
+  }
+  return model;
+}
+
+}
@@ -1,4 +1,20 @@
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <urdf_vehicle_kinematic/urdf_selective_parser.h>
 #include <urdf_vehicle_kinematic/urdf_vehicle_kinematic.h>
 
 static double euclideanOfVectors(const urdf::Vector3& vec1, const urdf::Vector3& vec2)
@@ -8,6 +24,23 @@ static double euclideanOfVectors(const urdf::Vector3& vec1, const urdf::Vector3&
                    std::pow(vec1.z-vec2.z,2));
 }
 
+/*
+ * \brief Compose two poses
+ * \param parent Pose of a frame B in a frame A
+ * \param child  Pose of a frame C in the frame B
+ * \return Pose of the frame C in the frame A
+ */
+static urdf::Pose composePoses(const urdf::Pose& parent, const urdf::Pose& child)
+{
+  const urdf::Vector3 offset = parent.rotation*child.position;
+  urdf::Pose pose;
+  pose.position = urdf::Vector3(parent.position.x + offset.x,
+                                parent.position.y + offset.y,
+                                parent.position.z + offset.z);
+  pose.rotation = parent.rotation*child.rotation;
+  return pose;
+}
+
 /*
  * \brief Check if the link is modeled as a cylinder
  * \param link Link
@@ -60,8 +93,408 @@ static bool getWheelRadius(const boost::shared_ptr<const urdf::Link>& wheel_link
   return true;
 }
 
+/*
+ * \brief Get the radius of a link modeled as a cylinder, without complaining about the other links
+ * \param link Link
+ * \return Radius [m], NaN if the link is not modeled as a cylinder
+ */
+static double cylinderRadius(const boost::shared_ptr<const urdf::Link>& link)
+{
+  if (!link || !link->collision || !link->collision->geometry
+      || link->collision->geometry->type != urdf::Geometry::CYLINDER)
+    return std::numeric_limits<double>::quiet_NaN();
+  return (static_cast<const urdf::Cylinder*>(link->collision->geometry.get()))->radius;
+}
+
+/*
+ * \brief Get the smallest absolute position limit of a revolute joint
+ * \param joint Joint
+ * \return Limit [rad], NaN if the joint is not revolute
+ */
+static double steeringLimit(const urdf::Joint& joint)
+{
+  if (joint.type != urdf::Joint::REVOLUTE || !joint.limits)
+    return std::numeric_limits<double>::quiet_NaN();
+  return std::min(std::fabs(joint.limits->lower), std::fabs(joint.limits->upper));
+}
+
+/*
+ * \brief 64 bits FNV-1a hash, stable across builds and runs unlike std::hash,
+ *        so it can key the geometry cache file, name it and check it
+ */
+static uint64_t fnv1aHash(const std::string& data)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (std::size_t i = 0; i < data.size(); ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// Identifies a geometry cache file, changes with the layout:
+static const uint64_t GEOMETRY_CACHE_MAGIC = 0x55564b47454f0004ULL;
+/// Bound on the counts and name sizes read from a cache file, against corrupted files:
+static const uint64_t GEOMETRY_CACHE_MAX_SIZE = 1 << 20;
+
+static void write(std::ostream& out, uint64_t value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void write(std::ostream& out, double value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void write(std::ostream& out, const std::string& value)
+{
+  write(out, static_cast<uint64_t>(value.size()));
+  out.write(value.data(), value.size());
+}
+
+static void write(std::ostream& out, const urdf::Pose& pose)
+{
+  write(out, pose.position.x);
+  write(out, pose.position.y);
+  write(out, pose.position.z);
+  write(out, pose.rotation.x);
+  write(out, pose.rotation.y);
+  write(out, pose.rotation.z);
+  write(out, pose.rotation.w);
+}
+
+static bool read(std::istream& in, uint64_t& value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+static bool read(std::istream& in, double& value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+static bool read(std::istream& in, std::string& value)
+{
+  uint64_t size;
+  if (!read(in, size) || size > GEOMETRY_CACHE_MAX_SIZE)
+    return false;
+  value.resize(size);
+  return size == 0 || static_cast<bool>(in.read(&value[0], size));
+}
+
+static void write(std::ostream& out, const std::vector<std::string>& values)
+{
+  write(out, static_cast<uint64_t>(values.size()));
+  for (std::size_t i = 0; i < values.size(); ++i)
+    write(out, values[i]);
+}
+
+static bool read(std::istream& in, std::vector<std::string>& values)
+{
+  uint64_t size;
+  if (!read(in, size) || size > GEOMETRY_CACHE_MAX_SIZE)
+    return false;
+  values.resize(size);
+  for (std::size_t i = 0; i < values.size(); ++i)
+    if (!read(in, values[i]))
+      return false;
+  return true;
+}
+
+static bool read(std::istream& in, urdf::Pose& pose)
+{
+  return read(in, pose.position.x) && read(in, pose.position.y) && read(in, pose.position.z)
+      && read(in, pose.rotation.x) && read(in, pose.rotation.y) && read(in, pose.rotation.z)
+      && read(in, pose.rotation.w);
+}
+
 namespace urdf_vehicle_kinematic{
-  UrdfVehicleKinematic::UrdfVehicleKinematic(ros::NodeHandle& root_nh, const std::string& base_link):
+  /*
+   * \brief Compute the geometry in base_link of every link and joint below it,
+   *        composing the joint origins along the tree (rotations included)
+   * \param model     Parsed robot description
+   * \param base_link Link the poses are expressed in
+   * \param complete  Whether the model holds the whole description
+   * \return Geometry index, empty if base_link is not in the model
+   */
+  static boost::shared_ptr<const GeometryIndex> buildGeometryIndex(const urdf::ModelInterface& model,
+                                                                   const std::string& base_link_name,
+                                                                   bool complete)
+  {
+    boost::shared_ptr<GeometryIndex> index(new GeometryIndex);
+    index->complete = complete;
+
+    boost::shared_ptr<const urdf::Link> base_link(model.getLink(base_link_name));
+    if (!base_link)
+    {
+      ROS_ERROR_STREAM(base_link_name << " couldn't be retrieved from model description");
+      return index;
+    }
+
+    // Depth first walk of the tree below base_link, each link and joint is visited once
+    urdf::Pose identity;
+    identity.clear();
+    index->link_poses[base_link_name] = identity;
+    std::vector<boost::shared_ptr<const urdf::Link> > stack(1, base_link);
+    while (!stack.empty())
+    {
+      boost::shared_ptr<const urdf::Link> link = stack.back();
+      stack.pop_back();
+      const urdf::Pose link_pose = index->link_poses[link->name];
+
+      for (std::size_t i = 0; i < link->child_joints.size(); ++i)
+      {
+        const urdf::Joint& joint = *link->child_joints[i];
+        JointGeometry& geometry = index->joints[joint.name];
+        geometry.pose = composePoses(link_pose, joint.parent_to_joint_origin_transform);
+        geometry.parent_link = link->name;
+        geometry.wheel_radius = cylinderRadius(model.getLink(joint.child_link_name));
+        geometry.steering_limit = steeringLimit(joint);
+        // The child link frame is the joint frame at zero joint position
+        index->link_poses[joint.child_link_name] = geometry.pose;
+        index->link_parents[joint.child_link_name] = link->name;
+      }
+      stack.insert(stack.end(), link->child_links.begin(), link->child_links.end());
+    }
+    return index;
+  }
+
+  /*
+   * \brief Load a geometry index from a cache file
+   * \param path      Path of the cache file
+   * \param hash      Hash of the robot description
+   * \param size      Size of the robot description, guards against hash collisions
+   * \param base_link Link the poses are expressed in
+   * \param joint_names Sorted names of the joints asked for
+   * \return Geometry index, NULL if the file is missing, invalid or was built from another description
+   */
+  static boost::shared_ptr<const GeometryIndex> loadGeometryIndex(const std::string& path, uint64_t hash,
+                                                                  uint64_t size, const std::string& base_link,
+                                                                  const std::vector<std::string>& joint_names)
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+      return boost::shared_ptr<const GeometryIndex>();
+
+    uint64_t magic, file_hash, file_size;
+    std::string file_base_link;
+    std::vector<std::string> file_joint_names;
+    if (!read(in, magic) || magic != GEOMETRY_CACHE_MAGIC || !read(in, file_hash) || file_hash != hash
+        || !read(in, file_size) || file_size != size || !read(in, file_base_link) || file_base_link != base_link
+        || !read(in, file_joint_names) || file_joint_names != joint_names)
+    {
+      ROS_INFO_STREAM("Geometry cache " << path << " does not match the robot description");
+      return boost::shared_ptr<const GeometryIndex>();
+    }
+
+    // The index is followed by its checksum
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    uint64_t checksum = 0;
+    bool valid = data.size() >= sizeof(checksum);
+    if (valid)
+    {
+      std::memcpy(&checksum, &data[data.size() - sizeof(checksum)], sizeof(checksum));
+      data.resize(data.size() - sizeof(checksum));
+      valid = checksum == fnv1aHash(data);
+    }
+
+    std::istringstream body(data);
+    boost::shared_ptr<GeometryIndex> index(new GeometryIndex);
+    uint64_t count = 0, complete = 0;
+    valid = valid && read(body, complete) && read(body, count) && count <= GEOMETRY_CACHE_MAX_SIZE;
+    index->complete = complete != 0;
+    for (uint64_t i = 0; valid && i < count; ++i)
+    {
+      std::string name;
+      valid = read(body, name) && read(body, index->link_poses[name]);
+    }
+    valid = valid && read(body, count) && count <= GEOMETRY_CACHE_MAX_SIZE;
+    for (uint64_t i = 0; valid && i < count; ++i)
+    {
+      std::string name;
+      valid = read(body, name) && read(body, index->link_parents[name]);
+    }
+    valid = valid && read(body, count) && count <= GEOMETRY_CACHE_MAX_SIZE;
+    for (uint64_t i = 0; valid && i < count; ++i)
+    {
+      std::string name;
+      valid = read(body, name);
+      JointGeometry& geometry = index->joints[name];
+      valid = valid && read(body, geometry.pose) && read(body, geometry.parent_link)
+          && read(body, geometry.wheel_radius) && read(body, geometry.steering_limit);
+    }
+    valid = valid && body.peek() == std::char_traits<char>::eof();
+    if (!valid)
+    {
+      ROS_WARN_STREAM("Geometry cache " << path << " is truncated or corrupted, it is rebuilt");
+      return boost::shared_ptr<const GeometryIndex>();
+    }
+    return index;
+  }
+
+  /*
+   * \brief Save a geometry index to a cache file, written aside and renamed
+   *        so that a concurrent reader never sees it half written
+   * \param path      Path of the cache file
+   * \param hash      Hash of the robot description
+   * \param size      Size of the robot description
+   * \param base_link Link the poses are expressed in
+   * \param joint_names Sorted names of the joints asked for
+   * \param index     Geometry index
+   */
+  static void saveGeometryIndex(const std::string& path, uint64_t hash, uint64_t size,
+                                const std::string& base_link, const std::vector<std::string>& joint_names,
+                                const GeometryIndex& index)
+  {
+    const std::string temporary_path = path + ".tmp";
+    std::ofstream out(temporary_path.c_str(), std::ios::binary | std::ios::trunc);
+    write(out, GEOMETRY_CACHE_MAGIC);
+    write(out, hash);
+    write(out, size);
+    write(out, base_link);
+    write(out, joint_names);
+
+    std::ostringstream body;
+    write(body, static_cast<uint64_t>(index.complete));
+    write(body, static_cast<uint64_t>(index.link_poses.size()));
+    for (std::unordered_map<std::string, urdf::Pose>::const_iterator it = index.link_poses.begin();
+         it != index.link_poses.end(); ++it)
+    {
+      write(body, it->first);
+      write(body, it->second);
+    }
+
+    write(body, static_cast<uint64_t>(index.link_parents.size()));
+    for (std::unordered_map<std::string, std::string>::const_iterator it = index.link_parents.begin();
+         it != index.link_parents.end(); ++it)
+    {
+      write(body, it->first);
+      write(body, it->second);
+    }
+
+    write(body, static_cast<uint64_t>(index.joints.size()));
+    for (std::unordered_map<std::string, JointGeometry>::const_iterator it = index.joints.begin();
+         it != index.joints.end(); ++it)
+    {
+      write(body, it->first);
+      write(body, it->second.pose);
+      write(body, it->second.parent_link);
+      write(body, it->second.wheel_radius);
+      write(body, it->second.steering_limit);
+    }
+
+    const std::string data = body.str();
+    out.write(data.data(), data.size());
+    write(out, fnv1aHash(data));
+
+    out.close();
+    if (!out || std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+      ROS_WARN_STREAM("Could not write geometry cache " << path);
+      std::remove(temporary_path.c_str());
+    }
+  }
+
+  /*
+   * \brief Path of the geometry cache file of a set of joints
+   * \param cache_file  Path given by the user
+   * \param joint_names Sorted names of the joints asked for
+   * \return cache_file if no joint is given, suffixed with the hash of the names otherwise
+   */
+  static std::string geometryCachePath(const std::string& cache_file, const std::vector<std::string>& joint_names)
+  {
+    if (joint_names.empty())
+      return cache_file;
+    std::string names;
+    for (std::size_t i = 0; i < joint_names.size(); ++i)
+      names.append(joint_names[i]).push_back('\0');
+    char suffix[18];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx", static_cast<unsigned long long>(fnv1aHash(names)));
+    return cache_file + suffix;
+  }
+
+  /// Whether a geometry index holds the joints, all of them if none is given
+  static bool covers(const GeometryIndex& index, const std::vector<std::string>& joint_names)
+  {
+    if (index.complete)
+      return true;
+    for (std::size_t i = 0; i < joint_names.size(); ++i)
+      if (!index.joints.count(joint_names[i]))
+        return false;
+    return !joint_names.empty();
+  }
+
+  /*
+   * \brief Parsed model and geometry indices of a robot description, by base link
+   *        They are kept after the instances using them are gone, so that controllers loaded
+   *        or restarted later do not parse the description again.
+   */
+  struct CachedDescription
+  {
+    CachedDescription() : size(0) {}
+
+    /// Size of the description, guards against hash collisions
+    uint64_t size;
+    /// Complete model, expired while every index was loaded from cache files or extracted selectively
+    boost::shared_ptr<const urdf::ModelInterface> model;
+    std::map<std::string, boost::shared_ptr<const GeometryIndex> > indices;
+  };
+
+  /// Process-wide cache of the robot descriptions, by hash. Only accessed under cache_mutex,
+  /// which is never held while parsing.
+  static boost::mutex cache_mutex;
+  static std::unordered_map<uint64_t, CachedDescription> cache;
+
+  /// Whether no instance uses the model and indices of a cached description
+  static bool unused(const CachedDescription& cached)
+  {
+    if (cached.model && !cached.model.unique())
+      return false;
+    for (std::map<std::string, boost::shared_ptr<const GeometryIndex> >::const_iterator index =
+           cached.indices.begin(); index != cached.indices.end(); ++index)
+      if (!index->second.unique())
+        return false;
+    return true;
+  }
+
+  /// Forget the descriptions other than the current one that no instance uses anymore
+  /// (under cache_mutex): the cache holds one description, unless several are in use
+  static void evictUnused(uint64_t current_hash)
+  {
+    std::unordered_map<uint64_t, CachedDescription>::iterator it = cache.begin();
+    while (it != cache.end())
+    {
+      if (it->first != current_hash && unused(it->second))
+        it = cache.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  /*
+   * \brief Cached model and index of a description (under cache_mutex)
+   * \param [out] model Complete model, NULL if it is not cached
+   * \param [out] index Geometry index in base_link, NULL if it is not cached
+   */
+  static void findCached(uint64_t hash, uint64_t size, const std::string& base_link,
+                         boost::shared_ptr<const urdf::ModelInterface>& model,
+                         boost::shared_ptr<const GeometryIndex>& index)
+  {
+    std::unordered_map<uint64_t, CachedDescription>::const_iterator cached = cache.find(hash);
+    if (cached == cache.end() || cached->second.size != size)
+      return;
+    model = cached->second.model;
+    std::map<std::string, boost::shared_ptr<const GeometryIndex> >::const_iterator found =
+        cached->second.indices.find(base_link);
+    if (found != cached->second.indices.end())
+      index = found->second;
+  }
+
+  UrdfVehicleKinematic::UrdfVehicleKinematic(ros::NodeHandle& root_nh, const std::string& base_link,
+                                             const std::string& cache_file,
+                                             const std::vector<std::string>& joint_names):
     base_link_(base_link)
   {
     // Parse robot description
@@ -71,41 +504,154 @@ namespace urdf_vehicle_kinematic{
     if (!res || !root_nh.getParam(model_param_name,robot_model_str))
     {
       ROS_ERROR("Robot descripion couldn't be retrieved from param server.");
+      return;
     }
-    else
+
+    const uint64_t hash = fnv1aHash(robot_model_str);
+    const uint64_t size = robot_model_str.size();
+    boost::shared_ptr<const urdf::ModelInterface> model;
+    boost::shared_ptr<const GeometryIndex> index;
+    {
+      boost::lock_guard<boost::mutex> lock(cache_mutex);
+      evictUnused(hash);
+      findCached(hash, size, base_link_, model, index);
+    }
+    model_ = model;
+    if (index && covers(*index, joint_names))
+    {
+      ROS_DEBUG_STREAM("Reusing the vehicle geometry of "<<model_param_name);
+      index_ = index;
+      return;
+    }
+
+    // The description is loaded or parsed without the lock, concurrent controllers may
+    // then parse it twice, but they do not wait for each other
+    index.reset();
+    bool loaded = false;
+    std::vector<std::string> sorted_joint_names(joint_names);
+    std::sort(sorted_joint_names.begin(), sorted_joint_names.end());
+    const std::string cache_path = cache_file.empty() ? cache_file : geometryCachePath(cache_file, sorted_joint_names);
+    if (!cache_path.empty())
+    {
+      index = loadGeometryIndex(cache_path, hash, size, base_link_, sorted_joint_names);
+      loaded = index && covers(*index, joint_names);
+      if (loaded)
+        ROS_INFO_STREAM("Vehicle geometry loaded from " << cache_path);
+      else
+        index.reset();
+    }
+
+    if (!index && !model && !joint_names.empty())
     {
-      model_ = urdf::parseURDF(robot_model_str);
-      if(!model_)
-        ROS_ERROR_STREAM("Could not parse the urdf robot model "<<model_param_name);
+      boost::shared_ptr<const urdf::ModelInterface> partial_model = parseURDFJoints(robot_model_str, joint_names);
+      if (partial_model && partial_model->getLink(base_link_))
+      {
+        index = buildGeometryIndex(*partial_model, base_link_, false);
+        if (covers(*index, joint_names))
+          model_ = partial_model;
+        else
+          index.reset();
+      }
+      if (!index)
+        ROS_INFO_STREAM("Could not extract the joints from "<<model_param_name<<", parsing it in full");
+    }
+
+    if (!index)
+    {
+      if (!model)
+      {
+        model = urdf::parseURDF(robot_model_str);
+        if(!model)
+        {
+          ROS_ERROR_STREAM("Could not parse the urdf robot model "<<model_param_name);
+          return;
+        }
+      }
+      model_ = model;
+      index = buildGeometryIndex(*model, base_link_, true);
+    }
+    if (!loaded && !cache_path.empty())
+      saveGeometryIndex(cache_path, hash, size, base_link_, sorted_joint_names, *index);
+
+    // Another instance may have cached the same description meanwhile, share its model and index
+    {
+      boost::lock_guard<boost::mutex> lock(cache_mutex);
+      CachedDescription& cached = cache[hash];
+      if (cached.size != size)
+      {
+        cached = CachedDescription();
+        cached.size = size;
+      }
+      if (model)
+      {
+        if (cached.model)
+          model_ = cached.model;
+        else
+          cached.model = model;
+      }
+      boost::shared_ptr<const GeometryIndex>& cached_index = cached.indices[base_link_];
+      if (cached_index && covers(*cached_index, joint_names))
+        index = cached_index;
+      else
+        cached_index = index;
     }
+    index_ = index;
+  }
+
+  void UrdfVehicleKinematic::clearCache()
+  {
+    boost::lock_guard<boost::mutex> lock(cache_mutex);
+    cache.clear();
+  }
+
+  boost::shared_ptr<const urdf::ModelInterface> UrdfVehicleKinematic::model() const
+  {
+    return model_;
+  }
+
+  boost::shared_ptr<const GeometryIndex> UrdfVehicleKinematic::geometryIndex() const
+  {
+    return index_;
   }
 
   bool UrdfVehicleKinematic::getTransformVector(const std::string& joint_name, const std::string& parent_link_name
                                                 , urdf::Vector3 &transform_vector)
   {
-    if(model_)
+    if(index_)
     {
-      boost::shared_ptr<const urdf::Joint> joint(model_->getJoint(joint_name));
+      const JointGeometry* joint = findJoint(joint_name);
       if (!joint)
-      {
-        ROS_ERROR_STREAM(joint_name
-                               << " couldn't be retrieved from model description");
         return false;
+
+      if (parent_link_name == base_link_)
+      {
+        transform_vector = joint->pose.position;
+        return true;
       }
 
-      transform_vector = joint->parent_to_joint_origin_transform.position;
-      while(joint->parent_link_name != parent_link_name)
+      // Walk up from the joint to parent_link, which has to be one of its ancestors
+      std::string link = joint->parent_link;
+      while (link != parent_link_name)
       {
-        boost::shared_ptr<const urdf::Link> link_parent(model_->getLink(joint->parent_link_name));
-        if (!link_parent || !link_parent->parent_joint)
+        std::unordered_map<std::string, std::string>::const_iterator parent = index_->link_parents.find(link);
+        if (parent == index_->link_parents.end())
         {
-          ROS_ERROR_STREAM(joint->parent_link_name
-                                 << " couldn't be retrieved from model description or his parent joint");
+          ROS_ERROR_STREAM(parent_link_name << " is not a parent of " << joint_name
+                                 << " in the model description below " << base_link_);
           return false;
         }
-        joint = link_parent->parent_joint;
-        transform_vector = transform_vector + joint->parent_to_joint_origin_transform.position;
+        link = parent->second;
       }
+
+      const std::unordered_map<std::string, urdf::Pose>::const_iterator link_pose = index_->link_poses.find(link);
+
+      // Joint position expressed in the parent link frame
+      const urdf::Rotation inverse = link_pose->second.rotation.GetInverse();
+      const urdf::Vector3& link_position = link_pose->second.position;
+      const urdf::Vector3& joint_position = joint->pose.position;
+      transform_vector = inverse*urdf::Vector3(joint_position.x - link_position.x,
+                                               joint_position.y - link_position.y,
+                                               joint_position.z - link_position.z);
       return true;
     }
     else
@@ -134,15 +680,24 @@ namespace urdf_vehicle_kinematic{
   bool UrdfVehicleKinematic::getJointRadius(const std::string& joint_name,
                                             double& radius)
   {
-    if(model_)
+    if(index_)
     {
-      boost::shared_ptr<const urdf::Joint> joint(model_->getJoint(joint_name));
-      // Get wheel radius
-      if (!getWheelRadius(model_->getLink(joint->child_link_name), radius))
+      const JointGeometry* joint = findJoint(joint_name);
+      if (!joint)
+        return false;
+
+      if (!(joint->wheel_radius > 0.0))
       {
+        // Tell what is wrong with the wheel link, when the model was parsed
+        if (model_)
+        {
+          double wheel_radius;
+          getWheelRadius(model_->getLink(model_->getJoint(joint_name)->child_link_name), wheel_radius);
+        }
         ROS_ERROR_STREAM("Couldn't retrieve " << joint_name << " wheel radius");
         return false;
       }
+      radius = joint->wheel_radius;
       return true;
     }
     else
@@ -152,17 +707,15 @@ namespace urdf_vehicle_kinematic{
   bool UrdfVehicleKinematic::getJointSteeringLimits(const std::string& joint_name,
                               double& steering_limit)
   {
-    if(model_)
+    if(index_)
     {
-      boost::shared_ptr<const urdf::Joint> joint(model_->getJoint(joint_name));
-      if(joint->type == urdf::Joint::REVOLUTE)
+      const JointGeometry* joint = findJoint(joint_name);
+      if (!joint)
+        return false;
+
+      if(joint->steering_limit >= 0.0)
       {
-        const double lower_steering_limit = fabs(joint->limits->lower);
-        const double upper_steering_limit = fabs(joint->limits->upper);
-        if(lower_steering_limit > upper_steering_limit)
-          steering_limit = upper_steering_limit;
-        else
-          steering_limit = lower_steering_limit;
+        steering_limit = joint->steering_limit;
         ROS_INFO_STREAM("Joint "<<joint_name<<" steering limit is "<<steering_limit*180.0/M_PI<<" in degrees");
         return true;
       }
@@ -170,4 +723,16 @@ namespace urdf_vehicle_kinematic{
     }
     return false;
   }
+
+  const JointGeometry* UrdfVehicleKinematic::findJoint(const std::string& joint_name) const
+  {
+    std::unordered_map<std::string, JointGeometry>::const_iterator joint = index_->joints.find(joint_name);
+    if (joint == index_->joints.end())
+    {
+      ROS_ERROR_STREAM(joint_name
+                             << " couldn't be retrieved from model description below " << base_link_);
+      return NULL;
+    }
+    return &joint->second;
+  }
 }
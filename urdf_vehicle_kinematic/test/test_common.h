@@ -0,0 +1,17 @@
+#ifndef URDF_VEHICLE_KINEMATIC_TEST_COMMON_H
+#define URDF_VEHICLE_KINEMATIC_TEST_COMMON_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/// Expanded robot description of the test/urdf directory, empty if it is missing
+inline std::string readDescription(const std::string& file_name)
+{
+  std::ifstream file((std::string(TEST_URDF_DIR) + "/" + file_name).c_str());
+  std::ostringstream description;
+  description << file.rdbuf();
+  return description.str();
+}
+
+#endif // URDF_VEHICLE_KINEMATIC_TEST_COMMON_H
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <urdf_vehicle_kinematic/urdf_selective_parser.h>
+
+#include "test_common.h"
+
+using namespace urdf_vehicle_kinematic;
+
+static std::vector<std::string> jointNames(const urdf::ModelInterface& model)
+{
+  std::vector<std::string> names;
+  for (std::map<std::string, boost::shared_ptr<urdf::Joint> >::const_iterator it = model.joints_.begin();
+       it != model.joints_.end(); ++it)
+    names.push_back(it->first);
+  return names;
+}
+
+static double cylinderRadius(const boost::shared_ptr<const urdf::Link>& link)
+{
+  if (!link->collision || !link->collision->geometry || link->collision->geometry->type != urdf::Geometry::CYLINDER)
+    return -1.0;
+  return static_cast<const urdf::Cylinder*>(link->collision->geometry.get())->radius;
+}
+
+static void expectSameVector(const urdf::Vector3& expected, const urdf::Vector3& actual, const std::string& what)
+{
+  EXPECT_DOUBLE_EQ(expected.x, actual.x) << what;
+  EXPECT_DOUBLE_EQ(expected.y, actual.y) << what;
+  EXPECT_DOUBLE_EQ(expected.z, actual.z) << what;
+}
+
+/// Compares every joint of the partial model, and its links, with the ones urdfdom parsed
+static void expectSameJoints(const urdf::ModelInterface& full, const urdf::ModelInterface& partial)
+{
+  for (std::map<std::string, boost::shared_ptr<urdf::Joint> >::const_iterator it = partial.joints_.begin();
+       it != partial.joints_.end(); ++it)
+  {
+    const urdf::Joint& joint = *it->second;
+    boost::shared_ptr<const urdf::Joint> expected = full.getJoint(it->first);
+    ASSERT_TRUE(expected.get() != NULL) << it->first;
+    EXPECT_EQ(expected->type, joint.type) << joint.name;
+    EXPECT_EQ(expected->parent_link_name, joint.parent_link_name) << joint.name;
+    EXPECT_EQ(expected->child_link_name, joint.child_link_name) << joint.name;
+
+    const urdf::Pose& expected_origin = expected->parent_to_joint_origin_transform;
+    const urdf::Pose& origin = joint.parent_to_joint_origin_transform;
+    expectSameVector(expected_origin.position, origin.position, joint.name + " origin xyz");
+    double expected_rpy[3], rpy[3];
+    expected_origin.rotation.getRPY(expected_rpy[0], expected_rpy[1], expected_rpy[2]);
+    origin.rotation.getRPY(rpy[0], rpy[1], rpy[2]);
+    for (int i = 0; i < 3; ++i)
+      EXPECT_DOUBLE_EQ(expected_rpy[i], rpy[i]) << joint.name << " origin rpy";
+    expectSameVector(expected->axis, joint.axis, joint.name + " axis");
+
+    ASSERT_EQ(expected->limits.get() != NULL, joint.limits.get() != NULL) << joint.name;
+    if (joint.limits)
+    {
+      EXPECT_DOUBLE_EQ(expected->limits->lower, joint.limits->lower) << joint.name;
+      EXPECT_DOUBLE_EQ(expected->limits->upper, joint.limits->upper) << joint.name;
+      EXPECT_DOUBLE_EQ(expected->limits->effort, joint.limits->effort) << joint.name;
+      EXPECT_DOUBLE_EQ(expected->limits->velocity, joint.limits->velocity) << joint.name;
+    }
+
+    boost::shared_ptr<const urdf::Link> child = partial.getLink(joint.child_link_name);
+    ASSERT_TRUE(child.get() != NULL) << joint.child_link_name;
+    EXPECT_EQ(cylinderRadius(full.getLink(joint.child_link_name)), cylinderRadius(child)) << joint.child_link_name;
+    ASSERT_TRUE(partial.getLink(joint.parent_link_name).get() != NULL) << joint.parent_link_name;
+  }
+}
+
+static const char* TEST_DESCRIPTIONS[] = {"four_wheel_steering.urdf", "rotated_joints.urdf"};
+
+TEST(UrdfSelectiveParserTest, testSameJointsAsUrdfdom)
+{
+  for (std::size_t d = 0; d < sizeof(TEST_DESCRIPTIONS)/sizeof(TEST_DESCRIPTIONS[0]); ++d)
+  {
+    SCOPED_TRACE(TEST_DESCRIPTIONS[d]);
+    const std::string description = readDescription(TEST_DESCRIPTIONS[d]);
+    boost::shared_ptr<urdf::ModelInterface> full = urdf::parseURDF(description);
+    ASSERT_TRUE(full.get() != NULL);
+
+    // Every joint
+    const std::vector<std::string> joint_names = jointNames(*full);
+    boost::shared_ptr<urdf::ModelInterface> partial = parseURDFJoints(description, joint_names);
+    ASSERT_TRUE(partial.get() != NULL);
+    EXPECT_EQ(joint_names, jointNames(*partial));
+    expectSameJoints(*full, *partial);
+
+    // Each joint alone comes with all its ancestors, and only them
+    for (std::size_t i = 0; i < joint_names.size(); ++i)
+    {
+      partial = parseURDFJoints(description, std::vector<std::string>(1, joint_names[i]));
+      ASSERT_TRUE(partial.get() != NULL) << joint_names[i];
+      expectSameJoints(*full, *partial);
+
+      std::vector<std::string> ancestors;
+      for (boost::shared_ptr<const urdf::Joint> joint = full->getJoint(joint_names[i]); joint;
+           joint = full->getLink(joint->parent_link_name)->parent_joint)
+        ancestors.insert(ancestors.begin(), joint->name);
+      std::sort(ancestors.begin(), ancestors.end());
+      EXPECT_EQ(ancestors, jointNames(*partial)) << joint_names[i];
+    }
+  }
+}
+
+/// Four wheel steering description, with a text inserted before the closing robot tag
+static std::string withTail(const std::string& tail)
+{
+  std::string description = readDescription("four_wheel_steering.urdf");
+  description.insert(description.rfind("</robot>"), tail);
+  return description;
+}
+
+static bool extracted(const std::string& description, const std::string& joint_name = "front_left_wheel")
+{
+  return parseURDFJoints(description, std::vector<std::string>(1, joint_name)).get() != NULL;
+}
+
+TEST(UrdfSelectiveParserTest, testFallback)
+{
+  EXPECT_TRUE(extracted(withTail("")));
+
+  // Unexpanded xacro
+  EXPECT_FALSE(extracted(withTail("<xacro:property name=\"radius\" value=\"0.28\"/>")));
+  EXPECT_FALSE(extracted(withTail("<link name=\"l\"><xacro:insert_block name=\"origin\"/></link>")));
+  EXPECT_FALSE(extracted(withTail("<joint name=\"j\" type=\"fixed\"><origin xyz=\"${x} 0 0\"/>"
+                                  "<parent link=\"base_link\"/><child link=\"l\"/></joint><link name=\"l\"/>")));
+
+  // Entities, declared or not
+  std::string description = readDescription("four_wheel_steering.urdf");
+  description.insert(description.find("<robot"),
+                     "<!DOCTYPE robot [<!ENTITY wheel \"<joint name='front_left_wheel'/>\">]>\n");
+  EXPECT_FALSE(extracted(description));
+  EXPECT_FALSE(extracted(withTail("<link name=\"&wheel;\"/>")));
+
+  // Joints in comments or CDATA sections are not joints
+  EXPECT_FALSE(extracted(withTail("<!-- <joint name=\"commented\" type=\"fixed\"><parent link=\"base_link\"/>"
+                                  "<child link=\"c\"/></joint> --><link name=\"c\"/>"), "commented"));
+  EXPECT_FALSE(extracted(withTail("<gazebo><![CDATA[<joint name=\"cdata\" type=\"fixed\"><parent link=\"base_link\"/>"
+                                  "<child link=\"c\"/></joint>]]></gazebo><link name=\"c\"/>"), "cdata"));
+  EXPECT_TRUE(extracted(withTail("<!-- <joint name=\"front_left_wheel\" type=\"fixed\"/> -->")));
+
+  // Nested or duplicate joints
+  EXPECT_FALSE(extracted(withTail("<joint name=\"outer\" type=\"fixed\"><parent link=\"base_link\"/><child link=\"o\"/>"
+                                  "<joint name=\"inner\" type=\"fixed\"/></joint><link name=\"o\"/>"), "outer"));
+  EXPECT_FALSE(extracted(withTail("<link name=\"n\"><joint name=\"nested\" type=\"fixed\"/></link>")));
+  EXPECT_FALSE(extracted(withTail("<joint name=\"front_left_wheel\" type=\"fixed\"><parent link=\"base_link\"/>"
+                                  "<child link=\"d\"/></joint><link name=\"d\"/>")));
+  EXPECT_FALSE(extracted(withTail("<joint name=\"twin\" type=\"fixed\"><parent link=\"base_link\"/>"
+                                  "<child link=\"front_left_wheel_link\"/></joint>")));
+
+  // Missing ancestor or child link
+  EXPECT_FALSE(extracted(withTail("<joint name=\"orphan\" type=\"fixed\"><parent link=\"missing\"/>"
+                                  "<child link=\"o\"/></joint><link name=\"o\"/>"), "orphan"));
+  EXPECT_FALSE(extracted(withTail("<joint name=\"childless\" type=\"fixed\"><parent link=\"base_link\"/>"
+                                  "<child link=\"missing\"/></joint>"), "childless"));
+  EXPECT_FALSE(extracted(withTail(""), "missing_joint"));
+
+  // What urdfdom rejects
+  EXPECT_FALSE(extracted(withTail("<joint name=\"r\" type=\"revolute\"><parent link=\"base_link\"/>"
+                                  "<child link=\"r\"/><limit lower=\"-1\" upper=\"1\"/></joint><link name=\"r\"/>"), "r"));
+  EXPECT_FALSE(extracted(withTail("<link name=\"front_left_wheel_link\"/>")));
+  EXPECT_FALSE(extracted(withTail("<link name=\"malformed\"")));
+  EXPECT_FALSE(extracted(withTail("<link name=\"unclosed\">")));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <boost/weak_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+
+#include <urdf_vehicle_kinematic/urdf_vehicle_kinematic.h>
+
+#include "test_common.h"
+
+using namespace urdf_vehicle_kinematic;
+
+// Floating-point value comparison threshold
+const double EPS = 1e-9;
+
+/// Pose of a frame C in a frame A, from the pose of B in A and of C in B
+static urdf::Pose compose(const urdf::Pose& parent, const urdf::Pose& child)
+{
+  urdf::Pose pose;
+  pose.position = parent.position + parent.rotation*child.position;
+  pose.rotation = parent.rotation*child.rotation;
+  return pose;
+}
+
+TEST(UrdfVehicleKinematicTest, testRotatedOrigins)
+{
+  const std::string description = readDescription("rotated_joints.urdf");
+  boost::shared_ptr<urdf::ModelInterface> model = urdf::parseURDF(description);
+  ASSERT_TRUE(model.get() != NULL);
+  ros::NodeHandle nh;
+  nh.setParam("robot_description", description);
+  UrdfVehicleKinematic::clearCache();
+
+  // With the selective parser, then parsed in full (a partial geometry does not cover every joint)
+  std::vector<std::string> joint_names;
+  joint_names.push_back("front_left_wheel");
+  joint_names.push_back("front_left_steering_joint");
+  joint_names.push_back("lidar_joint");
+  UrdfVehicleKinematic selective(nh, "base_link", "", joint_names);
+  UrdfVehicleKinematic full(nh, "base_link");
+  UrdfVehicleKinematic* kinematics[] = {&selective, &full};
+
+  for (int k = 0; k < 2; ++k)
+  {
+    SCOPED_TRACE(k == 0 ? "selective" : "full");
+    for (std::size_t i = 0; i < joint_names.size(); ++i)
+    {
+      // Chain the joint origins from the joint up to each of its ancestors
+      urdf::Pose pose;
+      pose.clear();
+      boost::shared_ptr<const urdf::Joint> joint = model->getJoint(joint_names[i]);
+      while (joint)
+      {
+        pose = compose(joint->parent_to_joint_origin_transform, pose);
+        urdf::Vector3 transform_vector;
+        ASSERT_TRUE(kinematics[k]->getTransformVector(joint_names[i], joint->parent_link_name, transform_vector))
+          << joint_names[i] << " in " << joint->parent_link_name;
+        EXPECT_NEAR(transform_vector.x, pose.position.x, EPS) << joint_names[i] << " in " << joint->parent_link_name;
+        EXPECT_NEAR(transform_vector.y, pose.position.y, EPS) << joint_names[i] << " in " << joint->parent_link_name;
+        EXPECT_NEAR(transform_vector.z, pose.position.z, EPS) << joint_names[i] << " in " << joint->parent_link_name;
+        if (joint->parent_link_name == "base_link")
+          break;
+        joint = model->getLink(joint->parent_link_name)->parent_joint;
+      }
+    }
+
+    // Links below base_link that are not ancestors of the joint
+    urdf::Vector3 transform_vector;
+    EXPECT_FALSE(kinematics[k]->getTransformVector("front_left_wheel", "mast", transform_vector));
+    EXPECT_FALSE(kinematics[k]->getTransformVector("front_left_wheel", "front_left_wheel_link", transform_vector));
+    EXPECT_FALSE(kinematics[k]->getTransformVector("lidar_joint", "front_axle", transform_vector));
+    EXPECT_FALSE(kinematics[k]->getTransformVector("front_left_steering_joint", "front_left_steering",
+                                                   transform_vector));
+    // Above base_link
+    EXPECT_FALSE(kinematics[k]->getTransformVector("front_left_wheel", "base_footprint", transform_vector));
+
+    double radius = 0.0;
+    EXPECT_TRUE(kinematics[k]->getJointRadius("front_left_wheel", radius));
+    EXPECT_DOUBLE_EQ(radius, 0.3);
+    double steering_limit = 0.0;
+    EXPECT_TRUE(kinematics[k]->getJointSteeringLimits("front_left_steering_joint", steering_limit));
+    EXPECT_DOUBLE_EQ(steering_limit, 0.5);
+  }
+}
+
+/// Description with every occurrence of a text replaced
+static std::string replaced(std::string description, const std::string& from, const std::string& to)
+{
+  for (std::size_t p = description.find(from); p != std::string::npos; p = description.find(from, p + to.size()))
+    description.replace(p, from.size(), to);
+  return description;
+}
+
+TEST(UrdfVehicleKinematicTest, testSharedModel)
+{
+  const std::string description = readDescription("four_wheel_steering.urdf");
+  ros::NodeHandle nh;
+  nh.setParam("robot_description", description);
+
+  UrdfVehicleKinematic::clearCache();
+  boost::weak_ptr<const urdf::ModelInterface> model;
+  boost::weak_ptr<const GeometryIndex> index;
+  boost::shared_ptr<const urdf::ModelInterface> changed_model;
+  {
+    UrdfVehicleKinematic first(nh, "base_link");
+    UrdfVehicleKinematic second(nh, "base_link");
+    ASSERT_TRUE(first.model().get() != NULL);
+    ASSERT_TRUE(first.geometryIndex().get() != NULL);
+    EXPECT_EQ(first.model(), second.model());
+    EXPECT_EQ(first.geometryIndex(), second.geometryIndex());
+
+    // Another base link shares the model, not the index
+    UrdfVehicleKinematic footprint(nh, "base_footprint");
+    EXPECT_EQ(first.model(), footprint.model());
+    EXPECT_NE(first.geometryIndex(), footprint.geometryIndex());
+
+    // A changed description, of the same size, misses the cache
+    nh.setParam("robot_description", replaced(description, "radius=\"0.28\"", "radius=\"0.29\""));
+    UrdfVehicleKinematic changed(nh, "base_link");
+    ASSERT_TRUE(changed.model().get() != NULL);
+    EXPECT_NE(first.model(), changed.model());
+    EXPECT_NE(first.geometryIndex(), changed.geometryIndex());
+    double radius = 0.0;
+    EXPECT_TRUE(changed.getJointRadius("front_left_wheel", radius));
+    EXPECT_DOUBLE_EQ(radius, 0.29);
+    EXPECT_TRUE(first.getJointRadius("front_left_wheel", radius));
+    EXPECT_DOUBLE_EQ(radius, 0.28);
+
+    model = first.model();
+    index = first.geometryIndex();
+    changed_model = changed.model();
+  }
+
+  // Instances built later, as when a controller is restarted, reuse the cached model
+  {
+    UrdfVehicleKinematic again(nh, "base_link");
+    EXPECT_EQ(changed_model, again.model());
+  }
+  UrdfVehicleKinematic again(nh, "base_link");
+  EXPECT_EQ(changed_model, again.model());
+
+  // The description no instance uses anymore is dropped once another one is cached
+  EXPECT_TRUE(model.expired());
+  EXPECT_TRUE(index.expired());
+
+  // Cleared, the cache keeps only what the instances use
+  boost::weak_ptr<const urdf::ModelInterface> cleared_model = changed_model;
+  changed_model.reset();
+  UrdfVehicleKinematic::clearCache();
+  EXPECT_FALSE(cleared_model.expired());
+  again = UrdfVehicleKinematic(nh, "base_footprint");
+  EXPECT_TRUE(cleared_model.expired());
+}
+
+/// Temporary directory, removed with its files
+class TemporaryDirectory
+{
+public:
+  TemporaryDirectory()
+  {
+    char path[] = "/tmp/urdf_vehicle_kinematic_test_XXXXXX";
+    if (mkdtemp(path))
+      path_ = path;
+  }
+
+  ~TemporaryDirectory()
+  {
+    DIR* directory = opendir(path_.c_str());
+    if (!directory)
+      return;
+    for (struct dirent* entry = readdir(directory); entry; entry = readdir(directory))
+      unlink((path_ + "/" + entry->d_name).c_str());
+    closedir(directory);
+    rmdir(path_.c_str());
+  }
+
+  const std::string& path() const { return path_; }
+
+private:
+  std::string path_;
+};
+
+static std::string readFile(const std::string& path)
+{
+  std::ifstream file(path.c_str(), std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& path, const std::string& content)
+{
+  std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+  file << content;
+}
+
+/*
+ * Builds an instance of the four wheel steering description with a geometry cache file, and an empty cache,
+ * checks its front left wheel, and tells whether the geometry was loaded from the file
+ * (robot_description was not parsed then)
+ */
+static bool loadedFromFile(ros::NodeHandle& nh, const std::string& cache_file,
+                           const std::vector<std::string>& joint_names = std::vector<std::string>())
+{
+  UrdfVehicleKinematic::clearCache();
+  UrdfVehicleKinematic kinematics(nh, "base_link", cache_file, joint_names);
+  urdf::Vector3 transform_vector;
+  EXPECT_TRUE(kinematics.getTransformVector("front_left_wheel", "base_link", transform_vector));
+  EXPECT_NEAR(transform_vector.x, 0.95, EPS);
+  EXPECT_NEAR(transform_vector.y, 0.55, EPS);
+  EXPECT_NEAR(transform_vector.z, -0.24, EPS);
+  double radius = 0.0;
+  EXPECT_TRUE(kinematics.getJointRadius("front_left_wheel", radius));
+  EXPECT_DOUBLE_EQ(radius, 0.28);
+  return kinematics.geometryIndex() && !kinematics.model();
+}
+
+TEST(UrdfVehicleKinematicTest, testGeometryCacheFile)
+{
+  ros::NodeHandle nh;
+  nh.setParam("robot_description", readDescription("four_wheel_steering.urdf"));
+  TemporaryDirectory directory;
+  ASSERT_FALSE(directory.path().empty());
+  const std::string cache_file = directory.path() + "/geometry";
+
+  // Round trip, the cache is cleared in between so the instances do not share the geometry
+  EXPECT_FALSE(loadedFromFile(nh, cache_file));
+  EXPECT_TRUE(loadedFromFile(nh, cache_file));
+  const std::string content = readFile(cache_file);
+  ASSERT_GT(content.size(), 32u);
+
+  // Truncated or corrupted files are parsed again, and rewritten
+  writeFile(cache_file, content.substr(0, content.size()/2));
+  EXPECT_FALSE(loadedFromFile(nh, cache_file));
+  EXPECT_TRUE(loadedFromFile(nh, cache_file));
+  std::string corrupted = content;
+  corrupted[content.size() - 20] ^= 0x40;
+  writeFile(cache_file, corrupted);
+  EXPECT_FALSE(loadedFromFile(nh, cache_file));
+  EXPECT_TRUE(loadedFromFile(nh, cache_file));
+
+  // The file starts with the 64 bits version magic, description hash and description size
+  const std::size_t header_fields[] = {0, 8, 16};
+  for (int i = 0; i < 3; ++i)
+  {
+    std::string mismatch = content;
+    mismatch[header_fields[i]] ^= 0x01;
+    writeFile(cache_file, mismatch);
+    EXPECT_FALSE(loadedFromFile(nh, cache_file)) << "header field at " << header_fields[i];
+    EXPECT_TRUE(loadedFromFile(nh, cache_file)) << "header field at " << header_fields[i];
+  }
+  EXPECT_EQ(content, readFile(cache_file));
+
+  // Instances asking for other joints keep their own file
+  std::vector<std::string> wheel(1, "front_left_wheel");
+  std::vector<std::string> wheels(wheel);
+  wheels.push_back("rear_right_wheel");
+  EXPECT_FALSE(loadedFromFile(nh, cache_file, wheel));
+  EXPECT_FALSE(loadedFromFile(nh, cache_file, wheels));
+  EXPECT_TRUE(loadedFromFile(nh, cache_file, wheel));
+  EXPECT_TRUE(loadedFromFile(nh, cache_file, wheels));
+  EXPECT_TRUE(loadedFromFile(nh, cache_file));
+  std::reverse(wheels.begin(), wheels.end());
+  EXPECT_TRUE(loadedFromFile(nh, cache_file, wheels));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "urdf_vehicle_kinematic_test");
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <vehicle_kinematics/four_wheel_steering_kinematics.h>
+#include <vehicle_kinematics/four_wheel_steering_simd.h>
+
+using namespace vehicle_kinematics;
+
+namespace
+{
+  const std::size_t N = 4096;
+  const int REPEAT = 500;
+
+  // Keep the results alive so the compiler cannot drop the computations
+  volatile double sink;
+
+  template<typename Kernel>
+  double nsPerCall(const Kernel& kernel, const std::vector<double>& a, const std::vector<double>& b)
+  {
+    FourWheelSteeringWheelCommands<double> cmd;
+    double acc = 0.0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int r = 0; r < REPEAT; ++r)
+    {
+      for(std::size_t k = 0; k < N; ++k)
+      {
+        kernel(a[k], b[k], cmd);
+        acc += cmd.velocity[REAR_RIGHT] + cmd.steering[FRONT_LEFT];
+      }
+    }
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    sink = acc;
+    return std::chrono::duration<double, std::nano>(end - start).count()/(double(N)*REPEAT);
+  }
+}
+
+/**
+ * Per cycle cost of the four wheel steering controller wheel computation,
+ * scalar code against the vector kernel of the current build (see simd::BACKEND).
+ */
+int main()
+{
+  const FourWheelSteeringKinematics<double> kinematics(1.1, 0.28, 1.2);
+  std::vector<double> lin(N), ang(N), front(N), rear(N);
+  for(std::size_t k = 0; k < N; ++k)
+  {
+    lin[k] = -2.0 + 4.0*k/N;
+    ang[k] = std::sin(0.01*k);
+    front[k] = 0.4*std::sin(0.013*k);
+    rear[k] = -0.2*std::cos(0.007*k);
+  }
+
+  struct ScalarTwist {
+    const FourWheelSteeringKinematics<double>& k;
+    void operator()(double l, double a, FourWheelSteeringWheelCommands<double>& c) const { k.twistToWheels(l, a, c); }
+  } scalar_twist = {kinematics};
+  struct SimdTwist {
+    const FourWheelSteeringKinematics<double>& k;
+    void operator()(double l, double a, FourWheelSteeringWheelCommands<double>& c) const { simd::twistToWheels(k, l, a, c); }
+  } simd_twist = {kinematics};
+
+  // Rear steering is taken as a fixed ratio of the front one to keep a two arguments kernel
+  struct ScalarFourWheelSteering {
+    const FourWheelSteeringKinematics<double>& k;
+    void operator()(double l, double f, FourWheelSteeringWheelCommands<double>& c) const { k.fourWheelSteeringToWheels(l, f, -0.5*f, c); }
+  } scalar_4ws = {kinematics};
+  struct SimdFourWheelSteering {
+    const FourWheelSteeringKinematics<double>& k;
+    void operator()(double l, double f, FourWheelSteeringWheelCommands<double>& c) const { simd::fourWheelSteeringToWheels(k, l, f, -0.5*f, c); }
+  } simd_4ws = {kinematics};
+
+  std::printf("backend: %s\n", simd::BACKEND);
+  std::printf("twist cmd  scalar: %6.1f ns/cycle  simd: %6.1f ns/cycle\n",
+              nsPerCall(scalar_twist, lin, ang), nsPerCall(simd_twist, lin, ang));
+  std::printf("4ws cmd    scalar: %6.1f ns/cycle  simd: %6.1f ns/cycle\n",
+              nsPerCall(scalar_4ws, lin, front), nsPerCall(simd_4ws, lin, front));
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include <vehicle_kinematics/pose_integration.h>
+
+using namespace vehicle_kinematics;
+
+namespace
+{
+  const double DURATION = 60.0;  // [s]
+  const double REFERENCE_RATE = 100000.0;  // [Hz]
+
+  // Keep the results alive so the compiler cannot drop the computations
+  volatile double sink;
+
+  /// Velocity of a vehicle weaving and side slipping, smooth enough to be sampled at any rate
+  BodyVelocity<double> velocity(double t)
+  {
+    const BodyVelocity<double> v = {2.0 + std::sin(0.8*t), 0.3*std::cos(0.6*t), 0.5*std::sin(1.3*t + 0.2)};
+    return v;
+  }
+
+  /// Integrates velocity() over DURATION at the given rate, as odometry sampling it once per update
+  Pose2D<double> integrate(IntegrationMethod method, double rate)
+  {
+    const long steps = static_cast<long>(DURATION*rate + 0.5);
+    const double dt = DURATION/steps;
+    Pose2D<double> pose = {0.0, 0.0, 0.0};
+    BodyVelocity<double> previous = velocity(0.0);
+    for(long k = 1; k <= steps; ++k)
+    {
+      const BodyVelocity<double> current = velocity(k*dt);
+      integratePose(method, previous, current, dt, pose);
+      previous = current;
+    }
+    return pose;
+  }
+
+  double nsPerCall(IntegrationMethod method)
+  {
+    const int n = 1000000;
+    const BodyVelocity<double> previous = velocity(0.0);
+    const BodyVelocity<double> current = velocity(0.01);
+    Pose2D<double> pose = {0.0, 0.0, 0.0};
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int k = 0; k < n; ++k)
+      integratePose(method, previous, current, 0.01, pose);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    sink = pose.x + pose.y;
+    return std::chrono::duration<double, std::nano>(end - start).count()/n;
+  }
+}
+
+/**
+ * Position error after one minute of driving, per integration method and odometry rate,
+ * against a Runge-Kutta 4 integration of the same trajectory at REFERENCE_RATE.
+ */
+int main()
+{
+  const Pose2D<double> reference = integrate(INTEGRATION_RUNGE_KUTTA_4, REFERENCE_RATE);
+
+  const IntegrationMethod methods[] = {INTEGRATION_EULER, INTEGRATION_RUNGE_KUTTA_2,
+                                       INTEGRATION_EXACT, INTEGRATION_RUNGE_KUTTA_4};
+  const char* names[] = {"euler", "runge_kutta_2", "exact", "runge_kutta_4"};
+  const double rates[] = {50.0, 100.0, 200.0, 500.0, 1000.0};
+
+  std::printf("position error [m] after %.0f s\n%-14s", DURATION, "rate [Hz]");
+  for(double rate : rates)
+    std::printf(" %10.0f", rate);
+  std::printf(" %12s\n", "ns/update");
+
+  for(std::size_t m = 0; m < sizeof(methods)/sizeof(methods[0]); ++m)
+  {
+    std::printf("%-14s", names[m]);
+    for(double rate : rates)
+    {
+      const Pose2D<double> pose = integrate(methods[m], rate);
+      std::printf(" %10.2e", std::hypot(pose.x - reference.x, pose.y - reference.y));
+    }
+    std::printf(" %12.1f\n", nsPerCall(methods[m]));
+  }
+  return 0;
+}
@@ -0,0 +1,254 @@
+#ifndef ACKERMANN_KINEMATICS_H
+#define ACKERMANN_KINEMATICS_H
+
+#include <vehicle_kinematics/common.h>
+
+namespace vehicle_kinematics
+{
+
+  /// Wheel velocities [rad/s] indexed by WheelIndex and front steering angles [rad] (left, right):
+  template<typename T>
+  struct AckermannWheelCommands
+  {
+    T velocity[4];
+    T steering[2];
+  };
+
+  /// Struct-of-arrays view over ackermann commands (speed [m/s], virtual steering [rad]):
+  template<typename T>
+  struct AckermannCommandBatch
+  {
+    const T* linear;
+    const T* steering;
+    std::size_t size;
+  };
+
+  /// Struct-of-arrays output of the batch inverse kinematics:
+  template<typename T>
+  struct AckermannWheelCommandBatch
+  {
+    T* velocity[4];
+    T* steering[2];
+  };
+
+  /**
+   * \brief Forward and inverse kinematics of a vehicle with front steering (ackermann)
+   * The base link is located at the center of the rear axle.
+   */
+  template<typename T>
+  class AckermannKinematics
+  {
+  public:
+
+    /**
+     * \brief Constructor
+     * \param track              Separation between left and right wheels [m]
+     * \param front_wheel_radius Front wheel radius [m]
+     * \param rear_wheel_radius  Rear wheel radius [m]
+     * \param wheel_base         Distance between front and rear axles [m]
+     * \param steering_limit     Steering joint limit [rad]
+     */
+    AckermannKinematics(T track = T(0), T front_wheel_radius = T(0), T rear_wheel_radius = T(0),
+                        T wheel_base = T(0), T steering_limit = T(0))
+    : track_(track)
+    , front_wheel_radius_(front_wheel_radius)
+    , rear_wheel_radius_(rear_wheel_radius)
+    , wheel_base_(wheel_base)
+    , steering_limit_(steering_limit)
+    {
+    }
+
+    /**
+     * \brief Sets the wheel parameters: radius and separation
+     * \param track              Separation between left and right wheels [m]
+     * \param front_wheel_radius Front wheel radius [m]
+     * \param rear_wheel_radius  Rear wheel radius [m]
+     * \param wheel_base         Distance between front and rear axles [m]
+     */
+    void setWheelParams(T track, T front_wheel_radius, T rear_wheel_radius, T wheel_base)
+    {
+      track_ = track;
+      front_wheel_radius_ = front_wheel_radius;
+      rear_wheel_radius_ = rear_wheel_radius;
+      wheel_base_ = wheel_base;
+    }
+
+    /**
+     * \brief Sets the steering joint limit (assuming it is the same for the left and right joints)
+     * \param steering_limit Steering joint limit [rad]
+     */
+    void setSteeringLimit(T steering_limit)
+    {
+      steering_limit_ = steering_limit;
+    }
+
+    T getTrack() const { return track_; }
+    T getFrontWheelRadius() const { return front_wheel_radius_; }
+    T getRearWheelRadius() const { return rear_wheel_radius_; }
+    T getWheelBase() const { return wheel_base_; }
+    T getSteeringLimit() const { return steering_limit_; }
+
+    /**
+     * \brief Forward kinematics, yaw rate of the vehicle
+     * \param linear   Linear speed of the rear axle center [m/s]
+     * \param steering Front virtual steering angle [rad]
+     * \return Yaw rate [rad/s]
+     */
+    T angularVelocity(T linear, T steering) const
+    {
+      return linear * std::tan(steering) / wheel_base_;
+    }
+
+    /**
+     * \brief Inverse kinematics of the wheel velocities
+     * \param [in]  linear   Linear speed [m/s]
+     * \param [in]  angular  Yaw rate [rad/s]
+     * \param [out] velocity Wheel velocities indexed by WheelIndex [rad/s]
+     */
+    void wheelVelocities(T linear, T angular, T velocity[4]) const
+    {
+      const T sign = std::copysign(T(1), linear);
+      const T left = linear - angular*track_/2;
+      const T right = linear + angular*track_/2;
+      const T lateral = wheel_base_*angular;
+      velocity[FRONT_LEFT]  = sign * std::sqrt(left*left + lateral*lateral)/front_wheel_radius_;
+      velocity[FRONT_RIGHT] = sign * std::sqrt(right*right + lateral*lateral)/front_wheel_radius_;
+      velocity[REAR_LEFT]   = left/rear_wheel_radius_;
+      velocity[REAR_RIGHT]  = right/rear_wheel_radius_;
+    }
+
+    /**
+     * \brief Inverse kinematics of the front steering angles from a twist
+     * \param [in]  linear         Linear speed [m/s]
+     * \param [in]  angular        Yaw rate [rad/s]
+     * \param [out] left_steering  Front left steering angle [rad]
+     * \param [out] right_steering Front right steering angle [rad]
+     */
+    void twistToSteering(T linear, T angular, T& left_steering, T& right_steering) const
+    {
+      left_steering = T(0);
+      right_steering = T(0);
+      if(std::fabs(linear) > std::fabs(angular*track_/T(2)))
+      {
+        left_steering = std::atan(angular*wheel_base_ / (linear - angular*track_/T(2)));
+        right_steering = std::atan(angular*wheel_base_ / (linear + angular*track_/T(2)));
+      }
+    }
+
+    /**
+     * \brief Inverse kinematics of the front steering angles from a virtual steering angle
+     * \param [in]  steering       Front virtual steering angle [rad]
+     * \param [out] left_steering  Front left steering angle [rad]
+     * \param [out] right_steering Front right steering angle [rad]
+     */
+    void ackermannToSteering(T steering, T& left_steering, T& right_steering) const
+    {
+      const T tan_steering = std::tan(steering);
+      left_steering = std::atan2(tan_steering, 1 - tan_steering*track_/(2*wheel_base_));
+      right_steering = std::atan2(tan_steering, 1 + tan_steering*track_/(2*wheel_base_));
+    }
+
+    /**
+     * \brief Update the steering command with steering joint limitation to handle saturation
+     * \f[ tan(\delta_{FR})=\frac{wheel_base}{\frac{wheel\_base}{tan(\delta_{FL})}+track)}
+     * \f]
+     * \f[ tan(\delta_{FL})=\frac{wheel_base}
+     *                           {\frac{wheel\_base}
+     *                                 {tan(\delta_{FR})}
+     *                           -track)}
+     * \f]
+     * \param front_left_steering \f$ \delta_{FL} \f$
+     * \param front_right_steering \f$ \delta_{FR}  \f$
+     */
+    void handleSteeringSaturation(T& front_left_steering, T& front_right_steering) const
+    {
+      if(front_left_steering > steering_limit_)
+      {
+        front_left_steering = std::copysign(steering_limit_, front_left_steering);
+        front_right_steering = std::atan(wheel_base_/(wheel_base_/std::tan(front_left_steering) + track_));
+      }
+      else if(front_right_steering < -steering_limit_)
+      {
+        front_right_steering = std::copysign(steering_limit_, front_right_steering);
+        front_left_steering = std::atan(wheel_base_/(wheel_base_/std::tan(front_right_steering) - track_));
+      }
+    }
+
+    /**
+     * \brief Inverse kinematics of a twist command, steering saturation included
+     * \param [in]  linear  Linear speed [m/s]
+     * \param [in]  angular Yaw rate [rad/s]
+     * \param [out] cmd     Wheel velocities and steering angles
+     */
+    void twistToWheels(T linear, T angular, AckermannWheelCommands<T>& cmd) const
+    {
+      wheelVelocities(linear, angular, cmd.velocity);
+      twistToSteering(linear, angular, cmd.steering[0], cmd.steering[1]);
+      handleSteeringSaturation(cmd.steering[0], cmd.steering[1]);
+    }
+
+    /**
+     * \brief Inverse kinematics of an ackermann command, steering saturation included
+     * \param [in]  linear   Linear speed [m/s]
+     * \param [in]  steering Front virtual steering angle [rad]
+     * \param [out] cmd      Wheel velocities and steering angles
+     */
+    void ackermannToWheels(T linear, T steering, AckermannWheelCommands<T>& cmd) const
+    {
+      wheelVelocities(linear, angularVelocity(linear, steering), cmd.velocity);
+      ackermannToSteering(steering, cmd.steering[0], cmd.steering[1]);
+      handleSteeringSaturation(cmd.steering[0], cmd.steering[1]);
+    }
+
+    /**
+     * \brief Batch inverse kinematics of twist commands
+     * \param [in]  cmds   Twist commands
+     * \param [out] wheels Wheel commands, each array must hold cmds.size elements
+     */
+    void twistToWheels(const TwistCommandBatch<T>& cmds, AckermannWheelCommandBatch<T>& wheels) const
+    {
+      AckermannWheelCommands<T> cmd;
+      for(std::size_t k = 0; k < cmds.size; ++k)
+      {
+        twistToWheels(cmds.linear[k], cmds.angular[k], cmd);
+        store(cmd, k, wheels);
+      }
+    }
+
+    /**
+     * \brief Batch inverse kinematics of ackermann commands
+     * \param [in]  cmds   Ackermann commands
+     * \param [out] wheels Wheel commands, each array must hold cmds.size elements
+     */
+    void ackermannToWheels(const AckermannCommandBatch<T>& cmds, AckermannWheelCommandBatch<T>& wheels) const
+    {
+      AckermannWheelCommands<T> cmd;
+      for(std::size_t k = 0; k < cmds.size; ++k)
+      {
+        ackermannToWheels(cmds.linear[k], cmds.steering[k], cmd);
+        store(cmd, k, wheels);
+      }
+    }
+
+  private:
+    static void store(const AckermannWheelCommands<T>& cmd, std::size_t k,
+                      AckermannWheelCommandBatch<T>& wheels)
+    {
+      for(int i = 0; i < 4; ++i)
+        wheels.velocity[i][k] = cmd.velocity[i];
+      wheels.steering[0][k] = cmd.steering[0];
+      wheels.steering[1][k] = cmd.steering[1];
+    }
+
+    /// Wheel kinematic parameters [m]:
+    T track_;
+    T front_wheel_radius_, rear_wheel_radius_;
+    T wheel_base_;
+
+    /// Joint steering limits [rad]:
+    T steering_limit_;
+  };
+
+} // namespace vehicle_kinematics
+
+#endif // ACKERMANN_KINEMATICS_H
@@ -0,0 +1,57 @@
+#ifndef VEHICLE_KINEMATICS_COMMON_H
+#define VEHICLE_KINEMATICS_COMMON_H
+
+#include <cmath>
+#include <cstddef>
+
+namespace vehicle_kinematics
+{
+
+  /// Index of each wheel in the per wheel arrays (same order as the controller joints):
+  enum WheelIndex
+  {
+    FRONT_LEFT = 0,
+    FRONT_RIGHT = 1,
+    REAR_LEFT = 2,
+    REAR_RIGHT = 3
+  };
+
+  /// Velocity of the base link frame:
+  template<typename T>
+  struct BodyVelocity
+  {
+    T linear_x;  // [m/s]
+    T linear_y;  // [m/s]
+    T angular;   // [rad/s]
+  };
+
+  /// Struct-of-arrays view over twist commands (speed [m/s] and yaw rate [rad/s]):
+  template<typename T>
+  struct TwistCommandBatch
+  {
+    const T* linear;
+    const T* angular;
+    std::size_t size;
+  };
+
+  /**
+   * \brief Compute the steering angle of a virtual wheel located at the center of an axle
+   * \param left_steering  Left wheel steering angle [rad]
+   * \param right_steering Right wheel steering angle [rad]
+   * \return Virtual steering angle [rad], 0 when both wheels are (nearly) straight
+   */
+  template<typename T>
+  inline T virtualSteeringAngle(T left_steering, T right_steering)
+  {
+    if(std::fabs(left_steering) > T(0.001) || std::fabs(right_steering) > T(0.001))
+    {
+      const T tan_left = std::tan(left_steering);
+      const T tan_right = std::tan(right_steering);
+      return std::atan(2*tan_left*tan_right/(tan_left + tan_right));
+    }
+    return T(0);
+  }
+
+} // namespace vehicle_kinematics
+
+#endif // VEHICLE_KINEMATICS_COMMON_H
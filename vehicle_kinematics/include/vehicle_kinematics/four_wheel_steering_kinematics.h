@@ -0,0 +1,330 @@
+#ifndef FOUR_WHEEL_STEERING_KINEMATICS_H
+#define FOUR_WHEEL_STEERING_KINEMATICS_H
+
+#include <vehicle_kinematics/common.h>
+
+namespace vehicle_kinematics
+{
+
+  /// Wheel velocities [rad/s] and steering angles [rad] of a four wheel steering vehicle, indexed by WheelIndex:
+  template<typename T>
+  struct FourWheelSteeringWheelCommands
+  {
+    T velocity[4];
+    T steering[4];
+  };
+
+  /// Struct-of-arrays view over four wheel steering commands (speed [m/s], virtual steerings [rad]):
+  template<typename T>
+  struct FourWheelSteeringCommandBatch
+  {
+    const T* linear;
+    const T* front_steering;
+    const T* rear_steering;
+    std::size_t size;
+  };
+
+  /// Struct-of-arrays output of the batch inverse kinematics, one array per wheel and per steering joint:
+  template<typename T>
+  struct FourWheelSteeringWheelCommandBatch
+  {
+    T* velocity[4];
+    T* steering[4];
+  };
+
+  /// Struct-of-arrays view over the joint states used by the forward kinematics:
+  template<typename T>
+  struct FourWheelSteeringStateBatch
+  {
+    const T* rear_left_speed;
+    const T* rear_right_speed;
+    const T* front_steering;
+    const T* rear_steering;
+    std::size_t size;
+  };
+
+  /// Struct-of-arrays output of the batch forward kinematics:
+  template<typename T>
+  struct BodyVelocityBatch
+  {
+    T* linear_x;
+    T* linear_y;
+    T* angular;
+  };
+
+  /**
+   * \brief Forward and inverse kinematics of a four wheel steering vehicle
+   * The front and rear axles are symmetric with respect to the base link frame,
+   * and all wheels have the same radius.
+   */
+  template<typename T>
+  class FourWheelSteeringKinematics
+  {
+  public:
+
+    /**
+     * \brief Constructor
+     * \param track        Separation between left and right wheels [m]
+     * \param wheel_radius Wheel radius [m]
+     * \param wheel_base   Distance between front and rear axles [m]
+     */
+    FourWheelSteeringKinematics(T track = T(0), T wheel_radius = T(0), T wheel_base = T(0))
+    : track_(track)
+    , wheel_radius_(wheel_radius)
+    , wheel_base_(wheel_base)
+    {
+    }
+
+    /**
+     * \brief Sets the wheel parameters: radius and separation
+     * \param track        Separation between left and right wheels [m]
+     * \param wheel_radius Wheel radius [m]
+     * \param wheel_base   Distance between front and rear axles [m]
+     */
+    void setWheelParams(T track, T wheel_radius, T wheel_base)
+    {
+      track_ = track;
+      wheel_radius_ = wheel_radius;
+      wheel_base_ = wheel_base;
+    }
+
+    T getTrack() const { return track_; }
+    T getWheelRadius() const { return wheel_radius_; }
+    T getWheelBase() const { return wheel_base_; }
+
+    /**
+     * \brief Inverse kinematics of a twist command, the rear steering is opposite to the front one
+     * \param [in]  linear  Linear speed [m/s]
+     * \param [in]  angular Yaw rate [rad/s]
+     * \param [out] cmd     Wheel velocities and steering angles
+     */
+    void twistToWheels(T linear, T angular, FourWheelSteeringWheelCommands<T>& cmd) const
+    {
+      for(int i = 0; i < 4; ++i)
+      {
+        cmd.velocity[i] = T(0);
+        cmd.steering[i] = T(0);
+      }
+
+      // Compute wheels velocities:
+      if(std::fabs(linear) > T(0.001))
+      {
+        const T sign = std::copysign(T(1), linear);
+        const T lateral = wheel_base_*angular/T(2);
+        const T left = linear - angular*track_/2;
+        const T right = linear + angular*track_/2;
+        cmd.velocity[FRONT_LEFT]  = sign * std::sqrt(left*left + lateral*lateral)/wheel_radius_;
+        cmd.velocity[FRONT_RIGHT] = sign * std::sqrt(right*right + lateral*lateral)/wheel_radius_;
+        cmd.velocity[REAR_LEFT]   = cmd.velocity[FRONT_LEFT];
+        cmd.velocity[REAR_RIGHT]  = cmd.velocity[FRONT_RIGHT];
+      }
+
+      // Compute steering angles
+      if(std::fabs(T(2)*linear) > std::fabs(angular*track_))
+      {
+        cmd.steering[FRONT_LEFT]  = std::atan(angular*wheel_base_ / (T(2)*linear - angular*track_));
+        cmd.steering[FRONT_RIGHT] = std::atan(angular*wheel_base_ / (T(2)*linear + angular*track_));
+        cmd.steering[REAR_LEFT]   = -cmd.steering[FRONT_LEFT];
+        cmd.steering[REAR_RIGHT]  = -cmd.steering[FRONT_RIGHT];
+      }
+      else if(std::fabs(linear) > T(0.001))
+      {
+        cmd.steering[FRONT_LEFT]  = std::copysign(T(M_PI_2), angular);
+        cmd.steering[FRONT_RIGHT] = std::copysign(T(M_PI_2), angular);
+        cmd.steering[REAR_LEFT]   = std::copysign(T(M_PI_2), -angular);
+        cmd.steering[REAR_RIGHT]  = std::copysign(T(M_PI_2), -angular);
+      }
+    }
+
+    /**
+     * \brief Inverse kinematics of a four wheel steering command
+     * \param [in]  linear         Linear speed [m/s]
+     * \param [in]  front_steering Front virtual steering angle [rad]
+     * \param [in]  rear_steering  Rear virtual steering angle [rad]
+     * \param [out] cmd            Wheel velocities and steering angles
+     */
+    void fourWheelSteeringToWheels(T linear, T front_steering, T rear_steering,
+                                   FourWheelSteeringWheelCommands<T>& cmd) const
+    {
+      for(int i = 0; i < 4; ++i)
+      {
+        cmd.velocity[i] = T(0);
+        cmd.steering[i] = T(0);
+      }
+
+      // Compute steering angles
+      const T steering_diff = track_*(std::tan(front_steering) - std::tan(rear_steering))/T(2);
+      if(std::fabs(wheel_base_ - std::fabs(steering_diff)) > T(0.001))
+      {
+        cmd.steering[FRONT_LEFT]  = wheel_base_*front_steering/(wheel_base_ - steering_diff);
+        cmd.steering[FRONT_RIGHT] = wheel_base_*front_steering/(wheel_base_ + steering_diff);
+        cmd.steering[REAR_LEFT]   = wheel_base_*rear_steering/(wheel_base_ - steering_diff);
+        cmd.steering[REAR_RIGHT]  = wheel_base_*rear_steering/(wheel_base_ + steering_diff);
+      }
+
+      // Compute wheels velocities:
+      if(std::fabs(linear) > T(0.001))
+      {
+        // Distance between the projection of the CIR on the wheelbase and the front axle
+        T l_front = T(0);
+        const T tan_front_left = std::tan(cmd.steering[FRONT_LEFT]);
+        const T tan_front_right = std::tan(cmd.steering[FRONT_RIGHT]);
+        if(std::fabs(tan_front_left - tan_front_right) > T(0.01))
+        {
+          l_front = tan_front_right * tan_front_left * track_ / (tan_front_left - tan_front_right);
+        }
+
+        const T angular = linear * (std::tan(front_steering) - std::tan(rear_steering))/wheel_base_;
+
+        const T sign = std::copysign(T(1), linear);
+        const T left = linear - angular*track_/2;
+        const T right = linear + angular*track_/2;
+        const T lateral_front = l_front*angular;
+        const T lateral = wheel_base_*angular/T(2);
+        cmd.velocity[FRONT_LEFT]  = sign * std::sqrt(left*left + lateral_front*lateral_front)/wheel_radius_;
+        cmd.velocity[FRONT_RIGHT] = sign * std::sqrt(right*right + lateral*lateral)/wheel_radius_;
+        cmd.velocity[REAR_LEFT]   = sign * std::sqrt(left*left + lateral*lateral)/wheel_radius_;
+        cmd.velocity[REAR_RIGHT]  = cmd.velocity[FRONT_RIGHT];
+      }
+    }
+
+    /**
+     * \brief Forward kinematics, velocity of the base link from the rear wheels and virtual steerings
+     * \param [in]  rear_left_speed  Rear left wheel speed [rad/s]
+     * \param [in]  rear_right_speed Rear right wheel speed [rad/s]
+     * \param [in]  front_steering   Front virtual steering angle [rad]
+     * \param [in]  rear_steering    Rear virtual steering angle [rad]
+     * \param [out] velocity         Velocity of the base link
+     */
+    void wheelsToBody(T rear_left_speed, T rear_right_speed, T front_steering, T rear_steering,
+                      BodyVelocity<T>& velocity) const
+    {
+      const T rear_tmp = std::cos(rear_steering)*(std::tan(front_steering) - std::tan(rear_steering))/wheel_base_;
+      const T track_tmp = track_*rear_tmp;
+      const T rear_linear_speed = wheel_radius_ * std::copysign(T(1), rear_left_speed + rear_right_speed)*
+          std::sqrt((rear_left_speed*rear_left_speed + rear_right_speed*rear_right_speed)/
+                    (T(2) + track_tmp*track_tmp/T(2)));
+
+      velocity.angular = rear_linear_speed*rear_tmp;
+      velocity.linear_x = rear_linear_speed*std::cos(rear_steering);
+      velocity.linear_y = rear_linear_speed*std::sin(rear_steering) + wheel_base_*velocity.angular/T(2);
+    }
+
+    /**
+     * \brief Forward kinematics from the four wheels, least squares fit of the rolling constraints
+     * Each wheel rolls at the speed of its contact point along its own direction, the velocity
+     * best matching the four wheels is kept. Linear in the wheel speeds, so wheel position
+     * increments [rad] give the base link displacement over the same interval.
+     * \param [in]  wheel_speed Wheel speeds [rad/s], indexed by WheelIndex
+     * \param [in]  steering    Wheel steering angles [rad], indexed by WheelIndex
+     * \param [out] velocity    Velocity of the base link, unchanged on failure
+     * \return false if the steering angles do not constrain the velocity (all wheels sideways)
+     */
+    bool wheelsToBody(const T (&wheel_speed)[4], const T (&steering)[4], BodyVelocity<T>& velocity) const
+    {
+      const T position_x[4] = {wheel_base_/T(2), wheel_base_/T(2), -wheel_base_/T(2), -wheel_base_/T(2)};
+      const T position_y[4] = {track_/T(2), -track_/T(2), track_/T(2), -track_/T(2)};
+
+      // Normal equations m*velocity = b of the constraints a_i.velocity = wheel_radius*wheel_speed_i
+      T m[3][3] = {{T(0)}};
+      T b[3] = {T(0)};
+      for(int i = 0; i < 4; ++i)
+      {
+        const T c = std::cos(steering[i]);
+        const T s = std::sin(steering[i]);
+        const T a[3] = {c, s, position_x[i]*s - position_y[i]*c};
+        for(int j = 0; j < 3; ++j)
+        {
+          for(int k = 0; k < 3; ++k)
+            m[j][k] += a[j]*a[k];
+          b[j] += a[j]*wheel_radius_*wheel_speed[i];
+        }
+      }
+
+      const T det = m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+                  - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+                  + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+      if(std::fabs(det) < T(1e-9))
+        return false;
+
+      velocity.linear_x = (b[0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+                         - m[0][1]*(b[1]*m[2][2] - m[1][2]*b[2])
+                         + m[0][2]*(b[1]*m[2][1] - m[1][1]*b[2]))/det;
+      velocity.linear_y = (m[0][0]*(b[1]*m[2][2] - m[1][2]*b[2])
+                         - b[0]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+                         + m[0][2]*(m[1][0]*b[2] - b[1]*m[2][0]))/det;
+      velocity.angular = (m[0][0]*(m[1][1]*b[2] - b[1]*m[2][1])
+                        - m[0][1]*(m[1][0]*b[2] - b[1]*m[2][0])
+                        + b[0]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]))/det;
+      return true;
+    }
+
+    /**
+     * \brief Batch inverse kinematics of twist commands
+     * \param [in]  cmds  Twist commands
+     * \param [out] wheels Wheel commands, each array must hold cmds.size elements
+     */
+    void twistToWheels(const TwistCommandBatch<T>& cmds, FourWheelSteeringWheelCommandBatch<T>& wheels) const
+    {
+      FourWheelSteeringWheelCommands<T> cmd;
+      for(std::size_t k = 0; k < cmds.size; ++k)
+      {
+        twistToWheels(cmds.linear[k], cmds.angular[k], cmd);
+        store(cmd, k, wheels);
+      }
+    }
+
+    /**
+     * \brief Batch inverse kinematics of four wheel steering commands
+     * \param [in]  cmds   Four wheel steering commands
+     * \param [out] wheels Wheel commands, each array must hold cmds.size elements
+     */
+    void fourWheelSteeringToWheels(const FourWheelSteeringCommandBatch<T>& cmds,
+                                   FourWheelSteeringWheelCommandBatch<T>& wheels) const
+    {
+      FourWheelSteeringWheelCommands<T> cmd;
+      for(std::size_t k = 0; k < cmds.size; ++k)
+      {
+        fourWheelSteeringToWheels(cmds.linear[k], cmds.front_steering[k], cmds.rear_steering[k], cmd);
+        store(cmd, k, wheels);
+      }
+    }
+
+    /**
+     * \brief Batch forward kinematics
+     * \param [in]  states     Joint states
+     * \param [out] velocities Base link velocities, each array must hold states.size elements
+     */
+    void wheelsToBody(const FourWheelSteeringStateBatch<T>& states, BodyVelocityBatch<T>& velocities) const
+    {
+      BodyVelocity<T> velocity;
+      for(std::size_t k = 0; k < states.size; ++k)
+      {
+        wheelsToBody(states.rear_left_speed[k], states.rear_right_speed[k],
+                     states.front_steering[k], states.rear_steering[k], velocity);
+        velocities.linear_x[k] = velocity.linear_x;
+        velocities.linear_y[k] = velocity.linear_y;
+        velocities.angular[k] = velocity.angular;
+      }
+    }
+
+  private:
+    static void store(const FourWheelSteeringWheelCommands<T>& cmd, std::size_t k,
+                      FourWheelSteeringWheelCommandBatch<T>& wheels)
+    {
+      for(int i = 0; i < 4; ++i)
+      {
+        wheels.velocity[i][k] = cmd.velocity[i];
+        wheels.steering[i][k] = cmd.steering[i];
+      }
+    }
+
+    /// Wheel kinematic parameters [m]:
+    T track_;
+    T wheel_radius_;
+    T wheel_base_;
+  };
+
+} // namespace vehicle_kinematics
+
+#endif // FOUR_WHEEL_STEERING_KINEMATICS_H
@@ -0,0 +1,114 @@
+#ifndef FOUR_WHEEL_STEERING_SIMD_H
+#define FOUR_WHEEL_STEERING_SIMD_H
+
+#include <vehicle_kinematics/four_wheel_steering_kinematics.h>
+#include <vehicle_kinematics/simd.h>
+
+namespace vehicle_kinematics
+{
+namespace simd
+{
+
+  /**
+   * \brief Same as FourWheelSteeringKinematics::twistToWheels, the four wheel
+   *        velocities and the four steering angles are each computed in one vector pass
+   * \param [in]  kinematics Vehicle geometry
+   * \param [in]  linear     Linear speed [m/s]
+   * \param [in]  angular    Yaw rate [rad/s]
+   * \param [out] cmd        Wheel velocities and steering angles
+   */
+  inline void twistToWheels(const FourWheelSteeringKinematics<double>& kinematics,
+                            double linear, double angular,
+                            FourWheelSteeringWheelCommands<double>& cmd)
+  {
+    const double track = kinematics.getTrack();
+    const double wheel_base = kinematics.getWheelBase();
+
+    Vec4d velocity = broadcast(0.0);
+    if(std::fabs(linear) > 0.001)
+    {
+      const double left = linear - angular*track/2;
+      const double right = linear + angular*track/2;
+      const Vec4d lon = set(left, right, left, right);
+      const Vec4d lat = broadcast(wheel_base*angular/2.0);
+      velocity = broadcast(std::copysign(1.0, linear)) * sqrt(lon*lon + lat*lat)
+          / broadcast(kinematics.getWheelRadius());
+    }
+    store(velocity, cmd.velocity);
+
+    if(std::fabs(2.0*linear) > std::fabs(angular*track))
+    {
+      const double left = 2.0*linear - angular*track;
+      const double right = 2.0*linear + angular*track;
+      const Vec4d steering = atan(broadcast(angular*wheel_base) / set(left, right, left, right))
+          * set(1.0, 1.0, -1.0, -1.0);
+      store(steering, cmd.steering);
+    }
+    else if(std::fabs(linear) > 0.001)
+    {
+      cmd.steering[FRONT_LEFT]  = std::copysign(M_PI_2, angular);
+      cmd.steering[FRONT_RIGHT] = std::copysign(M_PI_2, angular);
+      cmd.steering[REAR_LEFT]   = std::copysign(M_PI_2, -angular);
+      cmd.steering[REAR_RIGHT]  = std::copysign(M_PI_2, -angular);
+    }
+    else
+    {
+      store(broadcast(0.0), cmd.steering);
+    }
+  }
+
+  /**
+   * \brief Same as FourWheelSteeringKinematics::fourWheelSteeringToWheels, the four
+   *        wheel velocities and the four steering angles are each computed in one vector pass
+   * \param [in]  kinematics     Vehicle geometry
+   * \param [in]  linear         Linear speed [m/s]
+   * \param [in]  front_steering Front virtual steering angle [rad]
+   * \param [in]  rear_steering  Rear virtual steering angle [rad]
+   * \param [out] cmd            Wheel velocities and steering angles
+   */
+  inline void fourWheelSteeringToWheels(const FourWheelSteeringKinematics<double>& kinematics,
+                                        double linear, double front_steering, double rear_steering,
+                                        FourWheelSteeringWheelCommands<double>& cmd)
+  {
+    const double track = kinematics.getTrack();
+    const double wheel_base = kinematics.getWheelBase();
+    const double tan_diff = std::tan(front_steering) - std::tan(rear_steering);
+
+    const double steering_diff = track*tan_diff/2.0;
+    Vec4d steering = broadcast(0.0);
+    if(std::fabs(wheel_base - std::fabs(steering_diff)) > 0.001)
+    {
+      const Vec4d wb = broadcast(wheel_base);
+      steering = wb*set(front_steering, front_steering, rear_steering, rear_steering)
+          / (wb - set(steering_diff, -steering_diff, steering_diff, -steering_diff));
+    }
+    store(steering, cmd.steering);
+
+    Vec4d velocity = broadcast(0.0);
+    if(std::fabs(linear) > 0.001)
+    {
+      // Distance between the projection of the CIR on the wheelbase and the front axle
+      double l_front = 0.0;
+      const double tan_front_left = std::tan(cmd.steering[FRONT_LEFT]);
+      const double tan_front_right = std::tan(cmd.steering[FRONT_RIGHT]);
+      if(std::fabs(tan_front_left - tan_front_right) > 0.01)
+      {
+        l_front = tan_front_right * tan_front_left * track / (tan_front_left - tan_front_right);
+      }
+
+      const double angular = linear * tan_diff/wheel_base;
+      const double left = linear - angular*track/2;
+      const double right = linear + angular*track/2;
+      const double lateral = wheel_base*angular/2.0;
+      const Vec4d lon = set(left, right, left, right);
+      const Vec4d lat = set(l_front*angular, lateral, lateral, lateral);
+      velocity = broadcast(std::copysign(1.0, linear)) * sqrt(lon*lon + lat*lat)
+          / broadcast(kinematics.getWheelRadius());
+    }
+    store(velocity, cmd.velocity);
+  }
+
+} // namespace simd
+} // namespace vehicle_kinematics
+
+#endif // FOUR_WHEEL_STEERING_SIMD_H
@@ -0,0 +1,137 @@
+#ifndef VEHICLE_KINEMATICS_POSE_INTEGRATION_H
+#define VEHICLE_KINEMATICS_POSE_INTEGRATION_H
+
+#include <string>
+
+#include <vehicle_kinematics/common.h>
+
+namespace vehicle_kinematics
+{
+
+  /// Methods integrating the base link velocity into a 2D pose, from the cheapest to the most accurate:
+  enum IntegrationMethod
+  {
+    /// Heading at the start of the step:
+    INTEGRATION_EULER,
+    /// Heading at the middle of the step:
+    INTEGRATION_RUNGE_KUTTA_2,
+    /// Circular arc, exact for a velocity constant over the step (lateral velocity included):
+    INTEGRATION_EXACT,
+    /// 4th order Runge-Kutta, the velocity varying linearly from the previous step to this one:
+    INTEGRATION_RUNGE_KUTTA_4
+  };
+
+  /**
+   * \brief Parses an integration method name: euler, runge_kutta_2, exact or runge_kutta_4
+   * \param name   Method name
+   * \param method Parsed method, unchanged if the name is unknown
+   * \return false if the name is unknown
+   */
+  inline bool integrationMethodFromString(const std::string& name, IntegrationMethod& method)
+  {
+    if(name == "euler")
+      method = INTEGRATION_EULER;
+    else if(name == "runge_kutta_2")
+      method = INTEGRATION_RUNGE_KUTTA_2;
+    else if(name == "exact")
+      method = INTEGRATION_EXACT;
+    else if(name == "runge_kutta_4")
+      method = INTEGRATION_RUNGE_KUTTA_4;
+    else
+      return false;
+    return true;
+  }
+
+  /// 2D pose of the base link frame in the odometry frame:
+  template<typename T>
+  struct Pose2D
+  {
+    T x;        // [m]
+    T y;        // [m]
+    T heading;  // [rad]
+  };
+
+  namespace detail
+  {
+    /// Moves the pose by a displacement given in the base link frame oriented by heading:
+    template<typename T>
+    inline void translate(Pose2D<T>& pose, T heading, T dx, T dy)
+    {
+      const T c = std::cos(heading);
+      const T s = std::sin(heading);
+      pose.x += dx*c - dy*s;
+      pose.y += dx*s + dy*c;
+    }
+  } // namespace detail
+
+  /**
+   * \brief Integrates the base link velocity over one step
+   * Euler, Runge-Kutta 2 and exact integrations use the velocity at the end of the step only,
+   * as if it had been constant since the previous one.
+   * \param method   Integration method
+   * \param previous Velocity at the start of the step, only used by INTEGRATION_RUNGE_KUTTA_4
+   * \param current  Velocity at the end of the step
+   * \param dt       Step duration [s], may be 1 to integrate displacements rather than velocities
+   * \param pose     Pose at the start of the step, updated to the end of the step
+   */
+  template<typename T>
+  inline void integratePose(IntegrationMethod method,
+                            const BodyVelocity<T>& previous, const BodyVelocity<T>& current,
+                            T dt, Pose2D<T>& pose)
+  {
+    const T dx = current.linear_x*dt;
+    const T dy = current.linear_y*dt;
+    const T dheading = current.angular*dt;
+
+    switch(method)
+    {
+    case INTEGRATION_EULER:
+      detail::translate(pose, pose.heading, dx, dy);
+      pose.heading += dheading;
+      break;
+
+    case INTEGRATION_RUNGE_KUTTA_2:
+      detail::translate(pose, pose.heading + dheading/2, dx, dy);
+      pose.heading += dheading;
+      break;
+
+    case INTEGRATION_EXACT:
+      if(std::fabs(dheading) < T(1e-6))
+      {
+        detail::translate(pose, pose.heading + dheading/2, dx, dy);
+      }
+      else
+      {
+        // Chord of the arc in the frame at the start of the step
+        const T a = std::sin(dheading)/dheading;
+        const T b = (T(1) - std::cos(dheading))/dheading;
+        detail::translate(pose, pose.heading, a*dx - b*dy, b*dx + a*dy);
+      }
+      pose.heading += dheading;
+      break;
+
+    case INTEGRATION_RUNGE_KUTTA_4:
+    {
+      const T mid_x = (previous.linear_x + current.linear_x)/2;
+      const T mid_y = (previous.linear_y + current.linear_y)/2;
+      const T mid_angular = (previous.angular + current.angular)/2;
+
+      const T heading1 = pose.heading;
+      const T heading2 = pose.heading + previous.angular*dt/2;
+      const T heading3 = pose.heading + mid_angular*dt/2;
+      const T heading4 = pose.heading + mid_angular*dt;
+
+      const T h = dt/6;
+      detail::translate(pose, heading1, h*previous.linear_x, h*previous.linear_y);
+      detail::translate(pose, heading2, 2*h*mid_x, 2*h*mid_y);
+      detail::translate(pose, heading3, 2*h*mid_x, 2*h*mid_y);
+      detail::translate(pose, heading4, h*current.linear_x, h*current.linear_y);
+      pose.heading += h*(previous.angular + 4*mid_angular + current.angular);
+      break;
+    }
+    }
+  }
+
+} // namespace vehicle_kinematics
+
+#endif // VEHICLE_KINEMATICS_POSE_INTEGRATION_H
@@ -0,0 +1,160 @@
+#ifndef VEHICLE_KINEMATICS_SIMD_H
+#define VEHICLE_KINEMATICS_SIMD_H
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vehicle_kinematics
+{
+namespace simd
+{
+
+  /**
+   * Minimal 4 lanes double precision vector, one lane per wheel.
+   * The implementation is selected at build time: AVX (one 256 bits register),
+   * SSE2 (two 128 bits registers) or plain scalar code.
+   */
+#if defined(__AVX__)
+
+  static const char* const BACKEND = "avx";
+
+  struct Vec4d
+  {
+    __m256d v;
+  };
+
+  inline Vec4d set(double a, double b, double c, double d) { Vec4d r = {_mm256_setr_pd(a, b, c, d)}; return r; }
+  inline Vec4d broadcast(double a) { Vec4d r = {_mm256_set1_pd(a)}; return r; }
+  inline void store(const Vec4d& a, double* p) { _mm256_storeu_pd(p, a.v); }
+
+  inline Vec4d operator+(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_add_pd(a.v, b.v)}; return r; }
+  inline Vec4d operator-(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_sub_pd(a.v, b.v)}; return r; }
+  inline Vec4d operator*(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_mul_pd(a.v, b.v)}; return r; }
+  inline Vec4d operator/(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_div_pd(a.v, b.v)}; return r; }
+  inline Vec4d sqrt(const Vec4d& a) { Vec4d r = {_mm256_sqrt_pd(a.v)}; return r; }
+
+  /// Lanes set to all ones where the comparison holds:
+  inline Vec4d greater(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; return r; }
+  /// mask ? a : b
+  inline Vec4d select(const Vec4d& mask, const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_blendv_pd(b.v, a.v, mask.v)}; return r; }
+
+  inline Vec4d signMask() { return broadcast(-0.0); }
+  inline Vec4d abs(const Vec4d& a) { Vec4d r = {_mm256_andnot_pd(signMask().v, a.v)}; return r; }
+  inline Vec4d signOf(const Vec4d& a) { Vec4d r = {_mm256_and_pd(signMask().v, a.v)}; return r; }
+  inline Vec4d bitXor(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm256_xor_pd(a.v, b.v)}; return r; }
+
+#elif defined(__SSE2__)
+
+  static const char* const BACKEND = "sse2";
+
+  struct Vec4d
+  {
+    __m128d lo, hi;
+  };
+
+  inline Vec4d set(double a, double b, double c, double d) { Vec4d r = {_mm_setr_pd(a, b), _mm_setr_pd(c, d)}; return r; }
+  inline Vec4d broadcast(double a) { Vec4d r = {_mm_set1_pd(a), _mm_set1_pd(a)}; return r; }
+  inline void store(const Vec4d& a, double* p) { _mm_storeu_pd(p, a.lo); _mm_storeu_pd(p + 2, a.hi); }
+
+  inline Vec4d operator+(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)}; return r; }
+  inline Vec4d operator-(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)}; return r; }
+  inline Vec4d operator*(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)}; return r; }
+  inline Vec4d operator/(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi)}; return r; }
+  inline Vec4d sqrt(const Vec4d& a) { Vec4d r = {_mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi)}; return r; }
+
+  /// Lanes set to all ones where the comparison holds:
+  inline Vec4d greater(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm_cmpgt_pd(a.lo, b.lo), _mm_cmpgt_pd(a.hi, b.hi)}; return r; }
+  /// mask ? a : b
+  inline Vec4d select(const Vec4d& mask, const Vec4d& a, const Vec4d& b)
+  {
+    Vec4d r = {_mm_or_pd(_mm_and_pd(mask.lo, a.lo), _mm_andnot_pd(mask.lo, b.lo)),
+               _mm_or_pd(_mm_and_pd(mask.hi, a.hi), _mm_andnot_pd(mask.hi, b.hi))};
+    return r;
+  }
+
+  inline Vec4d signMask() { return broadcast(-0.0); }
+  inline Vec4d abs(const Vec4d& a) { const Vec4d m = signMask(); Vec4d r = {_mm_andnot_pd(m.lo, a.lo), _mm_andnot_pd(m.hi, a.hi)}; return r; }
+  inline Vec4d signOf(const Vec4d& a) { const Vec4d m = signMask(); Vec4d r = {_mm_and_pd(m.lo, a.lo), _mm_and_pd(m.hi, a.hi)}; return r; }
+  inline Vec4d bitXor(const Vec4d& a, const Vec4d& b) { Vec4d r = {_mm_xor_pd(a.lo, b.lo), _mm_xor_pd(a.hi, b.hi)}; return r; }
+
+#else
+
+  static const char* const BACKEND = "scalar";
+
+  struct Vec4d
+  {
+    double v[4];
+  };
+
+  inline Vec4d set(double a, double b, double c, double d) { Vec4d r = {{a, b, c, d}}; return r; }
+  inline Vec4d broadcast(double a) { Vec4d r = {{a, a, a, a}}; return r; }
+  inline void store(const Vec4d& a, double* p) { for(int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+
+  inline Vec4d operator+(const Vec4d& a, const Vec4d& b) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+  inline Vec4d operator-(const Vec4d& a, const Vec4d& b) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+  inline Vec4d operator*(const Vec4d& a, const Vec4d& b) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+  inline Vec4d operator/(const Vec4d& a, const Vec4d& b) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = a.v[i] / b.v[i]; return r; }
+  inline Vec4d sqrt(const Vec4d& a) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = std::sqrt(a.v[i]); return r; }
+
+  /// Lanes set to 1 where the comparison holds (only used through select):
+  inline Vec4d greater(const Vec4d& a, const Vec4d& b) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? 1.0 : 0.0; return r; }
+  /// mask ? a : b
+  inline Vec4d select(const Vec4d& mask, const Vec4d& a, const Vec4d& b) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = mask.v[i] != 0.0 ? a.v[i] : b.v[i]; return r; }
+
+  inline Vec4d abs(const Vec4d& a) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = std::fabs(a.v[i]); return r; }
+  /// +-0 carrying the sign of each lane (only used through bitXor):
+  inline Vec4d signOf(const Vec4d& a) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = std::signbit(a.v[i]) ? -0.0 : 0.0; return r; }
+  /// Flip the sign of a where sign is -0
+  inline Vec4d bitXor(const Vec4d& a, const Vec4d& sign) { Vec4d r; for(int i = 0; i < 4; ++i) r.v[i] = std::signbit(sign.v[i]) ? -a.v[i] : a.v[i]; return r; }
+
+#endif
+
+  /**
+   * \brief Arc tangent of each lane
+   * Cephes range reduction and rational approximation, accurate to a few ulp
+   * over the whole real line, without any branch on the lane values.
+   */
+  inline Vec4d atan(const Vec4d& x)
+  {
+    const Vec4d sign = signOf(x);
+    const Vec4d ax = abs(x);
+
+    // Range reduction: x > tan(3pi/8) -> pi/2 - atan(1/x), x > 0.66 -> pi/4 + atan((x-1)/(x+1))
+    const Vec4d big = greater(ax, broadcast(2.41421356237309504880));
+    const Vec4d medium = greater(ax, broadcast(0.66));
+    const Vec4d one = broadcast(1.0);
+    const Vec4d num = select(big, broadcast(-1.0), select(medium, ax - one, ax));
+    const Vec4d den = select(big, ax, select(medium, ax + one, one));
+    const Vec4d xr = num/den;
+    // Offset split in two parts to keep the bits of pi lost by rounding
+    const double more_bits = 6.123233995736765886130E-17;
+    Vec4d offset = select(medium, broadcast(M_PI_4), broadcast(0.0));
+    offset = select(big, broadcast(M_PI_2), offset);
+    Vec4d offset_low = select(medium, broadcast(0.25*more_bits), broadcast(0.0));
+    offset_low = select(big, broadcast(0.5*more_bits), offset_low);
+
+    const Vec4d z = xr*xr;
+    const Vec4d p = (((broadcast(-8.750608600031904122785E-1)*z
+                       + broadcast(-1.615753718733365076637E1))*z
+                      + broadcast(-7.500855792314704667340E1))*z
+                     + broadcast(-1.228866684490136173410E2))*z
+                    + broadcast(-6.485021904942025371773E1);
+    const Vec4d q = ((((z + broadcast(2.485846490142306297962E1))*z
+                       + broadcast(1.650270098316988542046E2))*z
+                      + broadcast(4.328810604912902668951E2))*z
+                     + broadcast(4.853903996359136964868E2))*z
+                    + broadcast(1.945506571482613964425E2);
+    const Vec4d y = offset + ((xr*(z*p/q) + xr) + offset_low);
+
+    return bitXor(y, sign);
+  }
+
+} // namespace simd
+} // namespace vehicle_kinematics
+
+#endif // VEHICLE_KINEMATICS_SIMD_H
@@ -0,0 +1,327 @@
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <vehicle_kinematics/ackermann_kinematics.h>
+#include <vehicle_kinematics/four_wheel_steering_kinematics.h>
+#include <vehicle_kinematics/four_wheel_steering_simd.h>
+#include <vehicle_kinematics/pose_integration.h>
+
+using namespace vehicle_kinematics;
+
+// Floating-point value comparison threshold
+const double EPS = 1e-9;
+
+const double TRACK = 1.1;
+const double WHEEL_RADIUS = 0.28;
+const double WHEEL_BASE = 1.2;
+
+TEST(VirtualSteeringTest, testStraight)
+{
+  EXPECT_EQ(virtualSteeringAngle(0.0, 0.0), 0.0);
+  EXPECT_EQ(virtualSteeringAngle(0.0005, -0.0005), 0.0);
+}
+
+TEST(VirtualSteeringTest, testSymmetric)
+{
+  // The virtual wheel angle lies between the inner and outer wheel angles
+  const double left = 0.3, right = 0.25;
+  const double virtual_steering = virtualSteeringAngle(left, right);
+  EXPECT_GT(virtual_steering, right);
+  EXPECT_LT(virtual_steering, left);
+  EXPECT_NEAR(virtualSteeringAngle(-left, -right), -virtual_steering, EPS);
+}
+
+TEST(FourWheelSteeringKinematicsTest, testTwistStraight)
+{
+  FourWheelSteeringKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<double> cmd;
+  kinematics.twistToWheels(1.0, 0.0, cmd);
+  for(int i = 0; i < 4; ++i)
+  {
+    EXPECT_NEAR(cmd.velocity[i], 1.0/WHEEL_RADIUS, EPS);
+    EXPECT_NEAR(cmd.steering[i], 0.0, EPS);
+  }
+}
+
+TEST(FourWheelSteeringKinematicsTest, testTwistTurn)
+{
+  FourWheelSteeringKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<double> cmd;
+  const double lin = 1.0, ang = 0.5;
+  kinematics.twistToWheels(lin, ang, cmd);
+
+  // Each wheel velocity is orthogonal to its radius to the CIR
+  const double radius = lin/ang;
+  EXPECT_NEAR(std::tan(cmd.steering[FRONT_LEFT]), (WHEEL_BASE/2.0)/(radius - TRACK/2.0), EPS);
+  EXPECT_NEAR(std::tan(cmd.steering[FRONT_RIGHT]), (WHEEL_BASE/2.0)/(radius + TRACK/2.0), EPS);
+  EXPECT_NEAR(cmd.steering[REAR_LEFT], -cmd.steering[FRONT_LEFT], EPS);
+  EXPECT_NEAR(cmd.steering[REAR_RIGHT], -cmd.steering[FRONT_RIGHT], EPS);
+  EXPECT_LT(cmd.velocity[FRONT_LEFT], cmd.velocity[FRONT_RIGHT]);
+  EXPECT_NEAR(cmd.velocity[FRONT_LEFT]*WHEEL_RADIUS,
+              ang*std::hypot(radius - TRACK/2.0, WHEEL_BASE/2.0), EPS);
+}
+
+TEST(FourWheelSteeringKinematicsTest, testForwardInverse)
+{
+  // Forward kinematics of the inverse kinematics gives back the twist
+  FourWheelSteeringKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<double> cmd;
+  const double lin = 1.5, ang = -0.4;
+  kinematics.twistToWheels(lin, ang, cmd);
+
+  const double front_steering = virtualSteeringAngle(cmd.steering[FRONT_LEFT], cmd.steering[FRONT_RIGHT]);
+  const double rear_steering = virtualSteeringAngle(cmd.steering[REAR_LEFT], cmd.steering[REAR_RIGHT]);
+  BodyVelocity<double> velocity;
+  kinematics.wheelsToBody(cmd.velocity[REAR_LEFT], cmd.velocity[REAR_RIGHT],
+                          front_steering, rear_steering, velocity);
+  EXPECT_NEAR(velocity.angular, ang, 1e-6);
+}
+
+TEST(FourWheelSteeringKinematicsTest, testFourWheelsForward)
+{
+  FourWheelSteeringKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<double> cmd;
+  const double lin = 1.5, ang = -0.4;
+  kinematics.twistToWheels(lin, ang, cmd);
+
+  BodyVelocity<double> velocity;
+  ASSERT_TRUE(kinematics.wheelsToBody(cmd.velocity, cmd.steering, velocity));
+  EXPECT_NEAR(velocity.linear_x, lin, EPS);
+  EXPECT_NEAR(velocity.linear_y, 0.0, EPS);
+  EXPECT_NEAR(velocity.angular, ang, EPS);
+
+  // Position increments give the displacement, whatever the time they took
+  double increment[4];
+  for(int i = 0; i < 4; ++i)
+    increment[i] = 0.01*cmd.velocity[i];
+  ASSERT_TRUE(kinematics.wheelsToBody(increment, cmd.steering, velocity));
+  EXPECT_NEAR(velocity.linear_x, 0.01*lin, EPS);
+  EXPECT_NEAR(velocity.angular, 0.01*ang, EPS);
+
+  // All wheels sideways: the longitudinal velocity is unknown
+  const double sideways[4] = {M_PI_2, M_PI_2, M_PI_2, M_PI_2};
+  EXPECT_FALSE(kinematics.wheelsToBody(cmd.velocity, sideways, velocity));
+}
+
+TEST(FourWheelSteeringKinematicsTest, testBatch)
+{
+  FourWheelSteeringKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  const std::size_t n = 1000;
+  std::vector<double> lin(n), front(n), rear(n);
+  for(std::size_t k = 0; k < n; ++k)
+  {
+    lin[k] = -2.0 + 4.0*k/n;
+    front[k] = -0.5 + 1.0*k/n;
+    rear[k] = 0.3 - 0.6*k/n;
+  }
+  std::vector<std::vector<double> > vel(4, std::vector<double>(n)), steer(4, std::vector<double>(n));
+  FourWheelSteeringWheelCommandBatch<double> wheels;
+  for(int i = 0; i < 4; ++i)
+  {
+    wheels.velocity[i] = vel[i].data();
+    wheels.steering[i] = steer[i].data();
+  }
+
+  const FourWheelSteeringCommandBatch<double> cmds = {lin.data(), front.data(), rear.data(), n};
+  kinematics.fourWheelSteeringToWheels(cmds, wheels);
+
+  FourWheelSteeringWheelCommands<double> cmd;
+  for(std::size_t k = 0; k < n; ++k)
+  {
+    kinematics.fourWheelSteeringToWheels(lin[k], front[k], rear[k], cmd);
+    for(int i = 0; i < 4; ++i)
+    {
+      EXPECT_EQ(vel[i][k], cmd.velocity[i]);
+      EXPECT_EQ(steer[i][k], cmd.steering[i]);
+    }
+  }
+}
+
+TEST(FourWheelSteeringKinematicsTest, testFloat)
+{
+  FourWheelSteeringKinematics<float> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<float> cmd;
+  kinematics.twistToWheels(1.0f, 0.5f, cmd);
+  FourWheelSteeringKinematics<double> kinematics_d(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<double> cmd_d;
+  kinematics_d.twistToWheels(1.0, 0.5, cmd_d);
+  for(int i = 0; i < 4; ++i)
+  {
+    EXPECT_NEAR(cmd.velocity[i], cmd_d.velocity[i], 1e-4);
+    EXPECT_NEAR(cmd.steering[i], cmd_d.steering[i], 1e-5);
+  }
+}
+
+TEST(SimdTest, testAtan)
+{
+  const double values[] = {0.0, -0.0, 1e-8, 0.3, -0.65, 0.67, 1.0, -2.4, 2.5, 1e3, -1e12};
+  for(std::size_t k = 0; k < sizeof(values)/sizeof(values[0]); ++k)
+  {
+    double out[4];
+    simd::store(simd::atan(simd::set(values[k], -values[k], 1.0/values[k], 0.5*values[k])), out);
+    EXPECT_NEAR(out[0], std::atan(values[k]), 1e-15);
+    EXPECT_NEAR(out[1], std::atan(-values[k]), 1e-15);
+    EXPECT_NEAR(out[2], std::atan(1.0/values[k]), 1e-15);
+    EXPECT_NEAR(out[3], std::atan(0.5*values[k]), 1e-15);
+  }
+}
+
+TEST(SimdTest, testFourWheelSteeringSameAsScalar)
+{
+  FourWheelSteeringKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_BASE);
+  FourWheelSteeringWheelCommands<double> cmd, cmd_simd;
+  for(double lin = -2.0; lin <= 2.0; lin += 0.0625)
+  {
+    for(double ang = -1.5; ang <= 1.5; ang += 0.125)
+    {
+      kinematics.twistToWheels(lin, ang, cmd);
+      simd::twistToWheels(kinematics, lin, ang, cmd_simd);
+      for(int i = 0; i < 4; ++i)
+      {
+        EXPECT_NEAR(cmd_simd.velocity[i], cmd.velocity[i], 1e-12);
+        EXPECT_NEAR(cmd_simd.steering[i], cmd.steering[i], 1e-12);
+      }
+
+      const double front = 0.4*ang, rear = -0.25*ang;
+      kinematics.fourWheelSteeringToWheels(lin, front, rear, cmd);
+      simd::fourWheelSteeringToWheels(kinematics, lin, front, rear, cmd_simd);
+      for(int i = 0; i < 4; ++i)
+      {
+        EXPECT_NEAR(cmd_simd.velocity[i], cmd.velocity[i], 1e-12);
+        EXPECT_NEAR(cmd_simd.steering[i], cmd.steering[i], 1e-12);
+      }
+    }
+  }
+}
+
+TEST(AckermannKinematicsTest, testAckermannTurn)
+{
+  AckermannKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_RADIUS, WHEEL_BASE, 0.6);
+  AckermannWheelCommands<double> cmd;
+  const double steering = 0.2;
+  kinematics.ackermannToWheels(1.0, steering, cmd);
+
+  // Inner wheel turns more than the outer one and the virtual wheel is in between
+  EXPECT_GT(cmd.steering[0], cmd.steering[1]);
+  EXPECT_NEAR(virtualSteeringAngle(cmd.steering[0], cmd.steering[1]), steering, 1e-6);
+  EXPECT_LT(cmd.velocity[REAR_LEFT], cmd.velocity[REAR_RIGHT]);
+}
+
+TEST(AckermannKinematicsTest, testSteeringSaturation)
+{
+  const double steering_limit = 0.4;
+  AckermannKinematics<double> kinematics(TRACK, WHEEL_RADIUS, WHEEL_RADIUS, WHEEL_BASE, steering_limit);
+  double left = 0.6, right = 0.45;
+  kinematics.handleSteeringSaturation(left, right);
+  EXPECT_NEAR(left, steering_limit, EPS);
+  // Both wheels still share the same CIR
+  EXPECT_NEAR(WHEEL_BASE/std::tan(right) - WHEEL_BASE/std::tan(left), TRACK, EPS);
+}
+
+TEST(AckermannKinematicsTest, testBatch)
+{
+  AckermannKinematics<double> kinematics(TRACK, WHEEL_RADIUS, 0.3, WHEEL_BASE, 0.5);
+  const std::size_t n = 1000;
+  std::vector<double> lin(n), ang(n);
+  for(std::size_t k = 0; k < n; ++k)
+  {
+    lin[k] = -2.0 + 4.0*k/n;
+    ang[k] = 1.0 - 2.0*k/n;
+  }
+  std::vector<std::vector<double> > vel(4, std::vector<double>(n)), steer(2, std::vector<double>(n));
+  AckermannWheelCommandBatch<double> wheels;
+  for(int i = 0; i < 4; ++i)
+    wheels.velocity[i] = vel[i].data();
+  for(int i = 0; i < 2; ++i)
+    wheels.steering[i] = steer[i].data();
+
+  const TwistCommandBatch<double> cmds = {lin.data(), ang.data(), n};
+  kinematics.twistToWheels(cmds, wheels);
+
+  AckermannWheelCommands<double> cmd;
+  for(std::size_t k = 0; k < n; ++k)
+  {
+    kinematics.twistToWheels(lin[k], ang[k], cmd);
+    for(int i = 0; i < 4; ++i)
+      EXPECT_EQ(vel[i][k], cmd.velocity[i]);
+    for(int i = 0; i < 2; ++i)
+      EXPECT_EQ(steer[i][k], cmd.steering[i]);
+  }
+}
+
+TEST(PoseIntegrationTest, testExactArc)
+{
+  // A constant velocity with a lateral component follows a circle
+  const BodyVelocity<double> velocity = {1.0, 0.3, 0.8};
+  const double dt = 1.5;
+  Pose2D<double> pose = {0.0, 0.0, 0.0};
+  integratePose(INTEGRATION_EXACT, velocity, velocity, dt, pose);
+
+  const double dheading = velocity.angular*dt;
+  EXPECT_NEAR(pose.x, (velocity.linear_x*std::sin(dheading) - velocity.linear_y*(1 - std::cos(dheading)))/velocity.angular, EPS);
+  EXPECT_NEAR(pose.y, (velocity.linear_x*(1 - std::cos(dheading)) + velocity.linear_y*std::sin(dheading))/velocity.angular, EPS);
+  EXPECT_NEAR(pose.heading, dheading, EPS);
+
+  // Same as the Runge-Kutta 4 integration of a constant velocity
+  Pose2D<double> rk4 = {0.0, 0.0, 0.0};
+  for(int k = 0; k < 100; ++k)
+    integratePose(INTEGRATION_RUNGE_KUTTA_4, velocity, velocity, dt/100, rk4);
+  EXPECT_NEAR(rk4.x, pose.x, 1e-9);
+  EXPECT_NEAR(rk4.y, pose.y, 1e-9);
+}
+
+namespace
+{
+  BodyVelocity<double> varyingVelocity(double t)
+  {
+    const BodyVelocity<double> velocity = {1.5 + std::sin(t), 0.4*std::cos(0.7*t), 0.6*std::sin(0.5*t + 0.3)};
+    return velocity;
+  }
+
+  /// Integrates varyingVelocity() over 10 s at the given rate, the velocity being sampled once per step
+  Pose2D<double> integrateVaryingVelocity(IntegrationMethod method, double rate)
+  {
+    const int steps = static_cast<int>(10.0*rate);
+    const double dt = 1.0/rate;
+    Pose2D<double> pose = {0.0, 0.0, 0.0};
+    BodyVelocity<double> previous = varyingVelocity(0.0);
+    for(int k = 1; k <= steps; ++k)
+    {
+      const BodyVelocity<double> current = varyingVelocity(k*dt);
+      integratePose(method, previous, current, dt, pose);
+      previous = current;
+    }
+    return pose;
+  }
+}
+
+TEST(PoseIntegrationTest, testAccuracy)
+{
+  const Pose2D<double> reference = integrateVaryingVelocity(INTEGRATION_RUNGE_KUTTA_4, 10000.0);
+  const Pose2D<double> euler = integrateVaryingVelocity(INTEGRATION_EULER, 1000.0);
+  const Pose2D<double> rk4 = integrateVaryingVelocity(INTEGRATION_RUNGE_KUTTA_4, 100.0);
+
+  // Runge-Kutta 4 at 100 Hz does better than Euler at 1 kHz
+  const double euler_error = std::hypot(euler.x - reference.x, euler.y - reference.y);
+  const double rk4_error = std::hypot(rk4.x - reference.x, rk4.y - reference.y);
+  EXPECT_LT(rk4_error, euler_error);
+  EXPECT_LT(rk4_error, 1e-4);
+  EXPECT_NEAR(rk4.heading, reference.heading, 1e-5);
+}
+
+TEST(PoseIntegrationTest, testFromString)
+{
+  IntegrationMethod method = INTEGRATION_EULER;
+  EXPECT_TRUE(integrationMethodFromString("runge_kutta_4", method));
+  EXPECT_EQ(method, INTEGRATION_RUNGE_KUTTA_4);
+  EXPECT_FALSE(integrationMethodFromString("rk4", method));
+  EXPECT_EQ(method, INTEGRATION_RUNGE_KUTTA_4);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}